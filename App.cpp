@@ -1,4 +1,5 @@
 #include "App.hpp"
+#include "TraceRecorder.hpp"
 #include <iostream>
 #include <filesystem>
 #include <Windows.h>
@@ -17,10 +18,9 @@ App::App() {
     // driver scales it down if big
     capturer.Init(640, 640);
     capturer.SetFastMode(fastCapture); // Apply default
+    capturer.SetFramePool(&framePool); // screen frames come from the pool
     
-    capturer.SetFastMode(fastCapture); // Apply default
-    
-    // default res is 640 dont touch
+    // default res is 640, adaptive controller starts from here too
     aiResolution = 640;
     detector.SetInputResolution(aiResolution);
     
@@ -30,6 +30,7 @@ App::App() {
 }
 
 App::~App() {
+    pipeline.Stop();
     if (textureView) textureView->Release();
     if (texture) texture->Release();
 }
@@ -75,87 +76,138 @@ void App::RefreshLabelList() {
     }
 }
 
-void App::WorkerLoop() {
+bool App::OpenReplay(const std::string& path, std::string* errorMsg) {
+    std::shared_ptr<FrameSource> src;
+    if (!path.empty()) {
+        src = CreateReplaySource(path, replayFps, replayLoop, errorMsg);
+        if (!src) return false;
+    }
+
+    std::lock_guard<std::mutex> lock(sourceMutex);
+    replaySource = src;
+    return true;
+}
+
+bool App::GrabFrame(CapturedFrame& captured) {
     int sW = GetSystemMetrics(SM_CXSCREEN);
     int sH = GetSystemMetrics(SM_CYSCREEN);
+        
+    // 0. update fov just in case
+    // hey mark if you read this why did we enable this by default?? it breaks on my laptop
+    int cx = sW / 2;
+    int cy = sH / 2;
+    int x = cx - (fovWidth / 2);
+    int y = cy - (fovHeight / 2);
     
-    // keep track of old stuff for velocity
-    std::vector<Detection> prevDetections;
-    auto prevTime = std::chrono::high_resolution_clock::now();
+    if (x < 0) x = 0; if (y < 0) y = 0;
+    if (fovWidth > sW) fovWidth = sW;
+    if (fovHeight > sH) fovHeight = sH;
+    
+    // screen unless a replay is open
+    std::shared_ptr<FrameSource> replay;
+    {
+        std::lock_guard<std::mutex> lock(sourceMutex);
+        replay = replaySource;
+    }
+    FrameSource* source = replay ? replay.get() : &capturer;
+    source->SetROI(x, y, fovWidth, fovHeight);
+    
+    // 1. capture takes time
+    if (!source->Grab(captured)) {
+        // replay ran out, stay on last result and idle
+        std::this_thread::sleep_for(std::chrono::milliseconds(replay ? 50 : 1));
+        return false;
+    }
+    return true;
+}
 
-    while (!shouldStop) {
-        auto startWork = std::chrono::high_resolution_clock::now();
-        
-        // 0. update fov just in case
-        // hey mark if you read this why did we enable this by default?? it breaks on my laptop
-        int cx = sW / 2;
-        int cy = sH / 2;
-        int x = cx - (fovWidth / 2);
-        int y = cy - (fovHeight / 2);
-        
-        if (x < 0) x = 0; if (y < 0) y = 0;
-        if (fovWidth > sW) fovWidth = sW;
-        if (fovHeight > sH) fovHeight = sH;
-        
-        capturer.SetROI(x, y, fovWidth, fovHeight);
-        
-        // 1. capture takes time
-        auto capTime = std::chrono::high_resolution_clock::now(); // start time
-        cv::Mat frame;
-        capturer.Capture(frame);
-        
-        // 2. Inference (Very Heavy)
-        // 2. inference is heavy af
-        std::vector<Detection> results;
-        if (!frame.empty() && detectionEnabled && detector.IsLoaded()) {
-            results = detector.Detect(frame, confThreshold, nmsThreshold);
-            
-            // --- prediction update ---
-            prediction.UpdateHistory(results);
-            results = prediction.GetProcessed(); 
-        }
-        
-        // 3. update shared data
-        {
-            std::lock_guard<std::mutex> lock(dataMutex);
-            sharedDetections = results;
-            captureTime = capTime; // share true time
-            
-            if (!frame.empty()) {
-                sharedWidth = frame.cols;
-                sharedHeight = frame.rows; // cap res like 640
-                // trashdetector downscales if needed
-                
-                sharedFovWidth = fovWidth;   // sync fov settings
-                sharedFovHeight = fovHeight; // yeah
-                
-                if (isMenuOpen) {
-                     frame.copyTo(sharedFrame);
-                     newFrameReady = true;
-                }
-            }
-        }
-        
-        auto endWork = std::chrono::high_resolution_clock::now();
-        double workTimeMs = std::chrono::duration<double, std::milli>(endWork - startWork).count();
+void App::PublishResult(PipelineResult& result) {
+    // smallest tracked box for the res controller, it runs on the preprocess thread
+    float smallest = -1.0f;
+    for (const auto& det : result.detections) {
+        float side = (std::min)(det.box.width, det.box.height);
+        if (smallest < 0.0f || side < smallest) smallest = side;
+    }
+    smallestTracked = smallest;
+
+    // 3. update shared data
+    // back buffer is ours until Publish, render never waits on this
+    FrameSnapshot& back = frameSnapshots.Back();
+    back.detections.swap(result.detections);
+    back.frame = std::move(result.frame); // pooled frame moves, pixels arent copied
+    back.stateTime = result.stateTime;
+    if (!back.frame.image.empty()) {
+        back.width = back.frame.image.cols;
+        back.height = back.frame.image.rows; // cap res like 640
+    }
+    back.fovWidth = fovWidth;   // sync fov settings
+    back.fovHeight = fovHeight; // yeah
+    frameSnapshots.Publish();
+}
+
+void App::StartPipeline() {
+    DetectionPipeline::Callbacks cb;
+    cb.grab = [this](CapturedFrame& frame) { return GrabFrame(frame); };
 
-        if (targetAiFps > 0) {
-            double targetFrameTime = 1000.0 / targetAiFps;
-            double sleepTime = targetFrameTime - workTimeMs;
-            if (sleepTime > 0) std::this_thread::sleep_for(std::chrono::milliseconds((int)sleepTime));
+    // input size for this frame, fixed res models pin it themselves
+    // resController lives on this thread, the gui side only reaches it through resSettings
+    PublishResolutionSettings();
+    cb.beforePrepare = [this](const cv::Mat& frame) {
+        if (detector.IsFixedResolution()) return;
+        if (resSettings.Fetch()) resController.config = resSettings.Front().config;
+        if (resController.config.enabled) {
+            int res = resController.Update(perfLogger.GetRecentInferenceMs(), smallestTracked.load(), frame.cols, frame.rows);
+            detector.SetInputResolution(res);
         } else {
-             if (!detectionEnabled) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            int res = resSettings.Front().manualRes;
+            detector.SetInputResolution(res);
+            resController.Reset(res);
         }
-    }
+    };
+
+    // --- prediction update ---
+    cb.track = [this](PipelineResult& result, std::vector<Detection>& weak, bool keyframe) {
+        if (keyframe) prediction.AlignToFlow(result.frame, result.detections, &weak);
+        else prediction.ResetFlow();
+        prediction.UpdateHistory(result.detections, &weak, &result.frame);
+        result.detections = prediction.GetProcessed();
+        result.stateTime = prediction.StateTime(); // newer than the frame if flow got ahead
+    };
+    // keyframe mode, frames between detector runs get the tracks moved by optical flow
+    cb.propagate = [this](PipelineResult& result) {
+        prediction.Propagate(result.frame);
+        result.detections = prediction.GetProcessed();
+    };
+    cb.publish = [this](PipelineResult& result) { PublishResult(result); };
+
+    pipeline.Start(std::move(cb), &perfLogger, telemetry.get());
+}
+
+void App::PublishResolutionSettings() {
+    ResolutionSettings& s = resSettings.Back();
+    s.config = resConfig;
+    s.manualRes = aiResolution;
+    resSettings.Publish();
 }
 
 void App::Run() {
-    // Start Worker
-    shouldStop = false;
-    workerThread = std::thread(&App::WorkerLoop, this);
+    // capture preprocess infer post on their own threads, see DetectionPipeline.cpp
+    StartPipeline();
+    TraceRecorder::SetThreadName("render");
 
     while (!gui.ShouldClose()) {
+        TRACE_SCOPE("render");
         gui.BeginFrame();
+
+        // knobs for the pipeline threads
+        pipeline.detectionEnabled = detectionEnabled;
+        pipeline.confThreshold = confThreshold;
+        pipeline.nmsThreshold = nmsThreshold;
+        pipeline.lowConfThreshold = lowConfThreshold;
+        pipeline.targetFps = targetAiFps;
+        pipeline.keyframeInterval = keyframeInterval;
+        pipeline.motionGateEnabled = motionGate;
+        PublishResolutionSettings();
         
         if (gui.requestMenuToggle || ImGui::IsKeyPressed(ImGuiKey_Insert)) {
             isMenuOpen = !isMenuOpen;
@@ -164,34 +216,20 @@ void App::Run() {
         }
 
         // --- RENDER THREAD ---
-        std::vector<Detection> drawDetections;
-        cv::Mat drawFrame;
-        bool frameUpdated = false;
-        int currentSetupW = 1920; 
-        int currentSetupH = 1080;
-        int currentFovW = 640;
-        int currentFovH = 640;
-        std::chrono::high_resolution_clock::time_point capTime;
-        
-        {
-            std::lock_guard<std::mutex> lock(dataMutex);
-            drawDetections = sharedDetections;
-            currentSetupW = sharedWidth;
-            currentSetupH = sharedHeight;
-            // capture fov active during update
-            // note sharedwidth comes from captured frame 640x640
-            // but we need logic fov size for drawing box
-            currentFovW = sharedFovWidth; 
-            currentFovH = sharedFovHeight;
-            
-            capTime = captureTime;
-            
-            if (newFrameReady && isMenuOpen) { 
-                sharedFrame.copyTo(drawFrame);
-                newFrameReady = false; 
-                frameUpdated = true;
-            }
-        }
+        // newest result from the post thread, lock free and no copies
+        bool frameUpdated = frameSnapshots.Fetch();
+        const FrameSnapshot& snap = frameSnapshots.Front();
+        const std::vector<Detection>& drawDetections = snap.detections;
+        // note width comes from captured frame 640x640
+        // but we need logic fov size for drawing box
+        int currentSetupW = snap.width; 
+        int currentSetupH = snap.height;
+        int currentFovW = snap.fovWidth;
+        int currentFovH = snap.fovHeight;
+        FrameClock::time_point capTime = snap.frame.captureTime;
+        FrameClock::time_point stateTime = snap.stateTime; // what the boxes describe, can be past capTime
+        TraceRecorder::SetFrame(snap.frame.frameId);
+        auto frameStart = FrameClock::now();
         
         if (detectionEnabled) {
             ImDrawList* drawList = ImGui::GetForegroundDrawList();
@@ -209,18 +247,19 @@ void App::Run() {
             float scaleX = 1.0f; 
             float scaleY = 1.0f;
 
-            // Prediction Time Delta
             // pred time delta
-            // Prediction Time Delta
-            auto now = std::chrono::high_resolution_clock::now();
-            double timeSinceDet = std::chrono::duration<double>(now - capTime).count();
+            // boxes are where things were at stateTime, they show up on screen a present later
+            // so look ahead the whole capture -> display time, not just capture -> now
+            double timeSinceDet = std::chrono::duration<double>(frameStart - stateTime).count() + presentDelay;
             
             // Add perf logging after detection and ultrasonic overlay in render
-            auto t2 = std::chrono::high_resolution_clock::now();
+            auto t2 = FrameClock::now();
             double aiLatency = std::chrono::duration<double, std::milli>(t2 - capTime).count(); // Assuming t1 is capTime
             
-            // record perf metrics
-            if (perfLogger.IsLogging()) {
+            // record perf metrics once per new result, the render loop redraws the same one until the next lands
+            // and would count its latency again every redraw, the empty snapshot before the first result has no capture time
+            // rolling windows run all the time, session totals only while logging
+            if (frameUpdated && capTime != FrameClock::time_point()) {
                 float avgConf = 0.0f;
                 if (!drawDetections.empty()) { // using drawDetections
                     for (const auto& det : drawDetections) {
@@ -231,8 +270,9 @@ void App::Run() {
                 perfLogger.RecordFrame(aiLatency, (int)drawDetections.size(), avgConf);
             }
             
-            // predict positions
-            std::vector<Detection> finalDets = prediction.Predict(drawDetections, timeSinceDet);
+            // predict positions, into a buffer kept across frames
+            std::vector<Detection>& finalDets = predictedDets;
+            prediction.Predict(drawDetections, timeSinceDet, finalDets);
 
             // distance find closest
             int closestIdx = distanceEst.FindClosestIndex(finalDets, currentSetupW, currentSetupH);
@@ -243,8 +283,8 @@ void App::Run() {
                 // box geo
                 float bx = det.box.x;
                 float by = det.box.y;
-                float bw = (float)det.box.width;
-                float bh = (float)det.box.height;
+                float bw = det.box.width;
+                float bh = det.box.height;
 
                 // map to screen fix fov scale
                 
@@ -284,18 +324,19 @@ void App::Run() {
                 }
                 
                 if (showName || showConf || distanceEst.enabled) {
-                    std::string label = "";
-                    if (showName) label += det.label;
+                    // fixed buffer, label is a plain pointer so nothing gets built per box
+                    char label[128];
+                    int len = snprintf(label, sizeof(label), "%s", showName ? det.label : "");
                     
-                    if (distanceEst.enabled) {
-                        label += distanceEst.GetDistanceText(det, frameScaleY); 
+                    if (distanceEst.enabled && len < (int)sizeof(label)) {
+                        len += snprintf(label + len, sizeof(label) - len, "%s", distanceEst.GetDistanceText(det, frameScaleY).c_str()); 
                     }
                     
-                    if (showConf) {
-                         label += " (" + std::to_string((int)(det.confidence*100)) + "%)";
+                    if (showConf && len < (int)sizeof(label)) {
+                         snprintf(label + len, sizeof(label) - len, " (%d%%)", (int)(det.confidence*100));
                     }
                     
-                    drawList->AddText(ImVec2(x1, y1 - 20), textCol, label.c_str());
+                    drawList->AddText(ImVec2(x1, y1 - 20), textCol, label);
                 }
             }
 
@@ -314,14 +355,16 @@ void App::Run() {
         }
 
         // 3. update preview only if menu open
-        if (isMenuOpen && frameUpdated && !drawFrame.empty()) {
+        // frame is shared with the pool so convert into our own buffer, then draw on that
+        if (isMenuOpen && frameUpdated && !snap.frame.image.empty()) {
+            const cv::Mat& src = snap.frame.image;
+            cv::cvtColor(src, previewRgba, src.channels() == 4 ? cv::COLOR_BGRA2RGBA : cv::COLOR_BGR2RGBA);
             // bake boxes into preview
             for (const auto& det : drawDetections) {
-                cv::Scalar bgr(boxColor[2] * 255, boxColor[1] * 255, boxColor[0] * 255);
-                cv::rectangle(drawFrame, det.box, bgr, (int)(std::max)(1.0f, boxThickness));
+                cv::Scalar rgba(boxColor[0] * 255, boxColor[1] * 255, boxColor[2] * 255, 255);
+                cv::rectangle(previewRgba, cv::Rect(det.box), rgba, (int)(std::max)(1.0f, boxThickness));
             }
-            cv::cvtColor(drawFrame, drawFrame, cv::COLOR_BGR2RGBA);
-            UpdateTexture(drawFrame);
+            UpdateTexture(previewRgba);
         }
 
         // 4. gui n fps
@@ -335,17 +378,31 @@ void App::Run() {
             ImGui::SetNextWindowBgAlpha(0.35f); 
             if (ImGui::Begin("FPS_Overlay", &showFps, flags)) {
                 ImGui::Text("Overlay FPS: %.1f", ImGui::GetIO().Framerate);
-                ImGui::Text("AI Latency: ~250ms"); // hardcoded lol
+                // measured capture -> on screen, same numbers predict uses
+                ImGui::Text("AI Latency: %.0f ms (p99 %.0f)", prediction.latency.Percentile(0.5) * 1000.0,
+                            prediction.latency.Percentile(0.99) * 1000.0);
+                const PipelineStats& ps = pipeline.Stats();
+                ImGui::Text("cap %.1f pre %.1f ai %.1f post %.1f ms", ps.stageMs[StageCapture].load(), ps.stageMs[StagePreprocess].load(),
+                            ps.stageMs[StageInfer].load(), ps.stageMs[StagePost].load());
             }
             ImGui::End();
         }
         
-        gui.EndFrame();
+        {
+            TRACE_SCOPE("present");
+            gui.EndFrame();
+        }
+
+        // present blocks on vsync, so this is about when the boxes hit the screen
+        auto displayed = FrameClock::now();
+        presentDelay += (std::chrono::duration<double>(displayed - frameStart).count() - presentDelay) * 0.1;
+        if (detectionEnabled && stateTime != FrameClock::time_point()) {
+            prediction.latency.Add(std::chrono::duration<double>(displayed - stateTime).count());
+        }
     }
     
-    // stop worker
-    shouldStop = true;
-    if (workerThread.joinable()) workerThread.join();
+    // stop pipeline threads
+    pipeline.Stop();
 }
 
 // rendergui is in App_Gui.cpp now
@@ -8,7 +8,14 @@
 #include "GuiLayer.hpp"
 #include "TrashDetector.hpp"
 #include "ScreenCapture.hpp"
+#include "FrameSource.hpp"
+#include "ResolutionController.hpp"
+#include "DetectionPipeline.hpp"
+#include "FramePool.hpp"
+#include "TripleBuffer.hpp"
+#include "TelemetryLog.hpp"
 #include <opencv2/opencv.hpp>
+#include <memory>
 #include <vector>
 #include <d3d11.h>
 #include <string>
@@ -31,9 +38,14 @@ private:
     void RefreshModelList();
     void RefreshLabelList();
 
+    // swap worker over to a recorded video or image folder, empty path goes back to screen
+    bool OpenReplay(const std::string& path, std::string* errorMsg = nullptr);
+
     GuiLayer gui;
     TrashDetector detector;
     ScreenCapture capturer;
+    std::shared_ptr<FrameSource> replaySource; // null means screen capture
+    std::mutex sourceMutex;
     
     // FEATURES NEW
     Prediction prediction;
@@ -41,31 +53,51 @@ private:
     Tracer tracer; // tracer thing
     ESP32Client esp32Client; // esp client
     PerformanceLogger perfLogger; // analytics
+    std::unique_ptr<TelemetryWriter> telemetry = std::make_unique<TelemetryWriter>(); // heap, its ring is 256KB and App lives on the stack
+    ResolutionController resController; // adaptive input size, preprocess thread only (gui reads Current)
+    // what the gui picked for it, published by the render thread, applied on the preprocess thread
+    struct ResolutionSettings {
+        ResolutionConfig config;
+        int manualRes = 640; // used when adaptive is off
+    };
+    ResolutionConfig resConfig; // gui edits this
+    TripleBuffer<ResolutionSettings> resSettings;
     // removed lastdetect time we use capturetime now
 
     // Threading
-    std::thread workerThread;
-    std::atomic<bool> shouldStop = false;
-    std::mutex dataMutex;
-    
-    // Shared Data (mutex protected)
-    std::vector<Detection> sharedDetections;
-    cv::Mat sharedFrame;
-    int sharedWidth = 1920;
-    int sharedHeight = 1080;
-    int sharedFovWidth = 640;  // new
-    int sharedFovHeight = 640; // new
-    std::chrono::high_resolution_clock::time_point captureTime; // true time 0
-    bool newFrameReady = false;
+    // what the render loop draws, written by the post thread
+    struct FrameSnapshot {
+        std::vector<Detection> detections;
+        CapturedFrame frame;     // pooled, handed over not copied
+        FrameClock::time_point stateTime; // capture time the detections describe
+        int width = 1920;
+        int height = 1080;
+        int fovWidth = 640;
+        int fovHeight = 640;
+    };
+
+    FramePool framePool;         // before anything holding frames so it dies last
+    TripleBuffer<FrameSnapshot> frameSnapshots;
+    std::atomic<float> smallestTracked{-1.0f}; // px, for the res controller
+    cv::Mat previewRgba;         // render thread only
+    std::vector<Detection> predictedDets; // render thread only, reused every frame
+    double presentDelay = 0.0;   // render thread only, ema seconds from frame start to present returning
+    DetectionPipeline pipeline{detector}; // stopped in Run and ~App before anything it calls into goes away
     
-    // Worker Function
-    void WorkerLoop();
+    // pipeline hooks
+    void StartPipeline();
+    bool GrabFrame(CapturedFrame& captured);     // capture thread
+    void PublishResult(PipelineResult& result);  // post thread
+    void PublishResolutionSettings();            // render thread
 
     float confThreshold = 0.5f;
     float nmsThreshold = 0.45f;
+    float lowConfThreshold = 0.1f; // weak boxes that only keep existing tracks alive
     int cpuThreads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 8; // default max threads
-    int aiResolution = 416; // input res (320 416 512 640)
+    int aiResolution = 416; // input res (320 416 512 640), manual pick when adaptive is off
     int targetAiFps = 0; // 0 is unlimited
+    int keyframeInterval = 1; // ai every Nth frame, optical flow moves boxes in between
+    bool motionGate = false;  // skip ai on frames where nothing changed since the last detected one
     bool detectionEnabled = true;
     bool isMenuOpen = true; // menu starts open
     bool showFPS = false;           // show fps
@@ -102,6 +134,7 @@ private:
     std::string currentModel = "Select Model...";
     std::string currentLabelFile = "None (Default)";
     std::string lastErrorMessage;
+    int seenLoadGeneration = 0; // last model load the gui reacted to
     std::string modelsPath = "C:/Users/Mathias/Desktop/AI/models"; // default path
     std::string labelsPath = "C:/Users/Mathias/Desktop/AI/models/labels"; // new
     
@@ -112,6 +145,13 @@ private:
     float movementDuration = 1.0f;      // duration sec
     char manualCommand[256] = "";       // manual buffer
     
+    // Replay
+    char replayPath[260] = "";
+    float replayFps = 0.0f;             // 0 native rate
+    bool replayLoop = true;
+    std::string replayStatus = "Screen";
+    std::string traceStatus;            // last trace export, empty until one ran
+
     // Feature toggles
     bool showUltrasonicInGUI = false;   // show ultrasonic gui
     bool showUltrasonicOverlay = false; // show ultrasonic overlay
@@ -1,6 +1,9 @@
 #include "App.hpp"
+#include "TraceRecorder.hpp"
 #include <imgui.h>
+#include <ctime>
 #include <filesystem>
+#include <iostream>
 #include <string>
 
 namespace fs = std::filesystem;
@@ -41,19 +44,41 @@ void App::RenderGui() {
                     if (ImGui::Selectable(filename.c_str(), isSelected)) {
                         currentModel = filename;
                         lastErrorMessage = ""; 
-                        std::string error; 
-                        if (detector.LoadModel(modelPath, useGpu, cpuThreads, &error)) {
-                            detectionEnabled = true;
-                        } else {
-                            currentModel += " (Error)";
-                            lastErrorMessage = error;
-                            detectionEnabled = false;
-                        }
+                        // loads in the background, old model keeps detecting meanwhile
+                        detector.LoadModelAsync(modelPath, useGpu, cpuThreads);
                     }
                     if (isSelected) ImGui::SetItemDefaultFocus();
                 }
                 ImGui::EndCombo();
             }
+
+            // load result from the loader thread, react once per finished load
+            ModelLoadStatus loadStatus = detector.GetLoadStatus();
+            if (loadStatus.generation != seenLoadGeneration && loadStatus.state != ModelLoadState::Loading) {
+                seenLoadGeneration = loadStatus.generation;
+                if (loadStatus.state == ModelLoadState::Ready) {
+                    detectionEnabled = true;
+                } else if (loadStatus.state == ModelLoadState::Failed) {
+                    currentModel = fs::path(loadStatus.path).filename().string() + " (Error)";
+                    lastErrorMessage = loadStatus.message;
+                    detectionEnabled = false;
+                }
+            }
+            if (loadStatus.state == ModelLoadState::Loading) {
+                ImGui::TextDisabled("Loading %s...", fs::path(loadStatus.path).filename().string().c_str());
+            } else if (loadStatus.state == ModelLoadState::Ready) {
+                ImGui::TextDisabled("Ready (%.0f ms%s)", loadStatus.loadMs, loadStatus.fromCache ? ", cached" : "");
+                if (ImGui::IsItemHovered()) {
+                    const HeadInfo& head = loadStatus.head;
+                    if (loadStatus.coldMs >= 0.0) {
+                        ImGui::SetTooltip("%s head, %d classes, %d anchors, session %.0f ms, cold start was %.0f ms", HeadLayoutName(head.layout),
+                                          head.classes, head.anchors, loadStatus.sessionMs, loadStatus.coldMs);
+                    } else {
+                        ImGui::SetTooltip("%s head, %d classes, %d anchors, session %.0f ms", HeadLayoutName(head.layout), head.classes,
+                                          head.anchors, loadStatus.sessionMs);
+                    }
+                }
+            }
             
             // label dropdown thing
             std::string labelComboPreview = fs::path(currentLabelFile).filename().string();
@@ -87,6 +112,27 @@ void App::RenderGui() {
                 RefreshLabelList();
             }
             
+            ImGui::Separator();
+            ImGui::Text("Frame Source");
+            ImGui::InputText("Replay Path", replayPath, sizeof(replayPath));
+            if (ImGui::IsItemHovered()) ImGui::SetTooltip("video file or folder of images");
+            ImGui::SliderFloat("Replay FPS", &replayFps, 0.0f, 120.0f, replayFps <= 0.0f ? "Native" : "%.0f FPS");
+            ImGui::Checkbox("Loop Replay", &replayLoop);
+            if (ImGui::Button("Open Replay")) {
+                std::string error;
+                if (OpenReplay(replayPath, &error)) {
+                    replayStatus = std::string("Replay: ") + replayPath;
+                } else {
+                    replayStatus = "Error: " + error;
+                }
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Use Screen")) {
+                OpenReplay("");
+                replayStatus = "Screen";
+            }
+            ImGui::TextDisabled("%s", replayStatus.c_str());
+
             ImGui::Separator();
             ImGui::Checkbox("Aktiver Detektion", &detectionEnabled);
             
@@ -101,6 +147,13 @@ void App::RenderGui() {
                 
                 ImGui::SliderFloat("Smoothness", &prediction.smoothingFactor, 0.1f, 1.0f, "%.2f");
                 if (ImGui::IsItemHovered()) ImGui::SetTooltip("low smooth high jitter");
+
+                ImGui::Checkbox("Track Acceleration", &prediction.motion.constantAcceleration);
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("follows curves better, overshoots on sudden turns");
+
+                ImGui::SliderInt("Keep Lost", &prediction.maxLostFrames, 0, 60, "%d updates");
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("how long a missed object keeps its id");
+                ImGui::Checkbox("Show Lost", &prediction.showLost);
             }
             
             ImGui::Separator();
@@ -138,12 +191,15 @@ void App::RenderGui() {
                      }
                  }
                  if (!fullPath.empty()) {
-                     std::string error;
-                     detector.LoadModel(fullPath, useGpu, cpuThreads, &error);
+                     detector.LoadModelAsync(fullPath, useGpu, cpuThreads);
                  }
             }
             if (ImGui::IsItemHovered()) ImGui::SetTooltip("try cuda might work");
 
+            bool cacheModels = detector.GetModelCache().enabled;
+            if (ImGui::Checkbox("Cache Optimized Models", &cacheModels)) detector.GetModelCache().enabled = cacheModels;
+            if (ImGui::IsItemHovered()) ImGui::SetTooltip("saves the optimized graph in cache/models, next start skips optimization");
+
             int maxCores = (int)std::thread::hardware_concurrency();
             if (maxCores < 1) maxCores = 32; // fallback
             if (ImGui::SliderInt("CPU Threads", &cpuThreads, 1, maxCores)) {
@@ -159,13 +215,17 @@ void App::RenderGui() {
                      }
                 }
                 if (!fullPath.empty()) {
-                    std::string error;
-                    detector.LoadModel(fullPath, false, cpuThreads, &error);
+                    // was always cpu here, keep the gpu toggle
+                    detector.LoadModelAsync(fullPath, useGpu, cpuThreads);
                 }
             }
             
             ImGui::SliderInt("Target AI FPS", &targetAiFps, 0, 60, "%d FPS");
             if (ImGui::IsItemHovered()) ImGui::SetTooltip("0 is unlimited 5-10 saves cpu");
+            ImGui::SliderInt("AI Every N Frames", &keyframeInterval, 1, 10);
+            if (ImGui::IsItemHovered()) ImGui::SetTooltip("frames in between follow boxes by optical flow, 1 is off");
+            ImGui::Checkbox("Skip Static Frames", &motionGate);
+            if (ImGui::IsItemHovered()) ImGui::SetTooltip("no ai when nothing moved since the last detected frame, old boxes stay");
             
             // ai res
             const char* resOptions[] = { "320x320 (Fastest)", "352x352", "416x416 (Balanced)", "480x480", "512x512 (Good)", "608x608", "640x640 (High Res)" };
@@ -180,13 +240,50 @@ void App::RenderGui() {
                 }
             }
             
-            // locked 640x640 per request
-            ImGui::TextDisabled("AI Resolution: 640x640 (Locked)");
-            if (ImGui::IsItemHovered()) ImGui::SetTooltip("locked for stability yes");
+            if (detector.IsFixedResolution()) {
+                // model was exported at one size, nothing to pick
+                int fixedRes = detector.GetFixedResolution();
+                ImGui::TextDisabled("AI Resolution: %dx%d (Fixed by model)", fixedRes, fixedRes);
+            } else {
+                ResolutionConfig& resCfg = resConfig;
+                ImGui::Checkbox("Adaptive Resolution", &resCfg.enabled);
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("lower res when close or slow higher when objects are small");
+
+                if (resCfg.enabled) {
+                    int res = resController.Current();
+                    ImGui::Text("AI Resolution: %dx%d (Auto)", res, res);
+                    float budget = (float)resCfg.budgetMs;
+                    if (ImGui::SliderFloat("AI Budget", &budget, 5.0f, 200.0f, "%.0f ms")) resCfg.budgetMs = budget;
+                    if (ImGui::IsItemHovered()) ImGui::SetTooltip("max inference time per frame");
+                    ImGui::SliderInt("Min Object Size", &resCfg.minObjectPx, 16, 128, "%d px");
+                    if (ImGui::IsItemHovered()) ImGui::SetTooltip("smallest object size in model input before going up");
+                    ImGui::TextDisabled("Recent AI Time: %.1f ms", perfLogger.GetRecentInferenceMs());
+                } else if (ImGui::Combo("AI Resolution", &currentResIdx, resOptions, IM_ARRAYSIZE(resOptions))) {
+                    aiResolution = resValues[currentResIdx];
+                }
+            }
              ImGui::Checkbox("Show FPS", &showFPS);
              // removed latency cause user said it looks bad
              // ImGui::Checkbox("Show AI Latency", &showLatency);
              
+             ImGui::Separator();
+             ImGui::Text("Pipeline");
+             {
+                 const PipelineStats& ps = pipeline.Stats();
+                 ImGui::Text("Stage ms: cap %.1f | pre %.1f | ai %.1f | post %.1f",
+                             ps.stageMs[StageCapture].load(), ps.stageMs[StagePreprocess].load(),
+                             ps.stageMs[StageInfer].load(), ps.stageMs[StagePost].load());
+                 ImGui::Text("Capture -> Result: %.1f ms", ps.latencyMs.load());
+                 uint64_t dropped = ps.dropped[StagePreprocess] + ps.dropped[StageInfer] + ps.dropped[StagePost];
+                 ImGui::Text("Frames: %llu done / %llu captured / %llu dropped",
+                             (unsigned long long)ps.completed.load(), (unsigned long long)ps.captured.load(),
+                             (unsigned long long)dropped);
+                 if (ImGui::IsItemHovered()) ImGui::SetTooltip("dropped = stale frames skipped so results stay fresh");
+                 ImGui::Text("Static Skipped: %llu (%.0f%%)", (unsigned long long)ps.gateSkipped.load(), ps.GateSkipRate() * 100.0);
+                 ImGui::Text("Frame Pool: %d in use / %llu misses", framePool.InUse(), (unsigned long long)framePool.Misses());
+                 if (ImGui::IsItemHovered()) ImGui::SetTooltip("misses mean the pool ran dry and a frame was allocated");
+             }
+
              ImGui::Separator();
              ImGui::Text("Performance Analytics");
              
@@ -210,6 +307,55 @@ void App::RenderGui() {
                  ImGui::Text("Total Detections: %d", perfLogger.GetTotalDetections());
                  ImGui::Unindent();
              }
+
+             // rolling percentiles, constant cost whatever the session length
+             {
+                 static const char* windowNames[] = { "1s", "10s", "60s" };
+                 const PerfMetric shown[] = { MetricLatency, MetricInference, MetricFrameTime };
+                 for (PerfMetric metric : shown) {
+                     ImGui::Text("%s", PerformanceLogger::MetricName(metric));
+                     ImGui::Indent();
+                     for (int w = 0; w < RollingLatency::WindowCount; w++) {
+                         LatencySummary s = perfLogger.GetWindowSummary(metric, (RollingLatency::Window)w);
+                         ImGui::Text("%-3s p50 %.1f | p90 %.1f | p99 %.1f | p99.9 %.1f | max %.1f ms", windowNames[w],
+                                     s.p50, s.p90, s.p99, s.p999, s.max);
+                     }
+                     ImGui::Unindent();
+                 }
+             }
+
+             // per stage timings for chrome://tracing or ui.perfetto.dev
+             bool tracing = TraceRecorder::Get().IsEnabled();
+             if (ImGui::Checkbox("Record Trace", &tracing)) {
+                 if (tracing) TraceRecorder::Get().Clear();
+                 TraceRecorder::Get().SetEnabled(tracing);
+             }
+             if (ImGui::IsItemHovered()) ImGui::SetTooltip("keeps the last ~30k events per thread");
+             ImGui::SameLine();
+             if (ImGui::Button("Export Trace")) {
+                 std::filesystem::create_directories("logs");
+                 std::string path = "logs/trace_" + std::to_string(std::time(nullptr)) + ".json";
+                 traceStatus = TraceRecorder::Get().ExportChrome(path) ? "Trace: " + path : "Error: could not write " + path;
+             }
+             if (!traceStatus.empty()) ImGui::TextDisabled("%s", traceStatus.c_str());
+
+             // one record per published frame, logs/telemetry_<time>_<n>.bin, TelemetryConvert makes csv/columns
+             bool streaming = telemetry->IsRunning();
+             if (ImGui::Checkbox("Stream Telemetry", &streaming)) {
+                 if (streaming) {
+                     std::string error;
+                     if (!telemetry->Start(&error)) std::cerr << error << std::endl;
+                 } else {
+                     telemetry->Stop();
+                 }
+             }
+             if (telemetry->IsRunning() || telemetry->Written() > 0) {
+                 ImGui::SameLine();
+                 ImGui::Text("%llu frames, %.1f MB, %llu dropped", (unsigned long long)telemetry->Written(),
+                             telemetry->BytesWritten() / (1024.0 * 1024.0), (unsigned long long)telemetry->Dropped());
+             }
+             std::string telemetryError = telemetry->LastError();
+             if (!telemetryError.empty()) ImGui::TextColored(ImVec4(1, 0, 0, 1), "telemetry stopped: %s", telemetryError.c_str());
             ImGui::Checkbox("Show FOV Box", &showFov);
             ImGui::SliderInt("FOV Width (X)", &fovWidth, 100, GetSystemMetrics(SM_CXSCREEN));
             // yo why we using system metrics here ?? its slow
@@ -218,6 +364,24 @@ void App::RenderGui() {
             ImGui::Separator();
             ImGui::SliderFloat("Genkendelse (Conf)", &confThreshold, 0.1f, 1.0f);
             ImGui::SliderFloat("Overlap (NMS)", &nmsThreshold, 0.1f, 1.0f);
+            ImGui::SliderFloat("Track Low Conf", &lowConfThreshold, 0.0f, 0.5f);
+            if (ImGui::IsItemHovered()) ImGui::SetTooltip("weak boxes down to this keep known objects tracked, 0 off");
+            {
+                // edit a copy, the inference thread reads the live one
+                NmsConfig nmsCfg = detector.GetNmsConfig();
+                bool nmsChanged = false;
+                const char* nmsModes[] = { "Hard", "Soft (Gaussian)", "DIoU" };
+                int nmsMode = (int)nmsCfg.mode;
+                if (ImGui::Combo("NMS Mode", &nmsMode, nmsModes, IM_ARRAYSIZE(nmsModes))) {
+                    nmsCfg.mode = (NmsMode)nmsMode;
+                    nmsChanged = true;
+                }
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("soft keeps piles of stuff apart better");
+                nmsChanged |= ImGui::Checkbox("Per Class NMS", &nmsCfg.classAware);
+                nmsChanged |= ImGui::SliderInt("Max Candidates", &nmsCfg.maxCandidates, 64, 4096);
+                if (ImGui::IsItemHovered()) ImGui::SetTooltip("caps postprocess cost on crowded frames");
+                if (nmsChanged) detector.SetNmsConfig(nmsCfg);
+            }
             
             ImGui::Separator();
             ImGui::Text("Udseende (Style)");
@@ -0,0 +1,284 @@
+#include "Association.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+// cost of a pair that isnt gated in, way above any real cost so hungarian only takes it when it has to
+const float kNoEdge = 1e4f;
+// grid never gets more cells than this, sparse huge frames just get bigger cells
+const int kMaxCells = 1 << 16;
+
+float Iou(const cv::Rect2f& a, const cv::Rect2f& b) {
+    float iw = std::min(a.x + a.width, b.x + b.width) - std::max(a.x, b.x);
+    float ih = std::min(a.y + a.height, b.y + b.height) - std::max(a.y, b.y);
+    if (iw <= 0.0f || ih <= 0.0f) return 0.0f;
+    float inter = iw * ih;
+    return inter / std::max(a.width * a.height + b.width * b.height - inter, 1e-6f);
+}
+
+} // namespace
+
+void Associator::Run(const cv::Rect2f* trackBoxes, const int* trackClasses, int trackCount,
+                     const cv::Rect2f* detBoxes, const int* detClasses, int detCount,
+                     const cv::Point2f* trackVariance) {
+    matches.clear();
+    unmatchedTracks.clear();
+    unmatchedDetections.clear();
+    trackUsed.assign(trackCount, 0);
+    detUsed.assign(detCount, 0);
+
+    if (trackCount > 0 && detCount > 0) {
+        BuildGrid(trackBoxes, trackVariance, trackCount);
+        Gate(trackBoxes, trackClasses, trackVariance, detBoxes, detClasses, detCount);
+
+        // union find over tracks [0, n) and detections [n, n + m), each component is solved alone
+        parent.resize(trackCount + detCount);
+        std::iota(parent.begin(), parent.end(), 0);
+        for (const Edge& e : edges) {
+            int a = Find(e.track);
+            int b = Find(trackCount + e.detection);
+            if (a != b) parent[a] = b;
+        }
+
+        // group edges by component with a counting sort
+        clusterOf.assign(trackCount + detCount, -1);
+        int clusters = 0;
+        for (const Edge& e : edges) {
+            int root = Find(e.track);
+            if (clusterOf[root] < 0) clusterOf[root] = clusters++;
+        }
+        clusterStart.assign(clusters + 1, 0);
+        for (const Edge& e : edges) clusterStart[clusterOf[Find(e.track)] + 1]++;
+        for (int c = 0; c < clusters; c++) clusterStart[c + 1] += clusterStart[c];
+        clustered.resize(edges.size());
+        for (const Edge& e : edges) clustered[clusterStart[clusterOf[Find(e.track)]]++] = e;
+        for (int c = clusters; c > 0; c--) clusterStart[c] = clusterStart[c - 1];
+        clusterStart[0] = 0;
+
+        for (int c = 0; c < clusters; c++) {
+            Edge* begin = clustered.data() + clusterStart[c];
+            int count = clusterStart[c + 1] - clusterStart[c];
+            if (count == 1) {
+                // lone pair, nothing to decide
+                matches.push_back({begin->track, begin->detection, begin->cost});
+                trackUsed[begin->track] = 1;
+                detUsed[begin->detection] = 1;
+            } else {
+                SolveCluster(begin, count);
+            }
+        }
+    }
+
+    for (int t = 0; t < trackCount; t++) if (!trackUsed[t]) unmatchedTracks.push_back(t);
+    for (int d = 0; d < detCount; d++) if (!detUsed[d]) unmatchedDetections.push_back(d);
+}
+
+int Associator::Find(int node) {
+    while (parent[node] != node) {
+        parent[node] = parent[parent[node]]; // path halving
+        node = parent[node];
+    }
+    return node;
+}
+
+void Associator::BuildGrid(const cv::Rect2f* trackBoxes, const cv::Point2f* trackVariance, int trackCount) {
+    float minX = std::numeric_limits<float>::max(), minY = minX;
+    float maxX = -minX, maxY = -minX;
+    for (int t = 0; t < trackCount; t++) {
+        float cx = trackBoxes[t].x + trackBoxes[t].width * 0.5f;
+        float cy = trackBoxes[t].y + trackBoxes[t].height * 0.5f;
+        minX = std::min(minX, cx); maxX = std::max(maxX, cx);
+        minY = std::min(minY, cy); maxY = std::max(maxY, cy);
+    }
+
+    // gate per track scales with its size (or the ellipse's long axis with variances), capped at maxDistance
+    trackGate.resize(trackCount);
+    float maxGate = 1.0f;
+    for (int t = 0; t < trackCount; t++) {
+        float size = std::max(trackBoxes[t].width, trackBoxes[t].height);
+        if (trackVariance) {
+            float var = std::max(trackVariance[t].x, trackVariance[t].y);
+            trackGate[t] = std::min(config.maxDistance, std::max(std::sqrt(config.gateChi2 * var), config.minGateScale * size));
+        } else {
+            trackGate[t] = config.gateScale > 0.0f ? std::min(config.maxDistance, config.gateScale * size) : config.maxDistance;
+        }
+        maxGate = std::max(maxGate, trackGate[t]);
+    }
+
+    // cell at least the biggest gate so a detection never has to look past its 3x3 neighbours
+    cellSize = maxGate;
+    while (((double)(maxX - minX) / cellSize + 1.0) * ((double)(maxY - minY) / cellSize + 1.0) > kMaxCells) cellSize *= 2.0f;
+    gridW = (int)((maxX - minX) / cellSize) + 1;
+    gridH = (int)((maxY - minY) / cellSize) + 1;
+    gridX0 = minX;
+    gridY0 = minY;
+
+    // counting sort tracks into cells
+    cellStart.assign(gridW * gridH + 1, 0);
+    trackCell.resize(trackCount);
+    for (int t = 0; t < trackCount; t++) {
+        int gx = (int)((trackBoxes[t].x + trackBoxes[t].width * 0.5f - gridX0) / cellSize);
+        int gy = (int)((trackBoxes[t].y + trackBoxes[t].height * 0.5f - gridY0) / cellSize);
+        trackCell[t] = gy * gridW + gx;
+        cellStart[trackCell[t] + 1]++;
+    }
+    for (int c = 0; c < gridW * gridH; c++) cellStart[c + 1] += cellStart[c];
+    cellTracks.resize(trackCount);
+    for (int t = 0; t < trackCount; t++) cellTracks[cellStart[trackCell[t]]++] = t;
+    for (int c = gridW * gridH; c > 0; c--) cellStart[c] = cellStart[c - 1];
+    cellStart[0] = 0;
+}
+
+void Associator::Gate(const cv::Rect2f* trackBoxes, const int* trackClasses, const cv::Point2f* trackVariance,
+                      const cv::Rect2f* detBoxes, const int* detClasses, int detCount) {
+    edges.clear();
+    const float maxDist = config.maxDistance;
+    const bool classAware = config.classAware && trackClasses && detClasses;
+    auto cheaper = [](const Edge& a, const Edge& b) { return a.cost < b.cost; };
+
+    for (int d = 0; d < detCount; d++) {
+        const cv::Rect2f& db = detBoxes[d];
+        float cx = db.x + db.width * 0.5f;
+        float cy = db.y + db.height * 0.5f;
+
+        // 3x3 cells around the detection, clipped to the grid
+        int gx = (int)std::floor((cx - gridX0) / cellSize);
+        int gy = (int)std::floor((cy - gridY0) / cellSize);
+        int x0 = std::max(gx - 1, 0), x1 = std::min(gx + 1, gridW - 1);
+        int y0 = std::max(gy - 1, 0), y1 = std::min(gy + 1, gridH - 1);
+
+        size_t first = edges.size();
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                int cell = y * gridW + x;
+                for (int k = cellStart[cell]; k < cellStart[cell + 1]; k++) {
+                    int t = cellTracks[k];
+                    if (classAware && trackClasses[t] != detClasses[d]) continue;
+
+                    const cv::Rect2f& tb = trackBoxes[t];
+                    float dx = tb.x + tb.width * 0.5f - cx;
+                    float dy = tb.y + tb.height * 0.5f - cy;
+                    float dist2 = dx * dx + dy * dy;
+                    if (dist2 >= trackGate[t] * trackGate[t]) continue;
+                    if (trackVariance) {
+                        float minGate = config.minGateScale * std::max(tb.width, tb.height);
+                        if (dist2 >= minGate * minGate && dx * dx / trackVariance[t].x + dy * dy / trackVariance[t].y >= config.gateChi2) continue;
+                    }
+
+                    float iou = Iou(tb, db);
+                    if (iou < config.minIou) continue;
+                    float c = config.iouWeight * (1.0f - iou) + config.distWeight * std::sqrt(dist2) / maxDist;
+                    edges.push_back({t, d, c});
+                }
+            }
+        }
+
+        // only the cheapest few per detection, the rest would just glue clusters together
+        size_t found = edges.size() - first;
+        if (config.maxCandidates > 0 && found > (size_t)config.maxCandidates) {
+            std::nth_element(edges.begin() + first, edges.begin() + first + config.maxCandidates - 1, edges.end(), cheaper);
+            edges.resize(first + config.maxCandidates);
+        }
+    }
+}
+
+void Associator::SolveCluster(Edge* clusterEdges, int count) {
+    // local ids for the tracks and detections in this cluster
+    rowMap.resize(trackUsed.size());
+    colMap.resize(detUsed.size());
+    rowIds.clear();
+    colIds.clear();
+    for (int i = 0; i < count; i++) {
+        rowMap[clusterEdges[i].track] = -1;
+        colMap[clusterEdges[i].detection] = -1;
+    }
+    for (int i = 0; i < count; i++) {
+        const Edge& e = clusterEdges[i];
+        if (rowMap[e.track] < 0) { rowMap[e.track] = (int)rowIds.size(); rowIds.push_back(e.track); }
+        if (colMap[e.detection] < 0) { colMap[e.detection] = (int)colIds.size(); colIds.push_back(e.detection); }
+    }
+
+    int tracks = (int)rowIds.size();
+    int dets = (int)colIds.size();
+    if (tracks > config.maxOptimalSize || dets > config.maxOptimalSize) {
+        SolveGreedy(clusterEdges, count);
+        return;
+    }
+
+    // hungarian wants rows <= cols, flip when there are more tracks than detections
+    const bool flip = tracks > dets;
+    const int n = flip ? dets : tracks;
+    const int m = flip ? tracks : dets;
+    cost.assign((size_t)(n + 1) * (m + 1), kNoEdge);
+    for (int i = 0; i < count; i++) {
+        const Edge& e = clusterEdges[i];
+        int r = rowMap[e.track] + 1;
+        int c = colMap[e.detection] + 1;
+        if (flip) std::swap(r, c);
+        cost[(size_t)r * (m + 1) + c] = e.cost;
+    }
+
+    // shortest augmenting path with potentials, O(n^2 m), 1 indexed
+    const float inf = std::numeric_limits<float>::max();
+    u.assign(n + 1, 0.0f);
+    v.assign(m + 1, 0.0f);
+    p.assign(m + 1, 0);
+    way.assign(m + 1, 0);
+    for (int i = 1; i <= n; i++) {
+        p[0] = i;
+        int j0 = 0;
+        minv.assign(m + 1, inf);
+        colDone.assign(m + 1, 0);
+        do {
+            colDone[j0] = 1;
+            int i0 = p[j0];
+            int j1 = 0;
+            float delta = inf;
+            const float* row = cost.data() + (size_t)i0 * (m + 1);
+            for (int j = 1; j <= m; j++) {
+                if (colDone[j]) continue;
+                float cur = row[j] - u[i0] - v[j];
+                if (cur < minv[j]) { minv[j] = cur; way[j] = j0; }
+                if (minv[j] < delta) { delta = minv[j]; j1 = j; }
+            }
+            for (int j = 0; j <= m; j++) {
+                if (colDone[j]) { u[p[j]] += delta; v[j] -= delta; }
+                else minv[j] -= delta;
+            }
+            j0 = j1;
+        } while (p[j0] != 0);
+        do {
+            int j1 = way[j0];
+            p[j0] = p[j1];
+            j0 = j1;
+        } while (j0 != 0);
+    }
+
+    for (int j = 1; j <= m; j++) {
+        int i = p[j];
+        if (i == 0) continue;
+        float c = cost[(size_t)i * (m + 1) + j];
+        if (c >= kNoEdge) continue; // filler pairing, not gated in
+        int r = flip ? j : i;
+        int col = flip ? i : j;
+        int track = rowIds[r - 1];
+        int det = colIds[col - 1];
+        matches.push_back({track, det, c});
+        trackUsed[track] = 1;
+        detUsed[det] = 1;
+    }
+}
+
+void Associator::SolveGreedy(Edge* clusterEdges, int count) {
+    std::sort(clusterEdges, clusterEdges + count, [](const Edge& a, const Edge& b) { return a.cost < b.cost; });
+    for (int i = 0; i < count; i++) {
+        const Edge& e = clusterEdges[i];
+        if (trackUsed[e.track] || detUsed[e.detection]) continue;
+        matches.push_back({e.track, e.detection, e.cost});
+        trackUsed[e.track] = 1;
+        detUsed[e.detection] = 1;
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+struct AssociationConfig {
+    float maxDistance = 250.0f; // px between centers, farther is a new object (same gate the greedy match had)
+    float gateScale = 4.0f;     // and within this many track sizes, small boxes dont reach across a crowd
+    int maxCandidates = 4;      // cheapest tracks kept per detection, keeps clusters small when crowded
+    float iouWeight = 1.0f;     // cost = iouWeight * (1 - iou) + distWeight * dist / maxDistance
+    float distWeight = 0.5f;
+    bool classAware = true;     // only same class pairs can match
+    int maxOptimalSize = 64;    // clusters up to this many tracks or dets get hungarian, bigger go greedy
+    float minIou = 0.0f;        // pairs overlapping less never match, 0 = only the distance gate
+    float gateChi2 = 9.21f;     // with track variances, mahalanobis gate (2 dof, 99%) instead of the size gate
+    float minGateScale = 0.5f;  // but never tighter than this many track sizes, a sudden turn stays inside
+};
+
+struct AssociationMatch {
+    int track;
+    int detection;
+    float cost;
+};
+
+// tracks <-> detections
+// 1. uniform grid over track centers, cell = biggest gate, a detection only looks at the 3x3 cells around it
+// 2. gated pairs get an iou + distance cost, union find splits them into independent clusters
+// 3. small clusters solved optimally (hungarian, shortest augmenting path), one to one pairs skip it
+// scratch buffers are kept between frames
+class Associator {
+public:
+    AssociationConfig config;
+
+    // classes may be null when not class aware
+    // trackVariance is the per axis innovation variance from a motion filter, may be null
+    void Run(const cv::Rect2f* trackBoxes, const int* trackClasses, int trackCount,
+             const cv::Rect2f* detBoxes, const int* detClasses, int detCount,
+             const cv::Point2f* trackVariance = nullptr);
+
+    const std::vector<AssociationMatch>& Matches() const { return matches; }
+    const std::vector<int>& UnmatchedTracks() const { return unmatchedTracks; }
+    const std::vector<int>& UnmatchedDetections() const { return unmatchedDetections; }
+
+private:
+    struct Edge {
+        int track;
+        int detection;
+        float cost;
+    };
+
+    void BuildGrid(const cv::Rect2f* trackBoxes, const cv::Point2f* trackVariance, int trackCount);
+    void Gate(const cv::Rect2f* trackBoxes, const int* trackClasses, const cv::Point2f* trackVariance,
+              const cv::Rect2f* detBoxes, const int* detClasses, int detCount);
+    void SolveCluster(Edge* edges, int count);
+    void SolveGreedy(Edge* edges, int count);
+    int Find(int node);
+
+    std::vector<AssociationMatch> matches;
+    std::vector<int> unmatchedTracks;
+    std::vector<int> unmatchedDetections;
+
+    // grid, tracks sorted by cell with a start offset per cell
+    float gridX0 = 0.0f, gridY0 = 0.0f, cellSize = 1.0f;
+    int gridW = 0, gridH = 0;
+    std::vector<int> cellStart;
+    std::vector<int> cellTracks;
+    std::vector<int> trackCell;
+    std::vector<float> trackGate; // per track gate radius
+
+    std::vector<Edge> edges;
+    std::vector<Edge> clustered;
+    std::vector<int> parent;
+    std::vector<int> clusterStart;
+    std::vector<int> clusterOf;
+    std::vector<uint8_t> trackUsed;
+    std::vector<uint8_t> detUsed;
+
+    // hungarian scratch
+    std::vector<int> rowIds, colIds;
+    std::vector<int> rowMap, colMap;
+    std::vector<float> cost;
+    std::vector<float> u, v, minv;
+    std::vector<int> p, way;
+    std::vector<uint8_t> colDone;
+};
@@ -0,0 +1,173 @@
+#include "BoxNms.hpp"
+#include <algorithm>
+#include <cmath>
+
+void NmsEngine::Run(const CandidateBoxes& boxes, std::vector<int>& keep, std::vector<float>& keepScores) {
+    keep.clear();
+    keepScores.clear();
+
+    int n = (int)boxes.Size();
+    if (n == 0) return;
+
+    const float* score = boxes.score.data();
+    auto byScore = [score](int a, int b) { return score[a] > score[b]; };
+
+    order.resize(n);
+    for (int i = 0; i < n; i++) order[i] = i;
+
+    // 1. hard cap, only the best maxCandidates go on
+    if (config.maxCandidates > 0 && n > config.maxCandidates) {
+        std::nth_element(order.begin(), order.begin() + config.maxCandidates, order.end(), byScore);
+        n = config.maxCandidates;
+        order.resize(n);
+    }
+
+    // 2. partition by class with a counting sort, classes dont interact
+    int numGroups = 1;
+    if (config.classAware) {
+        int maxClass = 0;
+        for (int i = 0; i < n; i++) maxClass = std::max(maxClass, boxes.classId[order[i]]);
+        numGroups = maxClass + 1;
+    }
+
+    classCounts.assign(numGroups + 1, 0);
+    if (config.classAware) {
+        for (int i = 0; i < n; i++) classCounts[boxes.classId[order[i]] + 1]++;
+        for (int g = 0; g < numGroups; g++) classCounts[g + 1] += classCounts[g];
+
+        grouped.resize(n);
+        for (int i = 0; i < n; i++) {
+            int idx = order[i];
+            grouped[classCounts[boxes.classId[idx]]++] = idx;
+        }
+        // counts got shifted by the placement, rebuild starts
+        for (int g = numGroups; g > 0; g--) classCounts[g] = classCounts[g - 1];
+        classCounts[0] = 0;
+    } else {
+        grouped.assign(order.begin(), order.end());
+        classCounts[1] = n;
+    }
+
+    // 3. per class top k + suppression
+    for (int g = 0; g < numGroups; g++) {
+        int begin = classCounts[g];
+        int count = classCounts[g + 1] - begin;
+        if (count == 0) continue;
+
+        int* idx = grouped.data() + begin;
+        if (config.topKPerClass > 0 && count > config.topKPerClass) {
+            std::partial_sort(idx, idx + config.topKPerClass, idx + count, byScore);
+            count = config.topKPerClass;
+        } else {
+            std::sort(idx, idx + count, byScore);
+        }
+
+        SuppressGroup(boxes, idx, count, keep, keepScores);
+    }
+
+    // 4. best first across classes, capped
+    int kept = (int)keep.size();
+    finalOrder.resize(kept);
+    for (int i = 0; i < kept; i++) finalOrder[i] = i;
+    const float* ks = keepScores.data();
+    auto byKeepScore = [ks](int a, int b) { return ks[a] > ks[b]; };
+    if (config.maxDetections > 0 && kept > config.maxDetections) {
+        std::partial_sort(finalOrder.begin(), finalOrder.begin() + config.maxDetections, finalOrder.end(), byKeepScore);
+        kept = config.maxDetections;
+    } else {
+        std::sort(finalOrder.begin(), finalOrder.end(), byKeepScore);
+    }
+
+    finalKeep.resize(kept);
+    finalScores.resize(kept);
+    for (int i = 0; i < kept; i++) {
+        finalKeep[i] = keep[finalOrder[i]];
+        finalScores[i] = keepScores[finalOrder[i]];
+    }
+    keep.assign(finalKeep.begin(), finalKeep.end());
+    keepScores.assign(finalScores.begin(), finalScores.end());
+}
+
+void NmsEngine::SuppressGroup(const CandidateBoxes& boxes, const int* idx, int count,
+                              std::vector<int>& keep, std::vector<float>& keepScores) {
+    gx1.resize(count); gy1.resize(count);
+    gx2.resize(count); gy2.resize(count);
+    garea.resize(count); gscore.resize(count);
+    suppressed.assign(count, 0);
+
+    for (int i = 0; i < count; i++) {
+        int k = idx[i];
+        gx1[i] = boxes.x1[k]; gy1[i] = boxes.y1[k];
+        gx2[i] = boxes.x2[k]; gy2[i] = boxes.y2[k];
+        garea[i] = (gx2[i] - gx1[i]) * (gy2[i] - gy1[i]);
+        gscore[i] = boxes.score[k];
+    }
+
+    const float thr = config.iouThreshold;
+    float* x1 = gx1.data(); float* y1 = gy1.data();
+    float* x2 = gx2.data(); float* y2 = gy2.data();
+    float* area = garea.data(); float* sc = gscore.data();
+    uint8_t* supp = suppressed.data();
+
+    if (config.mode == NmsMode::SoftGaussian) {
+        // pick best remaining, decay the rest, repeat
+        const float invSigma = 1.0f / std::max(config.softSigma, 1e-6f);
+        for (int step = 0; step < count; step++) {
+            int best = -1;
+            float bestScore = config.softScoreThreshold;
+            for (int j = 0; j < count; j++) {
+                if (!supp[j] && sc[j] >= bestScore) { bestScore = sc[j]; best = j; }
+            }
+            if (best < 0) break;
+
+            supp[best] = 1;
+            keep.push_back(idx[best]);
+            keepScores.push_back(sc[best]);
+
+            for (int j = 0; j < count; j++) {
+                float iw = std::max(0.0f, std::min(x2[best], x2[j]) - std::max(x1[best], x1[j]));
+                float ih = std::max(0.0f, std::min(y2[best], y2[j]) - std::max(y1[best], y1[j]));
+                float inter = iw * ih;
+                float iou = inter / std::max(area[best] + area[j] - inter, 1e-6f);
+                sc[j] *= std::exp(-(iou * iou) * invSigma);
+            }
+        }
+        return;
+    }
+
+    const bool diou = (config.mode == NmsMode::DIoU);
+    for (int i = 0; i < count; i++) {
+        if (supp[i]) continue;
+        keep.push_back(idx[i]);
+        keepScores.push_back(sc[i]);
+
+        const float ax1 = x1[i], ay1 = y1[i], ax2 = x2[i], ay2 = y2[i], aArea = area[i];
+        const float acx = (ax1 + ax2) * 0.5f, acy = (ay1 + ay2) * 0.5f;
+
+        // branch free so the compiler can vectorize it
+        if (!diou) {
+            for (int j = i + 1; j < count; j++) {
+                float iw = std::max(0.0f, std::min(ax2, x2[j]) - std::max(ax1, x1[j]));
+                float ih = std::max(0.0f, std::min(ay2, y2[j]) - std::max(ay1, y1[j]));
+                float inter = iw * ih;
+                // iou > thr without the divide
+                supp[j] |= (uint8_t)(inter > thr * (aArea + area[j] - inter));
+            }
+        } else {
+            for (int j = i + 1; j < count; j++) {
+                float iw = std::max(0.0f, std::min(ax2, x2[j]) - std::max(ax1, x1[j]));
+                float ih = std::max(0.0f, std::min(ay2, y2[j]) - std::max(ay1, y1[j]));
+                float inter = iw * ih;
+                float iou = inter / std::max(aArea + area[j] - inter, 1e-6f);
+
+                // center distance over enclosing box diagonal
+                float dx = (x1[j] + x2[j]) * 0.5f - acx;
+                float dy = (y1[j] + y2[j]) * 0.5f - acy;
+                float cw = std::max(ax2, x2[j]) - std::min(ax1, x1[j]);
+                float ch = std::max(ay2, y2[j]) - std::min(ay1, y1[j]);
+                float diag = std::max(cw * cw + ch * ch, 1e-6f);
+                supp[j] |= (uint8_t)(iou - (dx * dx + dy * dy) / diag > thr);
+            }
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "YoloDecoder.hpp"
+#include <cstdint>
+#include <vector>
+
+enum class NmsMode {
+    Hard,        // classic greedy iou suppression
+    SoftGaussian, // decay scores instead of dropping, keeps piles of bottles apart
+    DIoU         // iou minus center distance penalty, better on touching objects
+};
+
+struct NmsConfig {
+    float iouThreshold = 0.45f;
+    NmsMode mode = NmsMode::Hard;
+    bool classAware = true;        // only boxes of the same class suppress each other
+    int maxCandidates = 2048;      // hard cap on input, keeps worst case bounded
+    int topKPerClass = 256;        // best k per class go into suppression
+    int maxDetections = 128;       // cap on output
+    float softSigma = 0.5f;
+    float softScoreThreshold = 0.25f; // soft mode drops boxes decayed below this
+};
+
+// in house nms over CandidateBoxes
+// cost per frame is bounded by maxCandidates and topKPerClass no matter how crowded
+// scratch buffers are kept between frames
+class NmsEngine {
+public:
+    NmsConfig config;
+
+    // keep gets indices into boxes best first, scores are the final (soft decayed) scores
+    void Run(const CandidateBoxes& boxes, std::vector<int>& keep, std::vector<float>& keepScores);
+
+private:
+    void SuppressGroup(const CandidateBoxes& boxes, const int* idx, int count,
+                       std::vector<int>& keep, std::vector<float>& keepScores);
+
+    std::vector<int> order;
+    std::vector<int> grouped;
+    std::vector<int> classCounts;
+
+    // group gathered into contiguous soa so the inner loop streams
+    std::vector<float> gx1, gy1, gx2, gy2, garea, gscore;
+    std::vector<uint8_t> suppressed;
+    std::vector<int> finalOrder;
+    std::vector<int> finalKeep;
+    std::vector<float> finalScores;
+};
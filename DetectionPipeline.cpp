@@ -0,0 +1,376 @@
+#include "DetectionPipeline.hpp"
+#include "analytics/PerformanceLogger.hpp"
+#include "TraceRecorder.hpp"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+double MsSince(FrameClock::time_point start) {
+    return std::chrono::duration<double, std::milli>(FrameClock::now() - start).count();
+}
+
+void Ema(std::atomic<double>& value, double sample, double alpha = 0.1) {
+    // single writer per value, no cas needed
+    double prev = value.load(std::memory_order_relaxed);
+    value.store(prev <= 0.0 ? sample : prev + (sample - prev) * alpha, std::memory_order_relaxed);
+}
+
+int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(FrameClock::now().time_since_epoch()).count();
+}
+
+int64_t ToUs(FrameClock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(t.time_since_epoch()).count();
+}
+
+// stage stamp relative to capture, 0 stays 0 (stage didnt run)
+uint32_t SinceCaptureUs(int64_t stampUs, int64_t captureUs) {
+    if (stampUs == 0 || stampUs < captureUs) return 0;
+    return (uint32_t)std::min<int64_t>(stampUs - captureUs, UINT32_MAX);
+}
+
+} // namespace
+
+void StageWake::Notify() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        seq++;
+    }
+    cv.notify_all();
+}
+
+void StageWake::WaitFor(uint64_t& seen, int timeoutMs) {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&] { return seq != seen; });
+    seen = seq;
+}
+
+void StageWake::WaitUntil(uint64_t& seen, FrameClock::time_point until) {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait_until(lock, until, [&] { return seq != seen; });
+    seen = seq;
+}
+
+DetectionPipeline::DetectionPipeline(TrashDetector& detector) : detector(detector) {}
+
+DetectionPipeline::~DetectionPipeline() {
+    Stop();
+}
+
+void DetectionPipeline::Start(Callbacks cb, PerformanceLogger* logger, TelemetryWriter* telemetryWriter) {
+    if (running) return;
+    callbacks = std::move(cb);
+    perfLogger = logger;
+    telemetry = telemetryWriter;
+    detector.AttachPipeline();
+    running = true;
+    threads[StageCapture] = std::thread(&DetectionPipeline::CaptureLoop, this);
+    threads[StagePreprocess] = std::thread(&DetectionPipeline::PreprocessLoop, this);
+    threads[StageInfer] = std::thread(&DetectionPipeline::InferLoop, this);
+    threads[StagePost] = std::thread(&DetectionPipeline::PostLoop, this);
+}
+
+void DetectionPipeline::Stop() {
+    if (!running) return;
+    running = false;
+    captureWake.Notify();
+    inferWake.Notify();
+    postWake.Notify();
+    inferFree.Notify();
+    for (auto& t : threads) {
+        if (t.joinable()) t.join();
+    }
+    detector.DetachPipeline();
+
+    // frames left in the rings give their io slots back here
+    CapturedFrame frame;
+    StageItem item;
+    while (captureQueue.TryPop(frame)) {}
+    while (inferQueue.TryPop(item)) {}
+    while (postQueue.TryPop(item)) {}
+    while (flowQueue.TryPop(frame)) {}
+    while (staticQueue.TryPop(frame)) {}
+    motionGate.Reset();
+    lastPublished.clear();
+}
+
+void DetectionPipeline::RecordStage(PipelineStage stage, FrameClock::time_point start) {
+    Ema(stats.stageMs[stage], MsSince(start));
+}
+
+void DetectionPipeline::CaptureLoop() {
+    TraceRecorder::SetThreadName("capture");
+    FramePacer pacer;
+    uint64_t inferSeen = 0;
+    int sinceKeyframe = 0;
+
+    while (running) {
+        int fps = targetFps;
+        if (pacer.GetFps() != fps) pacer.SetFps(fps);
+        pacer.Wait();
+
+        bool detecting = detectionEnabled && detector.IsLoaded();
+        bool keyframing = detecting && Keyframing();
+        if (detecting && !keyframing) {
+            // dont run ahead of inference, a frame grabbed now would only go stale in a queue
+            while (running && (!captureQueue.Empty() || !inferQueue.Empty())) inferFree.WaitFor(inferSeen, 2);
+
+            // start late enough that capture + preprocess end right when the running inference does
+            int64_t startNs = inferStartNs;
+            if (startNs != 0) {
+                double elapsed = (NowNs() - startNs) / 1e6;
+                double remaining = stats.stageMs[StageInfer].load() - elapsed;
+                double lead = stats.stageMs[StageCapture].load() + stats.stageMs[StagePreprocess].load();
+                int waitMs = (int)(remaining - lead);
+                if (waitMs >= 1) inferFree.WaitFor(inferSeen, waitMs); // cut short if infer finishes early
+            }
+        }
+        if (!running) break;
+
+        auto t0 = FrameClock::now();
+        CapturedFrame frame;
+        if (!callbacks.grab || !callbacks.grab(frame)) continue;
+        RecordStage(StageCapture, t0);
+        stats.captured++;
+        // recorded by hand, the frame id is only known once grab returned
+        TraceRecorder::SetFrame(frame.frameId);
+        if (TraceRecorder::Get().IsEnabled()) {
+            int64_t startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(t0.time_since_epoch()).count();
+            TraceRecorder::Get().Record("capture", startNs, NowNs() - startNs);
+        }
+
+        // keyframe mode, capture never waits on inference, the detector gets a frame every Nth one
+        // (later if it is still busy), the others go straight to post and get tracked by flow
+        if (keyframing) {
+            bool detectorBusy = !captureQueue.Empty() || !inferQueue.Empty() || inferStartNs != 0;
+            if (++sinceKeyframe < keyframeInterval || detectorBusy) {
+                if (flowQueue.Push(std::move(frame))) stats.dropped[StagePost]++;
+                postWake.Notify();
+                continue;
+            }
+            sinceKeyframe = 0;
+        }
+
+        // nothing moved since the last detected frame, the boxes we have are still right
+        if (detecting && motionGateEnabled) {
+            stats.gateChecked++;
+            bool changed;
+            {
+                TRACE_SCOPE("motion_gate");
+                changed = motionGate.Check(frame.image);
+            }
+            if (perfLogger) perfLogger->RecordMotionGate(!changed);
+            if (!changed) {
+                stats.gateSkipped++;
+                LatestSlot<CapturedFrame>& to = keyframing ? flowQueue : staticQueue;
+                if (to.Push(std::move(frame))) stats.dropped[StagePost]++;
+                postWake.Notify();
+                // keep the cadence inference would have had, a static screen shouldnt spin capture
+                if (!keyframing) {
+                    int waitMs = (int)stats.stageMs[StageInfer].load();
+                    if (waitMs >= 1) std::this_thread::sleep_for(std::chrono::milliseconds(waitMs));
+                }
+                continue;
+            }
+        } else {
+            motionGate.Reset(); // stale reference after being off
+        }
+
+        // preprocess hasnt taken the last one yet, this one replaces it
+        if (captureQueue.Push(std::move(frame))) stats.dropped[StagePreprocess]++;
+        captureWake.Notify();
+
+        // nothing to feed, preview only, dont burn cpu
+        if (!detecting && fps <= 0) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+}
+
+void DetectionPipeline::PreprocessLoop() {
+    TraceRecorder::SetThreadName("preprocess");
+    uint64_t seen = 0;
+    while (running) {
+        CapturedFrame frame;
+        if (!captureQueue.TryPop(frame)) {
+            captureWake.WaitFor(seen, 10);
+            continue;
+        }
+
+        auto t0 = FrameClock::now();
+        StageItem item;
+        item.frame = std::move(frame);
+        TraceRecorder::SetFrame(item.frame.frameId);
+
+        // no job means no detection, the frame still goes through for the preview
+        if (detectionEnabled && detector.IsLoaded() && !item.frame.image.empty()) {
+            TRACE_SCOPE("preprocess");
+            if (callbacks.beforePrepare) callbacks.beforePrepare(item.frame.image);
+            if (!detector.Prepare(item.frame.image, item.job)) {
+                // all io slots in flight, publishing it empty would blank the boxes
+                stats.dropped[StageInfer]++;
+                continue;
+            }
+            RecordStage(StagePreprocess, t0);
+            if (telemetry) {
+                item.preprocessStartUs = ToUs(t0);
+                item.preprocessDoneUs = TelemetryNowUs();
+            }
+        }
+
+        if (inferQueue.Push(std::move(item))) stats.dropped[StageInfer]++;
+        inferWake.Notify();
+    }
+}
+
+void DetectionPipeline::InferLoop() {
+    TraceRecorder::SetThreadName("infer");
+    uint64_t seen = 0;
+    while (running) {
+        StageItem item;
+        if (!inferQueue.TryPop(item)) {
+            inferWake.WaitFor(seen, 10);
+            continue;
+        }
+
+        TraceRecorder::SetFrame(item.frame.frameId);
+        if (item.job.Valid()) {
+            TRACE_SCOPE("infer");
+            auto t0 = FrameClock::now();
+            inferStartNs = NowNs();
+            inferFree.Notify();
+
+            detector.Infer(item.job);
+
+            inferStartNs = 0;
+            RecordStage(StageInfer, t0);
+            if (telemetry) {
+                item.inferStartUs = ToUs(t0);
+                item.inferDoneUs = TelemetryNowUs();
+            }
+            if (perfLogger) perfLogger->RecordInference(MsSince(t0));
+        }
+        inferFree.Notify();
+
+        if (postQueue.Push(std::move(item))) stats.dropped[StagePost]++;
+        postWake.Notify();
+    }
+}
+
+void DetectionPipeline::PostLoop() {
+    TraceRecorder::SetThreadName("post");
+    uint64_t seen = 0;
+    while (running) {
+        StageItem item;
+        if (!postQueue.TryPop(item)) {
+            // no detector result waiting, catch the tracks up with the newest skipped frame
+            CapturedFrame flowFrame;
+            if (flowQueue.TryPop(flowFrame)) {
+                PostFlowFrame(flowFrame);
+                continue;
+            }
+            if (staticQueue.TryPop(flowFrame)) {
+                PostStaticFrame(flowFrame);
+                continue;
+            }
+            postWake.WaitFor(seen, 10);
+            continue;
+        }
+
+        TraceRecorder::SetFrame(item.frame.frameId);
+        auto t0 = FrameClock::now();
+        // reused every frame, publish swaps buffers out of it so none get freed or allocated
+        PipelineResult& result = postResult;
+        result.detections.clear();
+        postLow.clear();
+        result.frame = std::move(item.frame);
+        result.stateTime = result.frame.captureTime;
+        if (telemetry) {
+            int64_t captureUs = ToUs(result.frame.captureTime);
+            postTelemetry = TelemetryRecord();
+            postTelemetry.kind = TelemetryDetected;
+            postTelemetry.preprocessStartUs = SinceCaptureUs(item.preprocessStartUs, captureUs);
+            postTelemetry.preprocessDoneUs = SinceCaptureUs(item.preprocessDoneUs, captureUs);
+            postTelemetry.inferStartUs = SinceCaptureUs(item.inferStartUs, captureUs);
+            postTelemetry.inferDoneUs = SinceCaptureUs(item.inferDoneUs, captureUs);
+            postTelemetry.postStartUs = SinceCaptureUs(ToUs(t0), captureUs);
+            if (item.job.Valid()) {
+                postTelemetry.inputW = (uint16_t)item.job.io->width;
+                postTelemetry.inputH = (uint16_t)item.job.io->height;
+                postTelemetry.threads = (uint8_t)std::min(std::max(item.job.model->threads, 0), 255);
+            }
+        }
+        if (item.job.Valid()) {
+            // weak boxes only matter when someone tracks
+            float low = callbacks.track ? lowConfThreshold.load() : 0.0f;
+            detector.Decode(item.job, confThreshold, nmsThreshold, result.detections, 0, low > 0.0f ? &postLow : nullptr, low);
+            TRACE_SCOPE("track");
+            if (callbacks.track) callbacks.track(result, postLow, Keyframing());
+        }
+        item.job.Release(); // slot back before publish so preprocess never waits on us
+        RecordStage(StagePost, t0);
+
+        Publish(result);
+    }
+}
+
+void DetectionPipeline::PostFlowFrame(CapturedFrame& frame) {
+    PipelineResult& result = postResult;
+    result.detections.clear();
+    if (!Keyframing() || frame.image.empty()) return; // mode got switched off, its stale
+    TraceRecorder::SetFrame(frame.frameId);
+    result.frame = std::move(frame);
+    result.stateTime = result.frame.captureTime;
+    if (telemetry) {
+        postTelemetry = TelemetryRecord();
+        postTelemetry.kind = TelemetryFlow;
+        postTelemetry.postStartUs = SinceCaptureUs(TelemetryNowUs(), ToUs(result.frame.captureTime));
+    }
+    callbacks.propagate(result);
+    stats.flowFrames++;
+
+    Publish(result);
+}
+
+void DetectionPipeline::PostStaticFrame(CapturedFrame& frame) {
+    PipelineResult& result = postResult;
+    if (frame.image.empty()) return;
+    TraceRecorder::SetFrame(frame.frameId);
+    // same boxes, standing still, and they describe this frame now
+    result.detections.assign(lastPublished.begin(), lastPublished.end());
+    for (auto& det : result.detections) {
+        det.velocity = cv::Point2f();
+        det.acceleration = cv::Point2f();
+    }
+    result.frame = std::move(frame);
+    result.stateTime = result.frame.captureTime;
+    if (telemetry) {
+        postTelemetry = TelemetryRecord();
+        postTelemetry.kind = TelemetryStatic;
+        postTelemetry.postStartUs = SinceCaptureUs(TelemetryNowUs(), ToUs(result.frame.captureTime));
+    }
+    Publish(result);
+}
+
+void DetectionPipeline::Publish(PipelineResult& result) {
+    TRACE_SCOPE("publish");
+    lastPublished.assign(result.detections.begin(), result.detections.end()); // capacity kept, no alloc once warm
+    if (telemetry) {
+        // before the callback, it may swap the detections out
+        postTelemetry.frameId = result.frame.frameId;
+        postTelemetry.captureUs = ToUs(result.frame.captureTime);
+        postTelemetry.detections = (uint16_t)std::min<size_t>(result.detections.size(), UINT16_MAX);
+        postTelemetry.frameW = (uint16_t)result.frame.image.cols;
+        postTelemetry.frameH = (uint16_t)result.frame.image.rows;
+        postTelemetry.streamId = 0;
+    }
+    if (callbacks.publish) callbacks.publish(result);
+
+    stats.completed++;
+    Ema(stats.latencyMs, MsSince(result.frame.captureTime));
+    if (telemetry) {
+        // after the callback, publish time includes the handoff to the renderer
+        postTelemetry.publishUs = SinceCaptureUs(TelemetryNowUs(), postTelemetry.captureUs);
+        telemetry->Push(postTelemetry);
+    }
+    result.frame = CapturedFrame(); // pooled buffer goes back now, not a frame later
+}
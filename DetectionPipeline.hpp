@@ -0,0 +1,139 @@
+#pragma once
+
+#include "TrashDetector.hpp"
+#include "FrameSource.hpp"
+#include "LatestSlot.hpp"
+#include "MotionGate.hpp"
+#include "TelemetryLog.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class PerformanceLogger;
+
+enum PipelineStage { StageCapture, StagePreprocess, StageInfer, StagePost, StageCount };
+
+struct PipelineStats {
+    std::atomic<uint64_t> captured{0};
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> dropped[StageCount] = {}; // stale frames thrown away in front of each stage
+    std::atomic<double> stageMs[StageCount] = {};   // ema time spent in each stage
+    std::atomic<double> latencyMs{0.0};              // ema capture to publish
+    std::atomic<uint64_t> flowFrames{0};             // keyframe mode, frames published from optical flow
+    std::atomic<uint64_t> gateChecked{0};            // frames the motion gate looked at
+    std::atomic<uint64_t> gateSkipped{0};            // of those, static ones the detector never saw
+    double GateSkipRate() const { uint64_t n = gateChecked; return n ? (double)gateSkipped / n : 0.0; }
+};
+
+// sleep until the thread before us pushed something, queues stay lock free
+struct StageWake {
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint64_t seq = 0;
+    void Notify();
+    void WaitFor(uint64_t& seen, int timeoutMs);
+    void WaitUntil(uint64_t& seen, FrameClock::time_point until);
+};
+
+// finished frame handed to the app
+struct PipelineResult {
+    CapturedFrame frame;
+    std::vector<Detection> detections;
+    // capture time the boxes describe, frame.captureTime unless the tracker moved them onto a newer frame
+    FrameClock::time_point stateTime;
+};
+
+// capture -> preprocess -> infer -> post on four threads
+// stages hand frames on through LatestSlot, a newer frame replaces one the next stage hasnt taken yet
+// capture starts just in time for the next free inference so frames dont go stale waiting in a queue
+// keyframe mode: capture runs free, every Nth frame goes to the detector, the rest straight to post for propagate
+// motion gate: frames where nothing changed since the last detected one skip the detector,
+// post republishes the last boxes on them (or propagate in keyframe mode)
+class DetectionPipeline {
+public:
+    struct Callbacks {
+        std::function<bool(CapturedFrame&)> grab;              // capture thread
+        std::function<void(const cv::Mat&)> beforePrepare;     // preprocess thread, pick input res etc
+        // post thread, prediction etc: result holds the frame and its strong boxes, weak boxes separate,
+        // keyframe = detector frame in keyframe mode, flow frames may have got ahead of it
+        std::function<void(PipelineResult&, std::vector<Detection>&, bool)> track;
+        // post thread, keyframe mode: a frame the detector skipped, fill in the tracks moved onto it
+        std::function<void(PipelineResult&)> propagate;
+        std::function<void(PipelineResult&)> publish;          // post thread, may swap the detections out
+    };
+
+    explicit DetectionPipeline(TrashDetector& detector);
+    ~DetectionPipeline();
+
+    // telemetry gets one record per published frame from the post thread, may be null
+    void Start(Callbacks callbacks, PerformanceLogger* perfLogger = nullptr, TelemetryWriter* telemetry = nullptr);
+    void Stop();
+    bool IsRunning() const { return running; }
+
+    // knobs, read every frame
+    std::atomic<bool> detectionEnabled{true};
+    std::atomic<float> confThreshold{0.5f};
+    std::atomic<float> nmsThreshold{0.45f};
+    std::atomic<float> lowConfThreshold{0.1f}; // boxes between this and conf only go to the tracker, 0 = off
+    std::atomic<int> targetFps{0}; // 0 unlimited
+    std::atomic<int> keyframeInterval{1}; // detector on every Nth frame, the rest go to propagate, 1 = every frame
+    std::atomic<bool> motionGateEnabled{false}; // skip the detector on static frames
+
+    // capture thread reads it every frame, same as the other configs
+    MotionGateConfig& GetMotionGateConfig() { return motionGate.config; }
+
+    const PipelineStats& Stats() const { return stats; }
+
+private:
+    // frame plus the detector job riding along with it
+    struct StageItem {
+        CapturedFrame frame;
+        DetectJob job;
+        int64_t preprocessStartUs = 0; // steady us, for telemetry
+        int64_t preprocessDoneUs = 0;
+        int64_t inferStartUs = 0;
+        int64_t inferDoneUs = 0;
+    };
+
+    void CaptureLoop();
+    void PreprocessLoop();
+    void InferLoop();
+    void PostLoop();
+
+    void RecordStage(PipelineStage stage, FrameClock::time_point start);
+    bool Keyframing() const { return keyframeInterval > 1 && callbacks.propagate; }
+    void PostFlowFrame(CapturedFrame& frame);
+    void PostStaticFrame(CapturedFrame& frame);
+    void Publish(PipelineResult& result);
+
+    TrashDetector& detector;
+    PerformanceLogger* perfLogger = nullptr;
+    TelemetryWriter* telemetry = nullptr;
+    Callbacks callbacks;
+    PipelineStats stats;
+
+    std::atomic<bool> running{false};
+    std::thread threads[StageCount];
+
+    LatestSlot<CapturedFrame> captureQueue;
+    LatestSlot<StageItem> inferQueue;
+    LatestSlot<StageItem> postQueue;
+    LatestSlot<CapturedFrame> flowQueue; // capture -> post, keyframe mode frames that skip the detector
+    LatestSlot<CapturedFrame> staticQueue; // capture -> post, motion gate said nothing changed
+    StageWake captureWake; // something for preprocess
+    StageWake inferWake;   // something for infer
+    StageWake postWake;    // something for post
+    StageWake inferFree;   // infer picked up a frame, capture can plan the next one
+
+    PipelineResult postResult; // post thread only
+    TelemetryRecord postTelemetry; // post thread only, filled along the way, pushed in Publish
+    std::vector<Detection> postLow; // weak boxes for the track callback, post thread only
+    std::vector<Detection> lastPublished; // post thread only, what static frames get
+    MotionGate motionGate; // capture thread only
+
+    // when the running inference started, 0 if idle
+    std::atomic<int64_t> inferStartNs{0};
+};
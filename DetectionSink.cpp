@@ -0,0 +1,250 @@
+#include "DetectionSink.hpp"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+namespace {
+
+// monotonic stamp in us, same clock as capture so consumers can diff them
+int64_t ToMicros(FrameClock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(t.time_since_epoch()).count();
+}
+
+void AppendJsonString(std::string& out, const char* s) {
+    out += '"';
+    for (; *s; s++) {
+        char c = *s;
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if ((unsigned char)c < 0x20) { char buf[8]; snprintf(buf, sizeof(buf), "\\u%04x", c); out += buf; }
+        else out += c;
+    }
+    out += '"';
+}
+
+template <typename T>
+void AppendRaw(std::string& out, T value) {
+    // all our targets are little endian
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+} // namespace
+
+bool StdoutStream::Send(const void* data, size_t size) {
+    if (fwrite(data, 1, size, stdout) != size) return false;
+    fflush(stdout);
+    return true;
+}
+
+#ifndef _WIN32
+
+UnixSocketStream::~UnixSocketStream() {
+    stopping = true;
+    // shutdown wakes accept
+    if (listenFd >= 0) shutdown(listenFd, SHUT_RDWR);
+    if (acceptThread.joinable()) acceptThread.join();
+    if (listenFd >= 0) close(listenFd);
+    int fd = clientFd.exchange(-1);
+    if (fd >= 0) close(fd);
+    if (!path.empty()) unlink(path.c_str());
+}
+
+bool UnixSocketStream::Open(const std::string& socketPath, std::string* errorMsg) {
+    sockaddr_un addr{};
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        if (errorMsg) *errorMsg = "socket path too long";
+        return false;
+    }
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        if (errorMsg) *errorMsg = std::string("socket failed ") + strerror(errno);
+        return false;
+    }
+
+    // left over from a crashed run
+    unlink(socketPath.c_str());
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+    if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, 1) < 0) {
+        if (errorMsg) *errorMsg = std::string("bind/listen failed ") + strerror(errno);
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    path = socketPath;
+    acceptThread = std::thread(&UnixSocketStream::AcceptLoop, this);
+    return true;
+}
+
+void UnixSocketStream::AcceptLoop() {
+    while (!stopping) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (stopping) break;
+            continue;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        // newest client wins
+        int old = clientFd.exchange(fd);
+        if (old >= 0) close(old);
+        std::cerr << "client connected on " << path << std::endl;
+    }
+}
+
+bool UnixSocketStream::Send(const void* data, size_t size) {
+    int fd = clientFd.load();
+    if (fd < 0) return false;
+    if (fd != tailFd) {
+        // tail belonged to a client that got replaced
+        tail.clear();
+        tailFd = fd;
+    }
+
+    // rest of an earlier record goes first or the framing breaks
+    if (!tail.empty()) {
+        ssize_t n = send(fd, tail.data(), tail.size(), MSG_NOSIGNAL);
+        if (n > 0) tail.erase(0, (size_t)n);
+        else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            DropClient(fd);
+            return false;
+        }
+        if (!tail.empty()) {
+            // stopped reading mid record, let it go instead of holding records for it forever
+            if (FrameClock::now() - tailSince > std::chrono::milliseconds(kStallMs)) DropClient(fd);
+            return false; // still stuck, skip this one
+        }
+    }
+
+    // whole record or nothing so the stream stays parseable
+    ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+    if (sent == (ssize_t)size) return true;
+    if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return false; // slow client, skip this one
+    if (sent < 0) {
+        DropClient(fd);
+        return false;
+    }
+
+    // partial write, the rest waits for the next call, never blocks the post thread
+    tail.assign((const char*)data + sent, size - (size_t)sent);
+    tailSince = FrameClock::now();
+    return true;
+}
+
+void UnixSocketStream::DropClient(int fd) {
+    // gone
+    if (clientFd.compare_exchange_strong(fd, -1)) close(fd);
+    tail.clear();
+    tailFd = -1;
+}
+
+#else
+
+UnixSocketStream::~UnixSocketStream() {}
+
+bool UnixSocketStream::Open(const std::string&, std::string* errorMsg) {
+    if (errorMsg) *errorMsg = "unix sockets are only supported on linux";
+    return false;
+}
+
+bool UnixSocketStream::Send(const void*, size_t) { return false; }
+
+void UnixSocketStream::DropClient(int) {}
+
+void UnixSocketStream::AcceptLoop() {}
+
+#endif
+
+std::unique_ptr<OutputStream> CreateOutputStream(const std::string& spec, std::string* errorMsg) {
+    if (spec.empty() || spec == "stdout" || spec == "-") return std::make_unique<StdoutStream>();
+
+    const std::string prefix = "unix:";
+    if (spec.compare(0, prefix.size(), prefix) == 0) {
+        auto stream = std::make_unique<UnixSocketStream>();
+        if (!stream->Open(spec.substr(prefix.size()), errorMsg)) return nullptr;
+        return stream;
+    }
+
+    if (errorMsg) *errorMsg = "unknown output " + spec + " (stdout or unix:/path)";
+    return nullptr;
+}
+
+void DetectionSink::Write(const DetectionRecord& record) {
+    scratch.clear();
+    Encode(record, scratch);
+    if (stream->Send(scratch.data(), scratch.size())) written++;
+    else dropped++;
+}
+
+void NdjsonSink::Encode(const DetectionRecord& record, std::string& out) {
+    char buf[160];
+    snprintf(buf, sizeof(buf), "{\"frame\":%llu,", (unsigned long long)record.frameId);
+    out += buf;
+    if (record.streamId >= 0) {
+        snprintf(buf, sizeof(buf), "\"stream\":%d,", record.streamId);
+        out += buf;
+    }
+    snprintf(buf, sizeof(buf), "\"t_us\":%lld,\"latency_ms\":%.2f,\"w\":%d,\"h\":%d,\"dets\":[",
+             (long long)ToMicros(record.captureTime), record.latencyMs, record.frameW, record.frameH);
+    out += buf;
+
+    if (record.detections) {
+        bool first = true;
+        for (const auto& det : *record.detections) {
+            if (!first) out += ',';
+            first = false;
+            snprintf(buf, sizeof(buf), "{\"x\":%.1f,\"y\":%.1f,\"w\":%.1f,\"h\":%.1f,\"conf\":%.3f,\"cls\":%d,\"label\":",
+                     det.box.x, det.box.y, det.box.width, det.box.height, det.confidence, det.classId);
+            out += buf;
+            AppendJsonString(out, det.label);
+            snprintf(buf, sizeof(buf), ",\"id\":%d}", det.trackingId);
+            out += buf;
+        }
+    }
+    out += "]}\n";
+}
+
+void BinarySink::Encode(const DetectionRecord& record, std::string& out) {
+    size_t count = record.detections ? record.detections->size() : 0;
+    if (count > 0xFFFF) count = 0xFFFF;
+
+    AppendRaw<uint32_t>(out, kMagic);
+    AppendRaw<uint16_t>(out, record.streamId >= 0 ? kVersionStreams : kVersion);
+    AppendRaw<uint16_t>(out, (uint16_t)count);
+    AppendRaw<uint64_t>(out, record.frameId);
+    AppendRaw<int64_t>(out, ToMicros(record.captureTime));
+    AppendRaw<uint32_t>(out, (uint32_t)(record.latencyMs * 1000.0));
+    AppendRaw<uint16_t>(out, (uint16_t)record.frameW);
+    AppendRaw<uint16_t>(out, (uint16_t)record.frameH);
+    if (record.streamId >= 0) {
+        AppendRaw<uint16_t>(out, (uint16_t)record.streamId);
+        AppendRaw<uint16_t>(out, 0);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const Detection& det = (*record.detections)[i];
+        AppendRaw<float>(out, det.box.x);
+        AppendRaw<float>(out, det.box.y);
+        AppendRaw<float>(out, det.box.width);
+        AppendRaw<float>(out, det.box.height);
+        AppendRaw<float>(out, det.confidence);
+        AppendRaw<int16_t>(out, (int16_t)det.classId);
+        AppendRaw<int32_t>(out, (int32_t)det.trackingId);
+    }
+}
+
+std::unique_ptr<DetectionSink> CreateDetectionSink(const std::string& format, std::unique_ptr<OutputStream> stream, std::string* errorMsg) {
+    if (!stream) return nullptr;
+    if (format.empty() || format == "ndjson" || format == "json") return std::make_unique<NdjsonSink>(std::move(stream));
+    if (format == "binary" || format == "bin") return std::make_unique<BinarySink>(std::move(stream));
+    if (errorMsg) *errorMsg = "unknown format " + format + " (ndjson or binary)";
+    return nullptr;
+}
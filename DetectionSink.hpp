@@ -0,0 +1,112 @@
+#pragma once
+
+#include "TrashDetector.hpp"
+#include "FrameSource.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// one frame worth of output
+struct DetectionRecord {
+    uint64_t frameId = 0;
+    int streamId = -1;               // multi stream runs only, -1 leaves it out
+    FrameClock::time_point captureTime;
+    double latencyMs = 0.0;          // capture to now
+    int frameW = 0;
+    int frameH = 0;
+    const std::vector<Detection>* detections = nullptr;
+};
+
+// where the bytes go
+class OutputStream {
+public:
+    virtual ~OutputStream() = default;
+    // false means the bytes were dropped (no client, client too slow, broken pipe)
+    virtual bool Send(const void* data, size_t size) = 0;
+};
+
+// stdout, blocking, whoever reads the pipe sets the pace
+class StdoutStream : public OutputStream {
+public:
+    bool Send(const void* data, size_t size) override;
+};
+
+// listens on a unix socket path, one client at a time
+// sends never block the pipeline, a slow client just loses records
+// a partly sent record is finished on later sends, a client stuck mid record for kStallMs gets dropped
+class UnixSocketStream : public OutputStream {
+public:
+    ~UnixSocketStream() override;
+    bool Open(const std::string& path, std::string* errorMsg = nullptr);
+    bool Send(const void* data, size_t size) override;
+
+private:
+    static constexpr int kStallMs = 1000;
+
+    void AcceptLoop();
+    void DropClient(int fd);
+
+    std::string path;
+    int listenFd = -1;
+    std::atomic<int> clientFd{-1};
+    std::atomic<bool> stopping{false};
+    std::thread acceptThread;
+
+    // sender thread only
+    std::string tail;                  // unsent rest of the last record
+    int tailFd = -1;                   // client the tail is for
+    FrameClock::time_point tailSince;
+};
+
+// stdout or unix:/path
+std::unique_ptr<OutputStream> CreateOutputStream(const std::string& spec, std::string* errorMsg = nullptr);
+
+// encodes records onto a stream
+class DetectionSink {
+public:
+    explicit DetectionSink(std::unique_ptr<OutputStream> stream) : stream(std::move(stream)) {}
+    virtual ~DetectionSink() = default;
+
+    void Write(const DetectionRecord& record);
+    uint64_t Written() const { return written; }
+    uint64_t Dropped() const { return dropped; }
+
+protected:
+    virtual void Encode(const DetectionRecord& record, std::string& out) = 0;
+
+private:
+    std::unique_ptr<OutputStream> stream;
+    std::string scratch; // reused, no alloc per record once warm
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> dropped{0};
+};
+
+// one json object per line, "stream":N goes after frame in multi stream runs
+// {"frame":12,"t_us":123456,"latency_ms":41.2,"w":640,"h":640,"dets":[{"x":1.5,"y":2.0,"w":3.0,"h":4.5,"conf":0.91,"cls":3,"label":"Bottle","id":7}]}
+class NdjsonSink : public DetectionSink {
+public:
+    using DetectionSink::DetectionSink;
+protected:
+    void Encode(const DetectionRecord& record, std::string& out) override;
+};
+
+// little endian, packed
+// header: u32 magic 'TRSH', u16 version, u16 count, u64 frameId, i64 captureUs, u32 latencyUs, u16 frameW, u16 frameH
+// version 2 (multi stream runs) adds u16 streamId, u16 reserved after frameH
+// then count x: f32 x y w h, f32 conf, i16 classId, i32 trackingId
+class BinarySink : public DetectionSink {
+public:
+    using DetectionSink::DetectionSink;
+    static const uint32_t kMagic = 0x48535254; // "TRSH"
+    static const uint16_t kVersion = 1;
+    static const uint16_t kVersionStreams = 2;
+protected:
+    void Encode(const DetectionRecord& record, std::string& out) override;
+};
+
+// ndjson or binary
+std::unique_ptr<DetectionSink> CreateDetectionSink(const std::string& format, std::unique_ptr<OutputStream> stream, std::string* errorMsg = nullptr);
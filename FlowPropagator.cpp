@@ -0,0 +1,131 @@
+#include "FlowPropagator.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+float Median(std::vector<float>& values, size_t count) {
+    auto mid = values.begin() + count / 2;
+    std::nth_element(values.begin(), mid, values.begin() + count);
+    return *mid;
+}
+
+} // namespace
+
+void FlowPropagator::SetReference(const cv::Mat& frame) {
+    if (frame.empty()) return;
+    BuildPyramid(frame, refPyramid);
+}
+
+void FlowPropagator::Reset() {
+    refPyramid.clear();
+}
+
+void FlowPropagator::Track(const cv::Mat& frame, cv::Rect2f* boxes, uint8_t* ok, int count) {
+    if (frame.empty()) return;
+    if (!HasReference()) {
+        SetReference(frame);
+        std::fill(ok, ok + count, 0);
+        return;
+    }
+    BuildPyramid(frame, pyramid);
+    Flow(refPyramid, pyramid, boxes, ok, count);
+    refPyramid.swap(pyramid); // keeps both sets of buffers alive for the next frame
+}
+
+void FlowPropagator::TrackToReference(const cv::Mat& older, cv::Rect2f* boxes, uint8_t* ok, int count) {
+    if (older.empty() || !HasReference()) {
+        std::fill(ok, ok + count, 0);
+        return;
+    }
+    BuildPyramid(older, pyramid);
+    Flow(pyramid, refPyramid, boxes, ok, count);
+}
+
+void FlowPropagator::BuildPyramid(const cv::Mat& frame, std::vector<cv::Mat>& out) {
+    if (frame.channels() == 4) cv::cvtColor(frame, gray, cv::COLOR_BGRA2GRAY);
+    else if (frame.channels() == 3) cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+    else gray = frame;
+
+    const cv::Mat* src = &gray;
+    if (config.downscale > 0.0f && config.downscale < 1.0f) {
+        cv::resize(gray, small, cv::Size(), config.downscale, config.downscale, cv::INTER_AREA);
+        src = &small;
+    }
+    // no input reuse, level 0 would alias gray/small and the next frame would overwrite the reference
+    cv::buildOpticalFlowPyramid(*src, out, cv::Size(config.windowSize, config.windowSize), config.pyramidLevels,
+                                true, cv::BORDER_REFLECT_101, cv::BORDER_CONSTANT, false);
+}
+
+void FlowPropagator::Flow(const std::vector<cv::Mat>& fromPyr, const std::vector<cv::Mat>& toPyr, cv::Rect2f* boxes, uint8_t* ok, int count) {
+    if (count <= 0) return;
+    const float s = (config.downscale > 0.0f && config.downscale < 1.0f) ? config.downscale : 1.0f;
+    const int g = std::max(config.gridPoints, 2);
+    const int perBox = g * g;
+
+    // grid on the inner 60% of each box, edges are mostly background
+    from.resize((size_t)count * perBox);
+    for (int b = 0; b < count; b++) {
+        const cv::Rect2f& box = boxes[b];
+        for (int j = 0; j < g; j++) {
+            for (int i = 0; i < g; i++) {
+                float fx = 0.2f + 0.6f * (i + 0.5f) / g;
+                float fy = 0.2f + 0.6f * (j + 0.5f) / g;
+                from[(size_t)b * perBox + j * g + i] = cv::Point2f((box.x + box.width * fx) * s, (box.y + box.height * fy) * s);
+            }
+        }
+    }
+
+    const cv::Size win(config.windowSize, config.windowSize);
+    to = from; // starting guess is no motion
+    cv::calcOpticalFlowPyrLK(fromPyr, toPyr, from, to, status, err, win, config.pyramidLevels,
+                             cv::TermCriteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 20, 0.03), cv::OPTFLOW_USE_INITIAL_FLOW);
+    back = from;
+    cv::calcOpticalFlowPyrLK(toPyr, fromPyr, to, back, backStatus, err, win, config.pyramidLevels,
+                             cv::TermCriteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 20, 0.03), cv::OPTFLOW_USE_INITIAL_FLOW);
+
+    const float maxBack2 = config.maxBackError * config.maxBackError;
+    dx.resize(perBox);
+    dy.resize(perBox);
+    ratio.resize(perBox);
+    for (int b = 0; b < count; b++) {
+        size_t base = (size_t)b * perBox;
+        int n = 0;
+        int prev = -1;
+        int pairs = 0;
+        for (int k = 0; k < perBox; k++) {
+            size_t p = base + k;
+            if (!status[p] || !backStatus[p]) continue;
+            float ex = back[p].x - from[p].x;
+            float ey = back[p].y - from[p].y;
+            if (ex * ex + ey * ey > maxBack2) continue;
+            dx[n] = to[p].x - from[p].x;
+            dy[n] = to[p].y - from[p].y;
+            n++;
+            // spacing change against the previous survivor, median of these is the scale
+            if (prev >= 0) {
+                float d0 = (float)cv::norm(from[p] - from[prev]);
+                float d1 = (float)cv::norm(to[p] - to[prev]);
+                if (d0 > 1.0f) ratio[pairs++] = d1 / d0;
+            }
+            prev = (int)p;
+        }
+        if (n < config.minPoints) {
+            ok[b] = 0;
+            continue;
+        }
+
+        float mx = Median(dx, n) / s;
+        float my = Median(dy, n) / s;
+        float scale = pairs > 0 ? std::min(std::max(Median(ratio, pairs), 0.8f), 1.25f) : 1.0f;
+
+        cv::Rect2f& box = boxes[b];
+        float cx = box.x + box.width * 0.5f + mx;
+        float cy = box.y + box.height * 0.5f + my;
+        box.width *= scale;
+        box.height *= scale;
+        box.x = cx - box.width * 0.5f;
+        box.y = cy - box.height * 0.5f;
+        ok[b] = 1;
+    }
+}
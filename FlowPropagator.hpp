@@ -0,0 +1,49 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+struct FlowConfig {
+    int gridPoints = 4;        // per side, a box gets gridPoints^2 points on its inner part
+    float downscale = 0.5f;    // flow runs on a gray copy this size, boxes scaled to match
+    int windowSize = 15;       // lk window px at the flow scale
+    int pyramidLevels = 3;
+    float maxBackError = 1.0f; // forward-backward check, px at the flow scale
+    int minPoints = 4;         // fewer survivors and the box is left alone
+};
+
+// keyframe mode: moves boxes from one frame to the next by sparse pyramidal lucas kanade
+// median flow style, a grid of points per box tracked forward then back, points that dont
+// come back to where they started are dropped, box moves by the median shift and scales by the
+// median change of point spacing
+// the last frame is kept as a pyramid so every new frame only builds its own
+class FlowPropagator {
+public:
+    FlowConfig config;
+
+    // frame becomes the reference, boxes given later are in its pixels
+    void SetReference(const cv::Mat& frame);
+    bool HasReference() const { return !refPyramid.empty(); }
+    void Reset();
+
+    // reference -> frame, then frame is the new reference
+    // ok[i] = 0 when box i couldnt be followed, it stays where it was
+    void Track(const cv::Mat& frame, cv::Rect2f* boxes, uint8_t* ok, int count);
+    // older frame -> reference, reference stays, for detections that come back after the tracks moved on
+    void TrackToReference(const cv::Mat& older, cv::Rect2f* boxes, uint8_t* ok, int count);
+
+private:
+    void BuildPyramid(const cv::Mat& frame, std::vector<cv::Mat>& pyramid);
+    void Flow(const std::vector<cv::Mat>& from, const std::vector<cv::Mat>& to, cv::Rect2f* boxes, uint8_t* ok, int count);
+
+    std::vector<cv::Mat> refPyramid;
+    std::vector<cv::Mat> pyramid;    // new frame, swapped into refPyramid on Track
+    cv::Mat gray, small;
+
+    // scratch, kept between frames
+    std::vector<cv::Point2f> from, to, back;
+    std::vector<uint8_t> status, backStatus;
+    std::vector<float> err;
+    std::vector<float> dx, dy, ratio;
+};
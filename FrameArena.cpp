@@ -0,0 +1,54 @@
+#include "FrameArena.hpp"
+#include <algorithm>
+
+FrameArena::FrameArena(size_t initialBytes) {
+    blocks.reserve(8);
+    AddBlock(initialBytes);
+}
+
+void FrameArena::AddBlock(size_t minBytes) {
+    Block block;
+    block.size = std::max<size_t>(minBytes, 4096);
+    block.data.reset(new uint8_t[block.size]);
+    blocks.push_back(std::move(block));
+}
+
+void* FrameArena::Allocate(size_t bytes, size_t align) {
+    if (bytes == 0) bytes = 1;
+
+    while (true) {
+        Block& block = blocks[current];
+        uintptr_t base = (uintptr_t)block.data.get();
+        size_t aligned = (size_t)(((base + offset + align - 1) & ~(uintptr_t)(align - 1)) - base);
+        if (aligned + bytes <= block.size) {
+            used += aligned + bytes - offset;
+            offset = aligned + bytes;
+            return block.data.get() + aligned;
+        }
+
+        // next block, a new one if we ran past the end, only happens while warming up
+        current++;
+        offset = 0;
+        if (current == blocks.size()) AddBlock(std::max(bytes + align, blocks.back().size * 2));
+    }
+}
+
+void FrameArena::Reset() {
+    highWater = std::max(highWater, used);
+
+    // spilled into more than one block, swap them for one that fits the whole frame
+    if (blocks.size() > 1) {
+        size_t total = Capacity();
+        blocks.clear();
+        AddBlock(std::max(total, highWater + highWater / 2));
+    }
+    current = 0;
+    offset = 0;
+    used = 0;
+}
+
+size_t FrameArena::Capacity() const {
+    size_t total = 0;
+    for (const auto& b : blocks) total += b.size;
+    return total;
+}
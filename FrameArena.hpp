@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// bump allocator for per frame scratch, Reset frees everything at once
+// overflow blocks get merged into one bigger block on Reset
+// so after a few frames of warm up a frame never touches the heap
+class FrameArena {
+public:
+    explicit FrameArena(size_t initialBytes = 64 * 1024);
+
+    void* Allocate(size_t bytes, size_t align);
+    // start of a new frame, anything handed out before is gone
+    void Reset();
+
+    size_t Capacity() const;
+    size_t HighWater() const { return highWater; }
+
+private:
+    struct Block {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size = 0;
+    };
+
+    void AddBlock(size_t minBytes);
+
+    std::vector<Block> blocks;
+    size_t current = 0; // block we bump in
+    size_t offset = 0;  // bytes used in it
+    size_t used = 0;    // this frame, all blocks
+    size_t highWater = 0;
+};
+
+// std allocator over an arena, deallocate does nothing, Reset takes it all back
+template<class T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    FrameArena* arena = nullptr;
+
+    explicit ArenaAllocator(FrameArena& arena) : arena(&arena) {}
+    template<class U> ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(arena->Allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    template<class U> bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template<class U> bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+// reserve up front, growing leaves the old storage dead until Reset
+template<class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,56 @@
+#include "FramePool.hpp"
+
+FrameRef::FrameRef(const FrameRef& other) : buffer(other.buffer) {
+    if (buffer) buffer->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+FrameRef& FrameRef::operator=(const FrameRef& other) {
+    if (buffer != other.buffer) {
+        if (other.buffer) other.buffer->refs.fetch_add(1, std::memory_order_relaxed);
+        Reset();
+        buffer = other.buffer;
+    }
+    return *this;
+}
+
+FrameRef& FrameRef::operator=(FrameRef&& other) noexcept {
+    if (this != &other) {
+        Reset();
+        buffer = other.buffer;
+        other.buffer = nullptr;
+    }
+    return *this;
+}
+
+void FrameRef::Reset() {
+    // release so the next writer sees everything we did with the pixels
+    if (buffer) buffer->refs.fetch_sub(1, std::memory_order_acq_rel);
+    buffer = nullptr;
+}
+
+FramePool::FramePool(int count) {
+    for (int i = 0; i < count; i++) buffers.push_back(std::make_unique<FrameRef::Buffer>());
+}
+
+cv::Mat FramePool::Acquire(int rows, int cols, int type, FrameRef& ref) {
+    ref.Reset();
+    size_t bytes = (size_t)rows * cols * CV_ELEM_SIZE(type);
+
+    for (auto& b : buffers) {
+        int expected = 0;
+        if (!b->refs.compare_exchange_strong(expected, 1, std::memory_order_acquire)) continue;
+        // only grows, same size every frame after the first
+        if (b->data.size() < bytes) b->data.resize(bytes);
+        ref.buffer = b.get();
+        return cv::Mat(rows, cols, type, b->data.data());
+    }
+
+    misses++;
+    return cv::Mat(rows, cols, type);
+}
+
+int FramePool::InUse() const {
+    int n = 0;
+    for (const auto& b : buffers) if (b->refs.load(std::memory_order_relaxed) > 0) n++;
+    return n;
+}
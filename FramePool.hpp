@@ -0,0 +1,49 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// refcounted handle to a pooled frame buffer
+// copies share the buffer, it goes back to the pool when the last one dies
+// empty handle means the mat owns its memory the normal opencv way
+class FrameRef {
+public:
+    FrameRef() = default;
+    FrameRef(const FrameRef& other);
+    FrameRef(FrameRef&& other) noexcept : buffer(other.buffer) { other.buffer = nullptr; }
+    FrameRef& operator=(const FrameRef& other);
+    FrameRef& operator=(FrameRef&& other) noexcept;
+    ~FrameRef() { Reset(); }
+
+    void Reset();
+    explicit operator bool() const { return buffer != nullptr; }
+
+private:
+    friend class FramePool;
+    struct Buffer {
+        std::vector<uchar> data;
+        std::atomic<int> refs{0};
+    };
+    Buffer* buffer = nullptr;
+};
+
+// fixed set of frame buffers so capture doesnt allocate a new mat every frame
+// frames move capture -> pipeline -> render as mat headers over these, never copied
+class FramePool {
+public:
+    explicit FramePool(int count = 12);
+
+    // mat over a free buffer, ref holds it until the last copy is gone
+    // all busy falls back to a normal allocation and counts a miss
+    cv::Mat Acquire(int rows, int cols, int type, FrameRef& ref);
+
+    int InUse() const;
+    uint64_t Misses() const { return misses; }
+
+private:
+    std::vector<std::unique_ptr<FrameRef::Buffer>> buffers;
+    std::atomic<uint64_t> misses{0};
+};
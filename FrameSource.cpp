@@ -0,0 +1,149 @@
+#include "FrameSource.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+void FramePacer::Wait() {
+    if (fps <= 0.0) return;
+
+    auto period = std::chrono::duration_cast<FrameClock::duration>(std::chrono::duration<double>(1.0 / fps));
+    auto now = FrameClock::now();
+    if (!started) {
+        started = true;
+        nextTime = now + period;
+        return;
+    }
+
+    if (nextTime > now) {
+        std::this_thread::sleep_until(nextTime);
+    } else if (now - nextTime > period) {
+        // fell behind more than a frame, dont catch up with a burst
+        nextTime = now;
+    }
+    nextTime += period;
+}
+
+VideoFileSource::VideoFileSource(const std::string& path, double fps, bool loop)
+    : path(path), capture(path), loop(loop) {
+    if (!capture.isOpened()) {
+        std::cerr << "could not open video " << path << std::endl;
+        return;
+    }
+
+    double nativeFps = capture.get(cv::CAP_PROP_FPS);
+    if (fps == 0.0) fps = nativeFps > 0.0 ? nativeFps : 30.0;
+    pacer.SetFps(fps > 0.0 ? fps : 0.0);
+}
+
+bool VideoFileSource::Grab(CapturedFrame& out) {
+    if (!capture.isOpened()) return false;
+
+    pacer.Wait();
+    // drop our ref first, read would otherwise write into a frame someone still holds
+    out.image.release();
+    if (!capture.read(out.image) || out.image.empty()) {
+        if (!loop) return false;
+        capture.set(cv::CAP_PROP_POS_FRAMES, 0);
+        if (!capture.read(out.image) || out.image.empty()) return false;
+    }
+    Stamp(out);
+    return true;
+}
+
+ImageDirectorySource::ImageDirectorySource(const std::string& directory, double fps, bool loop)
+    : directory(directory), loop(loop) {
+    static const char* exts[] = { ".png", ".jpg", ".jpeg", ".bmp" };
+
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(directory, ec)) {
+        if (!entry.is_regular_file()) continue;
+        std::string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        for (const char* e : exts) {
+            if (ext == e) { files.push_back(entry.path().string()); break; }
+        }
+    }
+    // directory_iterator order is random, recorded shifts are numbered
+    std::sort(files.begin(), files.end());
+
+    if (files.empty()) std::cerr << "no images found in " << directory << std::endl;
+    pacer.SetFps(fps > 0.0 ? fps : 0.0);
+}
+
+bool ImageDirectorySource::Grab(CapturedFrame& out) {
+    size_t failed = 0;
+    while ((index < files.size() || (loop && !files.empty())) && failed < files.size()) {
+        if (index >= files.size()) index = 0;
+
+        pacer.Wait();
+        out.image = cv::imread(files[index++], cv::IMREAD_COLOR);
+        if (out.image.empty()) {
+            std::cerr << "skipping unreadable image " << files[index - 1] << std::endl;
+            failed++;
+            continue;
+        }
+        Stamp(out);
+        return true;
+    }
+    return false;
+}
+
+MemoryLoopSource::MemoryLoopSource(std::vector<cv::Mat> frames, double fps)
+    : frames(std::move(frames)) {
+    pacer.SetFps(fps > 0.0 ? fps : 0.0);
+}
+
+std::unique_ptr<MemoryLoopSource> MemoryLoopSource::FromSource(FrameSource& source, double fps, size_t maxFrames, std::string* errorMsg) {
+    if (maxFrames == 0 && (source.IsLive() || source.IsLooping())) {
+        // would copy frames until ram runs out
+        if (errorMsg) *errorMsg = source.Name() + " never ends, give a max frame count";
+        return nullptr;
+    }
+    std::vector<cv::Mat> frames;
+    CapturedFrame f;
+    while ((maxFrames == 0 || frames.size() < maxFrames) && source.Grab(f)) {
+        frames.push_back(f.image.clone()); // video capture reuses its buffer
+    }
+    return std::make_unique<MemoryLoopSource>(std::move(frames), fps);
+}
+
+bool MemoryLoopSource::Grab(CapturedFrame& out) {
+    if (frames.empty()) return false;
+
+    pacer.Wait();
+    // copy into our own buffer, a shared header would let a consumer draw into the loop
+    // with a pool set its a memcpy into a recycled buffer, no allocation
+    const cv::Mat& src = frames[index];
+    AllocImage(out, src.rows, src.cols, src.type());
+    src.copyTo(out.image);
+    index = (index + 1) % frames.size();
+    Stamp(out);
+    return true;
+}
+
+std::unique_ptr<FrameSource> CreateReplaySource(const std::string& path, double fps, bool loop, std::string* errorMsg) {
+    std::error_code ec;
+    if (fs::is_directory(path, ec)) {
+        auto src = std::make_unique<ImageDirectorySource>(path, fps, loop);
+        if (src->GetFrameCount() == 0) {
+            if (errorMsg) *errorMsg = "no images in " + path;
+            return nullptr;
+        }
+        return src;
+    }
+
+    if (fs::is_regular_file(path, ec)) {
+        auto src = std::make_unique<VideoFileSource>(path, fps, loop);
+        if (!src->IsOpen()) {
+            if (errorMsg) *errorMsg = "could not open video " + path;
+            return nullptr;
+        }
+        return src;
+    }
+
+    if (errorMsg) *errorMsg = "path not found " + path;
+    return nullptr;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include "FramePool.hpp"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// monotonic clock for capture stamps
+// high_resolution_clock is system_clock on gcc so it can jump
+using FrameClock = std::chrono::steady_clock;
+
+// one frame out of a source
+struct CapturedFrame {
+    cv::Mat image;                    // bgr, or bgra straight from the screen
+    FrameRef buffer;                  // keeps image memory out of the pool while set, copies share it
+    uint64_t frameId = 0;             // counts up per source
+    FrameClock::time_point captureTime; // when the pixels were grabbed
+};
+
+// anything that can hand us frames (screen, video, folder, memory)
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+
+    // grab next frame, false if nothing came out (end of file etc)
+    virtual bool Grab(CapturedFrame& out) = 0;
+
+    // region of interest, only live sources care
+    virtual void SetROI(int x, int y, int w, int h) {}
+
+    // true for screen capture, false for replay stuff
+    virtual bool IsLive() const { return false; }
+    // looping replay, Grab never runs out
+    virtual bool IsLooping() const { return false; }
+    virtual std::string Name() const = 0;
+
+    // sources that fill a fixed size image take buffers from here, null allocates normally
+    void SetFramePool(FramePool* pool) { framePool = pool; }
+
+protected:
+    // image of that size in out, pooled if we have a pool, existing memory is not reused
+    void AllocImage(CapturedFrame& out, int rows, int cols, int type) {
+        if (framePool) {
+            out.image = framePool->Acquire(rows, cols, type, out.buffer);
+        } else {
+            out.buffer.Reset();
+            out.image.create(rows, cols, type);
+        }
+    }
+
+    // stamp + id in one place so every backend does the same
+    void Stamp(CapturedFrame& out, FrameClock::time_point when = FrameClock::now()) {
+        out.frameId = nextFrameId++;
+        out.captureTime = when;
+    }
+
+private:
+    uint64_t nextFrameId = 0;
+    FramePool* framePool = nullptr;
+};
+
+// paces replay to a fixed rate, 0 fps means as fast as possible
+class FramePacer {
+public:
+    void SetFps(double fps) { this->fps = fps; started = false; }
+    double GetFps() const { return fps; }
+
+    // sleep until next frame slot
+    void Wait();
+
+private:
+    double fps = 0.0;
+    bool started = false;
+    FrameClock::time_point nextTime;
+};
+
+// video file through cv::VideoCapture
+class VideoFileSource : public FrameSource {
+public:
+    // fps 0 plays at the file rate, below 0 runs unpaced
+    // loop restarts at the end
+    VideoFileSource(const std::string& path, double fps = 0.0, bool loop = false);
+
+    bool IsOpen() const { return capture.isOpened(); }
+    bool Grab(CapturedFrame& out) override;
+    bool IsLooping() const override { return loop; }
+    std::string Name() const override { return "video:" + path; }
+
+private:
+    std::string path;
+    cv::VideoCapture capture;
+    FramePacer pacer;
+    bool loop = false;
+};
+
+// folder of images sorted by filename
+class ImageDirectorySource : public FrameSource {
+public:
+    ImageDirectorySource(const std::string& directory, double fps = 0.0, bool loop = false);
+
+    size_t GetFrameCount() const { return files.size(); }
+    const std::vector<std::string>& GetFiles() const { return files; }
+    bool Grab(CapturedFrame& out) override;
+    bool IsLooping() const override { return loop; }
+    std::string Name() const override { return "images:" + directory; }
+
+private:
+    std::string directory;
+    std::vector<std::string> files;
+    size_t index = 0;
+    FramePacer pacer;
+    bool loop = false;
+};
+
+// frames already in ram, loops forever
+// decode cost out of the way so we measure only the pipeline
+// every grab is a copy, set a frame pool to keep that off the allocator
+class MemoryLoopSource : public FrameSource {
+public:
+    MemoryLoopSource(std::vector<cv::Mat> frames, double fps = 0.0);
+
+    // load a whole folder or video into memory, maxFrames 0 is everything
+    // a live or looping source has no end, null unless maxFrames is set
+    static std::unique_ptr<MemoryLoopSource> FromSource(FrameSource& source, double fps = 0.0, size_t maxFrames = 0,
+                                                        std::string* errorMsg = nullptr);
+
+    bool Grab(CapturedFrame& out) override;
+    bool IsLooping() const override { return true; }
+    std::string Name() const override { return "memory"; }
+
+private:
+    std::vector<cv::Mat> frames;
+    size_t index = 0;
+    FramePacer pacer;
+};
+
+// pick backend from a path: folder -> images, file -> video
+// fps 0 uses native rate for video and unpaced for images, below 0 unpaced
+std::unique_ptr<FrameSource> CreateReplaySource(const std::string& path, double fps = 0.0, bool loop = false, std::string* errorMsg = nullptr);
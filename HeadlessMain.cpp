@@ -0,0 +1,459 @@
+// headless detection daemon, no gui no win32, for the linux inference boxes
+// trash_headless target in CMakeLists.txt, built instead of main.cpp without win32 / d3d11
+//
+// usage: trash_headless [--config file] [--key value ...]
+//   keys (same in the config file as "key = value", # comments):
+//   model labels source fps loop threads resolution conf nms low_conf prediction
+//   format (ndjson|binary) output (stdout|unix:/path) duration cache summary
+//   deadline batch (multi stream only)
+//   keyframe (single stream, detector every Nth frame, optical flow in between)
+//   motion_gate (single stream, skip the detector on frames where nothing changed)
+//   trace (chrome trace json of every stage written here on exit, open in ui.perfetto.dev)
+//   telemetry (single stream, per frame stage timings streamed to path_<time>_<n>.bin, or .csv if path ends in .csv)
+// several sources comma separated run as streams on one session, frames get batched across them
+// detections stream to output, stats go to stderr on exit (and to summary as json if set)
+#include "TrashDetector.hpp"
+#include "FrameSource.hpp"
+#include "DetectionPipeline.hpp"
+#include "StreamManager.hpp"
+#include "DetectionSink.hpp"
+#include "features/Prediction.hpp"
+#include "TraceRecorder.hpp"
+#include "analytics/PerformanceLogger.hpp"
+#include "TelemetryLog.hpp"
+#include "LatencyHistogram.hpp"
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct HeadlessConfig {
+    std::string model;
+    std::string labels;
+    std::string source;        // comma separated for several streams
+    double fps = 0.0;          // 0 native, < 0 as fast as possible
+    bool loop = false;
+    int threads = std::thread::hardware_concurrency() > 0 ? (int)std::thread::hardware_concurrency() : 4;
+    int resolution = 640;
+    float conf = 0.5f;
+    float nms = 0.45f;
+    float lowConf = 0.1f;      // second pass tracker boxes, 0 off
+    bool prediction = true;
+    std::string format = "ndjson";
+    std::string output = "stdout";
+    double duration = 0.0;     // seconds, 0 runs until the source ends or a signal
+    bool cache = true;
+    std::string summary;       // json stats file, empty for none
+    double deadline = 100.0;   // ms capture to result per stream
+    int batch = kMaxBatch;     // most frames per run across streams
+    int keyframe = 1;          // detector every Nth frame, tracks follow the rest by flow
+    bool motionGate = false;   // static frames reuse the last boxes
+    std::string trace;         // chrome trace json path, empty = no tracing
+    std::string telemetry;     // telemetry log path prefix, empty = off
+};
+
+volatile std::sig_atomic_t stopRequested = 0;
+
+void OnSignal(int) { stopRequested = 1; }
+
+std::string Trim(const std::string& s) {
+    size_t a = s.find_first_not_of(" \t\r\n");
+    if (a == std::string::npos) return "";
+    size_t b = s.find_last_not_of(" \t\r\n");
+    return s.substr(a, b - a + 1);
+}
+
+bool ParseBool(const std::string& v) {
+    return v == "1" || v == "true" || v == "yes" || v == "on";
+}
+
+bool ApplySetting(HeadlessConfig& cfg, const std::string& key, const std::string& value, std::string* errorMsg) {
+    try {
+        if (key == "model") cfg.model = value;
+        else if (key == "labels") cfg.labels = value;
+        else if (key == "source") cfg.source = value;
+        else if (key == "fps") cfg.fps = std::stod(value);
+        else if (key == "loop") cfg.loop = ParseBool(value);
+        else if (key == "threads") cfg.threads = std::max(1, std::stoi(value));
+        else if (key == "resolution") cfg.resolution = std::stoi(value);
+        else if (key == "conf") cfg.conf = std::stof(value);
+        else if (key == "nms") cfg.nms = std::stof(value);
+        else if (key == "low_conf") cfg.lowConf = std::stof(value);
+        else if (key == "prediction") cfg.prediction = ParseBool(value);
+        else if (key == "format") cfg.format = value;
+        else if (key == "output") cfg.output = value;
+        else if (key == "duration") cfg.duration = std::stod(value);
+        else if (key == "cache") cfg.cache = ParseBool(value);
+        else if (key == "summary") cfg.summary = value;
+        else if (key == "deadline") cfg.deadline = std::stod(value);
+        else if (key == "batch") cfg.batch = std::max(1, std::min(kMaxBatch, std::stoi(value)));
+        else if (key == "keyframe") cfg.keyframe = std::max(1, std::stoi(value));
+        else if (key == "motion_gate") cfg.motionGate = ParseBool(value);
+        else if (key == "trace") cfg.trace = value;
+        else if (key == "telemetry") cfg.telemetry = value;
+        else {
+            if (errorMsg) *errorMsg = "unknown setting " + key;
+            return false;
+        }
+    } catch (const std::exception&) {
+        if (errorMsg) *errorMsg = "bad value for " + key + ": " + value;
+        return false;
+    }
+    return true;
+}
+
+bool LoadConfigFile(const std::string& path, HeadlessConfig& cfg, std::string* errorMsg) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        if (errorMsg) *errorMsg = "cant open config " + path;
+        return false;
+    }
+
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(file, line)) {
+        lineNo++;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.resize(hash);
+        line = Trim(line);
+        if (line.empty()) continue;
+
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            if (errorMsg) *errorMsg = path + ":" + std::to_string(lineNo) + " expected key = value";
+            return false;
+        }
+        if (!ApplySetting(cfg, Trim(line.substr(0, eq)), Trim(line.substr(eq + 1)), errorMsg)) {
+            if (errorMsg) *errorMsg = path + ":" + std::to_string(lineNo) + " " + *errorMsg;
+            return false;
+        }
+    }
+    return true;
+}
+
+// defaults < config file < cli
+bool ParseArgs(int argc, char** argv, HeadlessConfig& cfg, std::string* errorMsg) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--config" && !LoadConfigFile(argv[i + 1], cfg, errorMsg)) return false;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0 || i + 1 >= argc) {
+            if (errorMsg) *errorMsg = "expected --key value, got " + arg;
+            return false;
+        }
+        std::string key = arg.substr(2);
+        std::string value = argv[++i];
+        if (key == "config") continue;
+        if (!ApplySetting(cfg, key, value, errorMsg)) return false;
+    }
+
+    if (cfg.model.empty() || cfg.source.empty()) {
+        if (errorMsg) *errorMsg = "model and source are required";
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::string> SplitSources(const std::string& spec) {
+    std::vector<std::string> out;
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        item = Trim(item);
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+// what both run modes report on exit, the mode specific bits come in preformatted
+struct RunSummary {
+    std::string title;      // after "headless summary"
+    double elapsed = 0.0;
+    uint64_t frames = 0;
+    LatencySummary latency;
+    std::string frameLine;  // counts line, first in the report
+    std::string details;    // extra report lines after latency
+    std::string jsonFields; // ,"key":value pairs after latency_ms
+};
+
+// stderr report, plus the summary json if set
+void PrintRunSummary(const HeadlessConfig& cfg, const RunSummary& run, const DetectionSink& sink) {
+    const LatencySummary& lat = run.latency;
+    double fps = run.elapsed > 0.0 ? run.frames / run.elapsed : 0.0;
+
+    std::ostringstream report;
+    report.setf(std::ios::fixed);
+    report.precision(2);
+    report << "--- headless summary" << run.title << " ---\n"
+           << run.frameLine
+           << "elapsed: " << run.elapsed << " s, sustained fps: " << fps << "\n"
+           << "latency ms: avg " << lat.mean << " p50 " << lat.p50 << " p90 " << lat.p90 << " p99 " << lat.p99 << " max " << lat.max << "\n"
+           << run.details
+           << "output: " << sink.Written() << " written, " << sink.Dropped() << " dropped\n";
+    std::cerr << report.str();
+
+    if (cfg.summary.empty()) return;
+    std::ofstream out(cfg.summary);
+    out.setf(std::ios::fixed);
+    out.precision(3);
+    out << "{\"model\":\"" << cfg.model << "\",\"threads\":" << cfg.threads << ",\"resolution\":" << cfg.resolution
+        << ",\"elapsed_s\":" << run.elapsed << ",\"frames\":" << run.frames << ",\"fps\":" << fps
+        << ",\"latency_ms\":{\"avg\":" << lat.mean << ",\"p50\":" << lat.p50 << ",\"p90\":" << lat.p90
+        << ",\"p99\":" << lat.p99 << ",\"max\":" << lat.max << "}" << run.jsonFields << "}\n";
+}
+
+// several sources on one session through the stream manager
+int RunStreams(const HeadlessConfig& cfg, const std::vector<std::string>& specs, TrashDetector& detector, DetectionSink& sink) {
+    StreamManager manager(detector);
+    manager.confThreshold = cfg.conf;
+    manager.nmsThreshold = cfg.nms;
+    manager.lowConfThreshold = cfg.lowConf;
+    manager.maxBatch = cfg.batch;
+
+    std::string error;
+    for (const auto& spec : specs) {
+        StreamConfig stream;
+        stream.name = spec;
+        stream.source = CreateReplaySource(spec, cfg.fps, cfg.loop, &error);
+        stream.deadlineMs = cfg.deadline;
+        stream.prediction = cfg.prediction;
+        if (!stream.source) {
+            std::cerr << "error: " << error << std::endl;
+            return 1;
+        }
+        manager.AddStream(std::move(stream));
+    }
+
+    LatencyHistogram latency; // scheduler thread only until Stop, fixed size however long the run
+
+    if (detector.GetMaxBatch() < 2) std::cerr << "model has a fixed batch dim, streams run one frame at a time" << std::endl;
+    std::cerr << "running " << cfg.model << " on " << specs.size() << " streams -> " << cfg.output << " (" << cfg.format << ")" << std::endl;
+    auto start = FrameClock::now();
+    manager.Start([&](int id, PipelineResult& result) {
+        DetectionRecord record;
+        record.frameId = result.frame.frameId;
+        record.streamId = id;
+        record.captureTime = result.frame.captureTime;
+        record.latencyMs = std::chrono::duration<double, std::milli>(FrameClock::now() - result.frame.captureTime).count();
+        record.frameW = result.frame.image.cols;
+        record.frameH = result.frame.image.rows;
+        record.detections = &result.detections;
+        sink.Write(record);
+        latency.Record(record.latencyMs);
+    });
+
+    const StreamManagerStats& stats = manager.Stats();
+    while (!stopRequested) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        double elapsed = std::chrono::duration<double>(FrameClock::now() - start).count();
+        if (cfg.duration > 0.0 && elapsed >= cfg.duration) break;
+        if (manager.AllSourcesDone()) {
+            uint64_t before = stats.frames;
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            if (stats.frames == before) break;
+        }
+    }
+    manager.Stop();
+    double elapsed = std::chrono::duration<double>(FrameClock::now() - start).count();
+
+    RunSummary run;
+    run.title = " (" + std::to_string(manager.StreamCount()) + " streams)";
+    run.elapsed = elapsed;
+    run.frames = stats.frames;
+    run.latency = latency.Summarize();
+    std::ostringstream lines, json;
+    lines.setf(std::ios::fixed);
+    lines.precision(2);
+    json.setf(std::ios::fixed);
+    json.precision(3);
+    lines << "frames: " << run.frames << " in " << stats.batches << " runs, avg batch " << stats.avgBatch << "\n";
+    run.frameLine = lines.str();
+    lines.str("");
+    json << ",\"streams\":" << manager.StreamCount() << ",\"avg_batch\":" << stats.avgBatch << ",\"per_stream\":[";
+    for (int i = 0; i < manager.StreamCount(); i++) {
+        const StreamStats& s = manager.Stats(i);
+        lines << "  [" << i << "] " << manager.Name(i) << ": " << s.completed << " done, " << s.dropped << " dropped, "
+              << s.deadlineMisses << " late, latency " << s.latencyMs << " ms\n";
+        json << (i ? "," : "") << "{\"frames\":" << s.completed << ",\"dropped\":" << s.dropped
+             << ",\"late\":" << s.deadlineMisses << ",\"latency_ms\":" << s.latencyMs << "}";
+    }
+    json << "]";
+    run.details = lines.str();
+    run.jsonFields = json.str();
+    PrintRunSummary(cfg, run, sink);
+    if (!cfg.trace.empty()) TraceRecorder::Get().ExportChrome(cfg.trace);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    HeadlessConfig cfg;
+    std::string error;
+    if (!ParseArgs(argc, argv, cfg, &error)) {
+        std::cerr << "error: " << error << "\n"
+                  << "usage: " << argv[0] << " [--config file] --model m.onnx --source video.mp4|folder"
+                  << " [--format ndjson|binary] [--output stdout|unix:/path] [--duration sec] ..." << std::endl;
+        return 2;
+    }
+
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+    TraceRecorder::Get().SetEnabled(!cfg.trace.empty());
+
+    // model
+    TrashDetector detector;
+    detector.GetModelCache().enabled = cfg.cache;
+    detector.SetInputResolution(cfg.resolution);
+    if (!cfg.labels.empty() && !detector.LoadLabels(cfg.labels)) {
+        std::cerr << "warning: no labels loaded from " << cfg.labels << std::endl;
+    }
+    if (!detector.LoadModel(cfg.model, false, cfg.threads, &error)) {
+        std::cerr << "error: model failed to load " << error << std::endl;
+        return 1;
+    }
+    {
+        ModelLoadStatus loaded = detector.GetLoadStatus();
+        std::cerr << "model loaded in " << (int)loaded.loadMs << " ms (session " << (int)loaded.sessionMs << " ms"
+                  << (loaded.fromCache ? ", cached" : "") << "), " << HeadLayoutName(loaded.head.layout) << " head, "
+                  << loaded.head.classes << " classes" << std::endl;
+    }
+
+    // in and out
+    std::unique_ptr<DetectionSink> sink = CreateDetectionSink(cfg.format, CreateOutputStream(cfg.output, &error), &error);
+    if (!sink) {
+        std::cerr << "error: " << error << std::endl;
+        return 1;
+    }
+    std::vector<std::string> sources = SplitSources(cfg.source);
+    if (sources.size() > 1) return RunStreams(cfg, sources, detector, *sink);
+
+    std::shared_ptr<FrameSource> source = CreateReplaySource(cfg.source, cfg.fps, cfg.loop, &error);
+    if (!source) {
+        std::cerr << "error: " << error << std::endl;
+        return 1;
+    }
+
+    Prediction prediction;
+    prediction.enabled = cfg.prediction;
+    PerformanceLogger perfLogger;
+
+    // heap, the ring alone is 256KB
+    std::unique_ptr<TelemetryWriter> telemetry;
+    if (!cfg.telemetry.empty()) {
+        telemetry = std::make_unique<TelemetryWriter>();
+        telemetry->config.path = cfg.telemetry;
+        const std::string ext = ".csv";
+        if (cfg.telemetry.size() > ext.size() && cfg.telemetry.compare(cfg.telemetry.size() - ext.size(), ext.size(), ext) == 0) {
+            telemetry->config.path.resize(cfg.telemetry.size() - ext.size());
+            telemetry->config.csv = true;
+        }
+        if (!telemetry->Start(&error)) {
+            std::cerr << "error: " << error << std::endl;
+            return 1;
+        }
+    }
+
+    DetectionPipeline pipeline(detector);
+    pipeline.confThreshold = cfg.conf;
+    pipeline.nmsThreshold = cfg.nms;
+    pipeline.lowConfThreshold = cfg.lowConf;
+    pipeline.keyframeInterval = cfg.keyframe;
+    pipeline.motionGateEnabled = cfg.motionGate;
+
+    std::atomic<bool> sourceDone{false};
+    LatencyHistogram latency; // post thread only until Stop, fixed size however long the run
+
+    DetectionPipeline::Callbacks cb;
+    cb.grab = [&](CapturedFrame& frame) {
+        if (source->Grab(frame)) return true;
+        sourceDone = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return false;
+    };
+    cb.track = [&](PipelineResult& result, std::vector<Detection>& weak, bool keyframe) {
+        if (!cfg.prediction) return;
+        if (keyframe) prediction.AlignToFlow(result.frame, result.detections, &weak);
+        prediction.UpdateHistory(result.detections, &weak, &result.frame);
+        result.detections = prediction.GetProcessed();
+        result.stateTime = prediction.StateTime();
+    };
+    if (cfg.prediction && cfg.keyframe > 1) {
+        // only the tracker can fill a frame the detector skipped
+        cb.propagate = [&](PipelineResult& result) {
+            prediction.Propagate(result.frame);
+            result.detections = prediction.GetProcessed();
+        };
+    }
+    cb.publish = [&](PipelineResult& result) {
+        DetectionRecord record;
+        record.frameId = result.frame.frameId;
+        record.captureTime = result.frame.captureTime;
+        record.latencyMs = std::chrono::duration<double, std::milli>(FrameClock::now() - result.frame.captureTime).count();
+        record.frameW = result.frame.image.cols;
+        record.frameH = result.frame.image.rows;
+        record.detections = &result.detections;
+        sink->Write(record);
+        latency.Record(record.latencyMs);
+    };
+
+    std::cerr << "running " << cfg.model << " on " << cfg.source << " -> " << cfg.output << " (" << cfg.format << ")" << std::endl;
+    auto start = FrameClock::now();
+    pipeline.Start(std::move(cb), &perfLogger, telemetry.get());
+
+    const PipelineStats& stats = pipeline.Stats();
+    while (!stopRequested) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        double elapsed = std::chrono::duration<double>(FrameClock::now() - start).count();
+        if (cfg.duration > 0.0 && elapsed >= cfg.duration) break;
+        if (sourceDone) {
+            // let the last frames drain out of the pipeline
+            uint64_t before = stats.completed;
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            if (stats.completed == before) break;
+        }
+    }
+    pipeline.Stop();
+    if (telemetry) telemetry->Stop();
+    double elapsed = std::chrono::duration<double>(FrameClock::now() - start).count();
+
+    // summary
+    RunSummary run;
+    run.elapsed = elapsed;
+    run.frames = stats.completed;
+    run.latency = latency.Summarize();
+    uint64_t dropped = stats.dropped[StagePreprocess] + stats.dropped[StageInfer] + stats.dropped[StagePost];
+    std::ostringstream lines, json;
+    lines.setf(std::ios::fixed);
+    lines.precision(2);
+    json.setf(std::ios::fixed);
+    json.precision(3);
+    lines << "frames: " << stats.captured << " captured, " << run.frames << " done, " << dropped << " dropped, "
+          << stats.flowFrames << " by flow, " << stats.gateSkipped << " static (skip rate "
+          << stats.GateSkipRate() * 100.0 << "%)\n";
+    run.frameLine = lines.str();
+    lines.str("");
+    lines << "stage ms: cap " << stats.stageMs[StageCapture] << " pre " << stats.stageMs[StagePreprocess]
+          << " ai " << stats.stageMs[StageInfer] << " post " << stats.stageMs[StagePost] << "\n";
+    if (telemetry) {
+        lines << "telemetry: " << telemetry->Written() << " records, " << telemetry->Dropped() << " dropped";
+        std::string telemetryError = telemetry->LastError();
+        if (!telemetryError.empty()) lines << ", stopped early: " << telemetryError;
+        lines << "\n";
+    }
+    run.details = lines.str();
+    json << ",\"source\":\"" << cfg.source << "\",\"dropped\":" << dropped << ",\"motion_skip_rate\":" << stats.GateSkipRate();
+    run.jsonFields = json.str();
+    PrintRunSummary(cfg, run, *sink);
+    if (!cfg.trace.empty()) TraceRecorder::Get().ExportChrome(cfg.trace);
+    return 0;
+}
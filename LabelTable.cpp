@@ -0,0 +1,48 @@
+#include "LabelTable.hpp"
+#include <algorithm>
+#include <mutex>
+#include <unordered_set>
+
+namespace {
+
+// ids covered up front so any normal model maps without a lookup miss
+const int kMinLabelIds = 256;
+
+} // namespace
+
+const char* InternLabel(const std::string& name) {
+    // node based set, pointers stay put when it grows, never shrinks
+    static std::mutex mutex;
+    static std::unordered_set<std::string> pool;
+    std::lock_guard<std::mutex> lock(mutex);
+    return pool.insert(name).first->c_str();
+}
+
+std::shared_ptr<const LabelTable> LabelTable::FromNames(const std::vector<std::string>& names) {
+    auto table = std::make_shared<LabelTable>();
+    int count = std::max((int)names.size(), kMinLabelIds);
+    table->names.resize(count);
+    for (int id = 0; id < count; id++) {
+        bool named = id < (int)names.size() && !names[id].empty();
+        table->names[id] = InternLabel(named ? names[id] : "Class " + std::to_string(id));
+    }
+    table->unknown = InternLabel("Class ?");
+    return table;
+}
+
+std::shared_ptr<const LabelTable> LabelTable::Default() {
+    auto table = std::make_shared<LabelTable>();
+    table->names.resize(kMinLabelIds);
+    for (int id = 0; id < kMinLabelIds; id++) {
+        switch (id) {
+            case 39: table->names[id] = InternLabel("Bottle"); break;
+            case 41: table->names[id] = InternLabel("Cup"); break;
+            case 45: table->names[id] = InternLabel("Bowl"); break;
+            case 44: table->names[id] = InternLabel("Spoon"); break;
+            case 0:  table->names[id] = InternLabel("Person (Debug)"); break;
+            default: table->names[id] = InternLabel("Object " + std::to_string(id)); break;
+        }
+    }
+    table->unknown = InternLabel("Object ?");
+    return table;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// class id -> name, built once when labels load and never changed after
+// names are interned for the whole process so a Detection can keep a plain pointer
+// even after the table it came from got swapped out
+class LabelTable {
+public:
+    // id -> name pairs from a labels file, gaps become "Class N"
+    static std::shared_ptr<const LabelTable> FromNames(const std::vector<std::string>& names);
+    // built in names for the stock coco model, everything else "Object N"
+    static std::shared_ptr<const LabelTable> Default();
+
+    const char* Name(int classId) const {
+        return (classId >= 0 && classId < (int)names.size()) ? names[classId] : unknown;
+    }
+    int Size() const { return (int)names.size(); }
+
+private:
+    std::vector<const char*> names;
+    const char* unknown = "";
+};
+
+// same string always gives the same pointer, only called while building tables
+const char* InternLabel(const std::string& name);
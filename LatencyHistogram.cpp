@@ -0,0 +1,155 @@
+#include "LatencyHistogram.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int kWindowSpans[RollingLatency::WindowCount] = {1, 10, 60};
+
+int SlotOf(int64_t sec) {
+    int64_t i = sec % RollingLatency::kSlots;
+    return (int)(i < 0 ? i + RollingLatency::kSlots : i);
+}
+
+} // namespace
+
+int LatencyHistogram::BucketOf(uint64_t us) {
+    if (us < (uint64_t)kLinear) return (int)us;
+    // highest set bit, us >> shift lands in [kSteps, 2 * kSteps)
+    int msb = 0;
+    for (uint64_t v = us; v > 1; v >>= 1) msb++;
+    int shift = msb - 5;
+    int bucket = kLinear + (shift - 1) * kSteps + (int)((us >> shift) - kSteps);
+    return std::min(bucket, kBuckets - 1);
+}
+
+uint64_t LatencyHistogram::UpperEdge(int bucket) {
+    if (bucket < kLinear) return (uint64_t)bucket + 1;
+    int shift = (bucket - kLinear) / kSteps + 1;
+    uint64_t step = (uint64_t)((bucket - kLinear) % kSteps + kSteps);
+    return (step + 1) << shift;
+}
+
+void LatencyHistogram::Record(double ms) {
+    if (!(ms >= 0.0)) ms = 0.0; // nan and clock hiccups
+    uint64_t us = (uint64_t)std::llround(ms * 1000.0);
+    counts[BucketOf(us)]++;
+    if (total == 0 || ms < minMs) minMs = ms;
+    if (total == 0 || ms > maxMs) maxMs = ms;
+    total++;
+    sumMs += ms;
+}
+
+void LatencyHistogram::Reset() {
+    std::fill(counts, counts + kBuckets, 0u);
+    total = 0;
+    sumMs = 0.0;
+    minMs = 0.0;
+    maxMs = 0.0;
+}
+
+void LatencyHistogram::Add(const LatencyHistogram& other) {
+    if (other.total == 0) return;
+    for (int i = 0; i < kBuckets; i++) counts[i] += other.counts[i];
+    minMs = total ? std::min(minMs, other.minMs) : other.minMs;
+    maxMs = total ? std::max(maxMs, other.maxMs) : other.maxMs;
+    total += other.total;
+    sumMs += other.sumMs;
+}
+
+void LatencyHistogram::Subtract(const LatencyHistogram& other) {
+    if (other.total == 0) return;
+    for (int i = 0; i < kBuckets; i++) counts[i] -= other.counts[i];
+    total -= other.total;
+    sumMs -= other.sumMs;
+    if (total == 0) sumMs = 0.0;
+}
+
+double LatencyHistogram::Percentile(double p) const {
+    if (total == 0) return 0.0;
+    uint64_t want = (uint64_t)std::ceil(p * total);
+    want = std::max<uint64_t>(want, 1);
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; i++) {
+        seen += counts[i];
+        if (seen >= want) return UpperEdge(i) / 1000.0;
+    }
+    return UpperEdge(kBuckets - 1) / 1000.0;
+}
+
+LatencySummary LatencyHistogram::Summarize() const {
+    LatencySummary s;
+    s.count = total;
+    if (total == 0) return s;
+    s.mean = Mean();
+    s.min = minMs;
+    s.max = maxMs;
+    // one pass for all four
+    const double ps[4] = {0.50, 0.90, 0.99, 0.999};
+    double* out[4] = {&s.p50, &s.p90, &s.p99, &s.p999};
+    uint64_t want[4];
+    for (int k = 0; k < 4; k++) want[k] = std::max<uint64_t>((uint64_t)std::ceil(ps[k] * total), 1);
+    uint64_t seen = 0;
+    int k = 0;
+    for (int i = 0; i < kBuckets && k < 4; i++) {
+        seen += counts[i];
+        while (k < 4 && seen >= want[k]) *out[k++] = UpperEdge(i) / 1000.0;
+    }
+    // bucket edge can overshoot the real max
+    for (int j = 0; j < 4; j++) *out[j] = std::min(*out[j], s.max);
+    return s;
+}
+
+void RollingLatency::Advance(int64_t nowSec) {
+    if (currentSec < 0) {
+        currentSec = nowSec;
+        return;
+    }
+    if (nowSec <= currentSec) return;
+    // a long gap clears everything, no point walking more than a full ring
+    if (nowSec - currentSec >= kSlots) {
+        Reset();
+        currentSec = nowSec;
+        return;
+    }
+    while (currentSec < nowSec) {
+        currentSec++;
+        // second currentSec - span just left each window
+        for (int w = 0; w < WindowCount; w++) {
+            windows[w].Subtract(slots[SlotOf(currentSec - kWindowSpans[w])]);
+        }
+        slots[SlotOf(currentSec)].Reset(); // that was currentSec - 60, out of every window now
+    }
+}
+
+void RollingLatency::Record(double ms, int64_t nowSec) {
+    Advance(nowSec);
+    slots[SlotOf(currentSec)].Record(ms);
+    for (auto& w : windows) w.Record(ms);
+}
+
+LatencySummary RollingLatency::Summary(Window window, int64_t nowSec) {
+    Advance(nowSec);
+    LatencySummary s = windows[window].Summarize();
+    if (s.count == 0) return s;
+    // exact min/max from the seconds in the window
+    bool first = true;
+    for (int i = 0; i < kWindowSpans[window]; i++) {
+        const LatencyHistogram& slot = slots[SlotOf(currentSec - i)];
+        if (slot.Count() == 0) continue;
+        s.min = first ? slot.Min() : std::min(s.min, slot.Min());
+        s.max = first ? slot.Max() : std::max(s.max, slot.Max());
+        first = false;
+    }
+    s.p50 = std::min(s.p50, s.max);
+    s.p90 = std::min(s.p90, s.max);
+    s.p99 = std::min(s.p99, s.max);
+    s.p999 = std::min(s.p999, s.max);
+    return s;
+}
+
+void RollingLatency::Reset() {
+    for (auto& slot : slots) slot.Reset();
+    for (auto& w : windows) w.Reset();
+    currentSec = -1;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+
+// what the gui and csv show for one metric
+struct LatencySummary {
+    uint64_t count = 0;
+    double mean = 0.0;
+    double min = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double p999 = 0.0;
+    double max = 0.0;
+};
+
+// hdr style histogram of durations, microsecond resolution
+// first 64 us get a bucket each, above that every power of two is split in 32 linear steps (~3% error)
+// fixed ~5KB whatever the session length, Record is O(1), percentiles scan the buckets
+class LatencyHistogram {
+public:
+    static const int kLinear = 64;  // exact buckets from 0
+    static const int kSteps = 32;   // per power of two above that
+    static const int kOctaves = 35; // up to 2^40 us, days
+    static const int kBuckets = kLinear + kOctaves * kSteps;
+
+    void Record(double ms);
+    void Reset();
+    // running windows are sums of per second slots
+    void Add(const LatencyHistogram& other);
+    void Subtract(const LatencyHistogram& other);
+
+    uint64_t Count() const { return total; }
+    double Mean() const { return total ? sumMs / total : 0.0; }
+    // exact, only as long as nothing got subtracted
+    double Min() const { return total ? minMs : 0.0; }
+    double Max() const { return total ? maxMs : 0.0; }
+    // ms, upper edge of the bucket so it never under reports
+    double Percentile(double p) const;
+    LatencySummary Summarize() const;
+
+private:
+    static int BucketOf(uint64_t us);
+    static uint64_t UpperEdge(int bucket);
+
+    uint32_t counts[kBuckets] = {};
+    uint64_t total = 0;
+    double sumMs = 0.0;
+    double minMs = 0.0;
+    double maxMs = 0.0;
+};
+
+// last 1s / 10s / 60s of one metric
+// one histogram per second in a ring, each window is a running sum that gets the
+// expiring second subtracted, so recording stays O(1) and a read is one bucket scan
+// min/max come from the per second slots, a subtracted histogram cant know them
+class RollingLatency {
+public:
+    enum Window { Window1s, Window10s, Window60s, WindowCount };
+    static const int kSlots = 60;
+
+    // nowSec = any monotonic second counter
+    void Record(double ms, int64_t nowSec);
+    LatencySummary Summary(Window window, int64_t nowSec);
+    void Reset();
+
+private:
+    void Advance(int64_t nowSec);
+
+    LatencyHistogram slots[kSlots];
+    LatencyHistogram windows[WindowCount];
+    int64_t currentSec = -1;
+};
@@ -0,0 +1,44 @@
+#include "LatencyModel.hpp"
+#include <algorithm>
+
+void LatencyModel::Add(double seconds) {
+    int bucket = (int)(seconds * 1000.0);
+    bucket = std::min(std::max(bucket, 0), kBuckets - 1);
+    counts[bucket] += 1.0f;
+    total += 1.0f;
+    samples++;
+
+    if (++sinceDecay >= decayEvery) {
+        sinceDecay = 0;
+        total = 0.0f;
+        for (int i = 0; i < kBuckets; i++) {
+            counts[i] *= 0.5f;
+            total += counts[i];
+        }
+    }
+    // scanning 1000 buckets every frame is nothing but no need either
+    if (samples < minSamples || (samples & 15) == 0) Refresh();
+}
+
+void LatencyModel::Reset() {
+    std::fill(counts, counts + kBuckets, 0.0f);
+    total = 0.0f;
+    samples = 0;
+    sinceDecay = 0;
+    cap = fallbackCap;
+}
+
+double LatencyModel::Percentile(double p) const {
+    if (total <= 0.0f) return 0.0;
+    const double want = p * total;
+    double seen = 0.0;
+    for (int i = 0; i < kBuckets; i++) {
+        seen += counts[i];
+        if (seen >= want) return (i + 1) * 0.001; // upper edge, dont under shoot
+    }
+    return kBuckets * 0.001;
+}
+
+void LatencyModel::Refresh() {
+    cap = samples < minSamples ? fallbackCap : Percentile(percentile) * margin;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+// capture -> display latency the render loop actually sees
+// 1ms buckets up to 1s, counts halve every decayEvery samples so it follows the machine
+// (model swap, resolution change, a game eating the gpu)
+// predict uses it to know how far ahead is normal, a stall past the tail isnt extrapolated into
+// render thread only, no locks
+class LatencyModel {
+public:
+    static const int kBuckets = 1000;
+
+    double percentile = 0.99;  // tail that still counts as normal, horizon is capped here
+    double margin = 1.25;      // cap = tail * margin, some slack so the tail itself isnt clipped
+    double fallbackCap = 0.25; // seconds, until minSamples came in
+    int minSamples = 60;
+    int decayEvery = 512;
+
+    void Add(double seconds);
+    void Reset();
+
+    // seconds, 0 with no samples
+    double Percentile(double p) const;
+    // how far predict may look ahead
+    double Cap() const { return cap; }
+    int Samples() const { return samples; }
+
+private:
+    float counts[kBuckets] = {};
+    float total = 0.0f;
+    int samples = 0;
+    int sinceDecay = 0;
+    double cap = 0.25;
+
+    void Refresh();
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+// single producer single consumer handoff that only ever holds the newest item, no locks
+// a push over an item the consumer hasnt taken yet replaces it, latest wins on both ends
+// three slots like TripleBuffer, the replaced item is released on the producer side
+template <typename T>
+class LatestSlot {
+public:
+    // true if an item nobody took got replaced
+    bool Push(T&& value) {
+        buffers[backIndex] = std::move(value);
+        int prev = middle.exchange(backIndex | kFresh, std::memory_order_acq_rel);
+        backIndex = prev & kIndexMask;
+        buffers[backIndex] = T(); // the stale item, or what the consumer already moved out of
+        return (prev & kFresh) != 0;
+    }
+
+    bool TryPop(T& out) {
+        // only the consumer clears the flag, so fresh stays fresh until the exchange below
+        if (!(middle.load(std::memory_order_acquire) & kFresh)) return false;
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & kIndexMask;
+        out = std::move(buffers[frontIndex]);
+        buffers[frontIndex] = T();
+        return true;
+    }
+
+    bool Empty() const {
+        return !(middle.load(std::memory_order_acquire) & kFresh);
+    }
+
+private:
+    static const int kIndexMask = 3;
+    static const int kFresh = 4; // middle holds something the consumer hasnt taken
+
+    T buffers[3];
+    int backIndex = 0;                 // producer only
+    alignas(64) std::atomic<int> middle{1};
+    alignas(64) int frontIndex = 2;    // consumer only
+};
@@ -0,0 +1,92 @@
+#include "ModelCache.hpp"
+#include <onnxruntime_cxx_api.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+bool HashFile(const std::string& path, uint64_t& hash) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    hash = 1469598103934665603ull;
+    std::vector<char> chunk(1 << 16);
+    while (file) {
+        file.read(chunk.data(), (std::streamsize)chunk.size());
+        std::streamsize got = file.gcount();
+        for (std::streamsize i = 0; i < got; i++) {
+            hash ^= (uint8_t)chunk[(size_t)i];
+            hash *= 1099511628211ull;
+        }
+    }
+    return true;
+}
+
+std::string ModelCache::MakeKey(const std::string& modelPath, int numThreads, int width, int height, bool useCUDA) const {
+    uint64_t hash = 0;
+    if (!HashFile(modelPath, hash)) return "";
+
+    // version string has dots, keep the name filesystem friendly
+    std::string ortVersion = OrtGetApiBase()->GetVersionString();
+    for (char& c : ortVersion) if (c == '.') c = '_';
+
+    std::ostringstream key;
+    key << fs::path(modelPath).stem().string() << "_" << std::hex << std::setw(16) << std::setfill('0') << hash << std::dec
+        << "_ort" << ortVersion << "_t" << numThreads << "_" << width << "x" << height << (useCUDA ? "_cuda" : "_cpu");
+    return key.str();
+}
+
+std::string ModelCache::PathFor(const std::string& key) const {
+    if (key.empty()) return "";
+    return (fs::path(dir) / (key + ".onnx")).string();
+}
+
+std::string ModelCache::TempPathFor(const std::string& key) const {
+    if (key.empty()) return "";
+    return (fs::path(dir) / (key + ".onnx.tmp")).string();
+}
+
+bool ModelCache::Has(const std::string& key) const {
+    if (!enabled || key.empty()) return false;
+    std::error_code ec;
+    auto size = fs::file_size(PathFor(key), ec);
+    return !ec && size > 0;
+}
+
+bool ModelCache::Commit(const std::string& key, double coldMs) {
+    if (key.empty()) return false;
+    std::error_code ec;
+    std::string tmp = TempPathFor(key);
+    if (!fs::exists(tmp, ec) || fs::file_size(tmp, ec) == 0) return false;
+
+    // rename so a crash mid write never leaves a half graph under the real name
+    fs::rename(tmp, PathFor(key), ec);
+    if (ec) {
+        std::cerr << "model cache commit failed " << ec.message() << std::endl;
+        fs::remove(tmp, ec);
+        return false;
+    }
+
+    std::ofstream meta(PathFor(key) + ".ms");
+    meta << coldMs;
+    return true;
+}
+
+void ModelCache::Drop(const std::string& key) {
+    if (key.empty()) return;
+    std::error_code ec;
+    fs::remove(PathFor(key), ec);
+    fs::remove(PathFor(key) + ".ms", ec);
+    fs::remove(TempPathFor(key), ec);
+}
+
+double ModelCache::ColdMs(const std::string& key) const {
+    std::ifstream meta(PathFor(key) + ".ms");
+    double ms = -1.0;
+    if (!(meta >> ms)) return -1.0;
+    return ms;
+}
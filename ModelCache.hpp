@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// on disk cache of ort optimized graphs
+// full ORT_ENABLE_ALL optimization takes seconds on weak pcs, the optimized onnx loads with optimizations off
+// key is model content hash + ort version + threads + resolution + execution provider
+// so any change that could make the saved graph wrong just misses
+class ModelCache {
+public:
+    std::string dir = "cache/models";
+    std::atomic<bool> enabled{true}; // the gui flips it while the loader thread builds
+
+    // empty if the model file cant be read
+    std::string MakeKey(const std::string& modelPath, int numThreads, int width, int height, bool useCUDA) const;
+
+    // where the optimized graph for key lives, empty if key is empty
+    std::string PathFor(const std::string& key) const;
+    bool Has(const std::string& key) const;
+
+    // ort writes the optimized graph here while building the session, committed after it succeeded
+    std::string TempPathFor(const std::string& key) const;
+    bool Commit(const std::string& key, double coldMs);
+    void Drop(const std::string& key);
+
+    // cold build time stored next to the graph so a cached start can log both, < 0 if unknown
+    double ColdMs(const std::string& key) const;
+};
+
+// fnv-1a 64 over the file bytes, false if it cant be opened
+bool HashFile(const std::string& path, uint64_t& hash);
@@ -0,0 +1,139 @@
+#include "MotionFilter.hpp"
+#include <algorithm>
+
+void MotionFilter::Init(const cv::Rect2f& box, const MotionFilterConfig& config) {
+    float r = config.measurementNoise * config.measurementNoise;
+    float v = config.initialSpeed * config.initialSpeed;
+    float a = config.constantAcceleration ? config.initialAccel * config.initialAccel : 0.0f;
+
+    x = Axis{};
+    y = Axis{};
+    x.state[0] = box.x + box.width * 0.5f;
+    y.state[0] = box.y + box.height * 0.5f;
+    for (Axis* axis : {&x, &y}) {
+        axis->cov[0][0] = r;
+        axis->cov[1][1] = v;
+        axis->cov[2][2] = a;
+    }
+
+    w = Extent{};
+    h = Extent{};
+    w.state[0] = box.width;
+    h.state[0] = box.height;
+    for (Extent* e : {&w, &h}) {
+        e->cov[0][0] = 2.0f * r;
+        e->cov[1][1] = v * 0.25f; // boxes grow slower than they move
+    }
+}
+
+void MotionFilter::Predict(float dt, const MotionFilterConfig& config) {
+    if (dt <= 0.0f) return;
+    float q = config.constantAcceleration ? config.jerkNoise : config.accelNoise;
+    PredictAxis(x, dt, q, config.constantAcceleration);
+    PredictAxis(y, dt, q, config.constantAcceleration);
+    PredictExtent(w, dt, config.sizeNoise);
+    PredictExtent(h, dt, config.sizeNoise);
+}
+
+void MotionFilter::Update(const cv::Rect2f& box, const MotionFilterConfig& config, float measurementScale) {
+    float s = config.measurementNoise * measurementScale;
+    float r = s * s;
+    UpdateAxis(x, box.x + box.width * 0.5f, r);
+    UpdateAxis(y, box.y + box.height * 0.5f, r);
+    // width is two edges apart, twice the variance of a center
+    UpdateExtent(w, box.width, 2.0f * r);
+    UpdateExtent(h, box.height, 2.0f * r);
+}
+
+cv::Rect2f MotionFilter::Box() const {
+    float bw = std::max(w.state[0], 1.0f);
+    float bh = std::max(h.state[0], 1.0f);
+    return cv::Rect2f(x.state[0] - bw * 0.5f, y.state[0] - bh * 0.5f, bw, bh);
+}
+
+cv::Point2f MotionFilter::InnovationVariance(const MotionFilterConfig& config, float measurementScale) const {
+    float s = config.measurementNoise * measurementScale;
+    return {x.cov[0][0] + s * s, y.cov[0][0] + s * s};
+}
+
+void MotionFilter::PredictAxis(Axis& a, float dt, float q, bool accel) {
+    float dt2 = dt * dt;
+    float half = accel ? 0.5f * dt2 : 0.0f;
+    float dtA = accel ? dt : 0.0f;
+
+    // F = [1 dt dt^2/2; 0 1 dt; 0 0 1], acc column dropped for constant velocity
+    float F[3][3] = {{1.0f, dt, half}, {0.0f, 1.0f, dtA}, {0.0f, 0.0f, accel ? 1.0f : 0.0f}};
+
+    float s[3];
+    for (int i = 0; i < 3; i++) s[i] = F[i][0] * a.state[0] + F[i][1] * a.state[1] + F[i][2] * a.state[2];
+    std::copy(s, s + 3, a.state);
+
+    // P = F P F^T + Q
+    float FP[3][3];
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            FP[i][j] = F[i][0] * a.cov[0][j] + F[i][1] * a.cov[1][j] + F[i][2] * a.cov[2][j];
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            a.cov[i][j] = FP[i][0] * F[j][0] + FP[i][1] * F[j][1] + FP[i][2] * F[j][2];
+
+    float q2 = q * q;
+    if (accel) {
+        // white noise jerk
+        float dt3 = dt2 * dt, dt4 = dt3 * dt, dt5 = dt4 * dt;
+        a.cov[0][0] += q2 * dt5 / 20.0f;
+        a.cov[0][1] += q2 * dt4 / 8.0f;  a.cov[1][0] += q2 * dt4 / 8.0f;
+        a.cov[0][2] += q2 * dt3 / 6.0f;  a.cov[2][0] += q2 * dt3 / 6.0f;
+        a.cov[1][1] += q2 * dt3 / 3.0f;
+        a.cov[1][2] += q2 * dt2 / 2.0f;  a.cov[2][1] += q2 * dt2 / 2.0f;
+        a.cov[2][2] += q2 * dt;
+    } else {
+        // white noise acceleration
+        float dt3 = dt2 * dt;
+        a.cov[0][0] += q2 * dt3 / 3.0f;
+        a.cov[0][1] += q2 * dt2 / 2.0f;  a.cov[1][0] += q2 * dt2 / 2.0f;
+        a.cov[1][1] += q2 * dt;
+    }
+}
+
+void MotionFilter::UpdateAxis(Axis& a, float z, float r) {
+    // H = [1 0 0], scalar innovation so no inverse
+    float s = a.cov[0][0] + r;
+    if (s <= 0.0f) return;
+    float k[3] = {a.cov[0][0] / s, a.cov[1][0] / s, a.cov[2][0] / s};
+    float innovation = z - a.state[0];
+    for (int i = 0; i < 3; i++) a.state[i] += k[i] * innovation;
+
+    float row0[3] = {a.cov[0][0], a.cov[0][1], a.cov[0][2]};
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            a.cov[i][j] -= k[i] * row0[j];
+    // keep it symmetric, float drifts otherwise
+    for (int i = 0; i < 3; i++)
+        for (int j = i + 1; j < 3; j++)
+            a.cov[i][j] = a.cov[j][i] = 0.5f * (a.cov[i][j] + a.cov[j][i]);
+}
+
+void MotionFilter::PredictExtent(Extent& e, float dt, float q) {
+    e.state[0] += e.state[1] * dt;
+    float p00 = e.cov[0][0] + dt * (e.cov[1][0] + e.cov[0][1]) + dt * dt * e.cov[1][1];
+    float p01 = e.cov[0][1] + dt * e.cov[1][1];
+    float q2 = q * q;
+    e.cov[0][0] = p00 + q2 * dt * dt * dt / 3.0f;
+    e.cov[0][1] = e.cov[1][0] = p01 + q2 * dt * dt / 2.0f;
+    e.cov[1][1] += q2 * dt;
+}
+
+void MotionFilter::UpdateExtent(Extent& e, float z, float r) {
+    float s = e.cov[0][0] + r;
+    if (s <= 0.0f) return;
+    float k0 = e.cov[0][0] / s;
+    float k1 = e.cov[1][0] / s;
+    float innovation = z - e.state[0];
+    e.state[0] += k0 * innovation;
+    e.state[1] += k1 * innovation;
+    float p00 = e.cov[0][0], p01 = e.cov[0][1], p11 = e.cov[1][1];
+    e.cov[0][0] = p00 - k0 * p00;
+    e.cov[0][1] = e.cov[1][0] = p01 - k0 * p01;
+    e.cov[1][1] = p11 - k1 * p01;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+struct MotionFilterConfig {
+    bool constantAcceleration = false; // on = also track acceleration, better on smooth curves, worse on sudden turns
+    float accelNoise = 1000.0f;        // px/s^2 white noise on velocity, constant velocity model
+    float jerkNoise = 400.0f;          // px/s^3 white noise on acceleration, constant acceleration model
+    float sizeNoise = 40.0f;           // px/s^2 on width/height rate
+    float measurementNoise = 2.0f;     // px std of a detector box edge
+    float initialSpeed = 400.0f;       // px/s std of a brand new track, nothing known yet
+    float initialAccel = 1500.0f;      // px/s^2 std
+};
+
+// kalman filter for one track, float state in frame pixels
+// center x and y are independent [pos, vel, acc] filters, width and height [size, rate]
+// decoupled axes keep it to a few 3x3 ops per frame instead of one 8x8, and the box only
+// ever comes from the state so nothing gets rounded
+// plain data, lives in a vector next to the tracks
+class MotionFilter {
+public:
+    void Init(const cv::Rect2f& box, const MotionFilterConfig& config);
+    // move the state dt seconds forward
+    void Predict(float dt, const MotionFilterConfig& config);
+    // correct with a measured box, measurementScale > 1 trusts it less
+    void Update(const cv::Rect2f& box, const MotionFilterConfig& config, float measurementScale = 1.0f);
+
+    cv::Rect2f Box() const;
+    cv::Point2f Velocity() const { return {x.state[1], y.state[1]}; }
+    cv::Point2f Acceleration() const { return {x.state[2], y.state[2]}; }
+    // variance of (measured center - predicted center) per axis, for gating
+    cv::Point2f InnovationVariance(const MotionFilterConfig& config, float measurementScale = 1.0f) const;
+
+private:
+    struct Axis {
+        float state[3];  // pos vel acc
+        float cov[3][3];
+    };
+    struct Extent {
+        float state[2];  // size rate
+        float cov[2][2];
+    };
+
+    static void PredictAxis(Axis& a, float dt, float q, bool accel);
+    static void UpdateAxis(Axis& a, float z, float r);
+    static void PredictExtent(Extent& e, float dt, float q);
+    static void UpdateExtent(Extent& e, float z, float r);
+
+    Axis x{}, y{};
+    Extent w{}, h{};
+};
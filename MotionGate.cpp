@@ -0,0 +1,65 @@
+#include "MotionGate.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+void MotionGate::Reset() {
+    reference.release();
+    changedFraction = 0.0f;
+    staticFrames = 0;
+}
+
+void MotionGate::Shrink(const cv::Mat& frame, cv::Mat& out) {
+    // area resize first, gray on the small copy is way cheaper than on the full frame
+    double s = std::min(1.0, (double)config.gridWidth / frame.cols);
+    const cv::Mat* src = &frame;
+    if (s < 1.0) {
+        cv::resize(frame, small, cv::Size(), s, s, cv::INTER_AREA);
+        src = &small;
+    }
+    if (src->channels() == 4) cv::cvtColor(*src, out, cv::COLOR_BGRA2GRAY);
+    else if (src->channels() == 3) cv::cvtColor(*src, out, cv::COLOR_BGR2GRAY);
+    else src->copyTo(out);
+}
+
+bool MotionGate::Check(const cv::Mat& frame) {
+    changedFraction = 0.0f;
+    if (frame.empty()) return true;
+
+    Shrink(frame, current);
+    // first frame or the frame size changed, nothing to compare with
+    if (reference.empty() || reference.rows != current.rows || reference.cols != current.cols) {
+        std::swap(reference, current);
+        staticFrames = 0;
+        changedFraction = 1.0f;
+        return true;
+    }
+
+    const int bs = std::max(config.blockSize, 2);
+    const int blocksX = (current.cols + bs - 1) / bs;
+    const int blocksY = (current.rows + bs - 1) / bs;
+
+    // block sad, rows outer so both images are read in order
+    sums.assign((size_t)blocksX * blocksY, 0);
+    for (int y = 0; y < current.rows; y++) {
+        const uint8_t* a = current.ptr<uint8_t>(y);
+        const uint8_t* b = reference.ptr<uint8_t>(y);
+        int* row = &sums[(size_t)(y / bs) * blocksX];
+        for (int x = 0; x < current.cols; x++) row[x / bs] += std::abs((int)a[x] - (int)b[x]);
+    }
+
+    int changedCount = 0;
+    for (int by = 0; by < blocksY; by++) {
+        int h = std::min(bs, current.rows - by * bs);
+        for (int bx = 0; bx < blocksX; bx++) {
+            int w = std::min(bs, current.cols - bx * bs);
+            if (sums[(size_t)by * blocksX + bx] > config.blockThreshold * w * h) changedCount++;
+        }
+    }
+    changedFraction = (float)changedCount / (blocksX * blocksY);
+
+    if (changedCount < config.minChangedBlocks && ++staticFrames <= config.maxStaticFrames) return false;
+
+    std::swap(reference, current); // this one goes to the detector, compare against it from now on
+    staticFrames = 0;
+    return true;
+}
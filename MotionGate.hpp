@@ -0,0 +1,39 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <vector>
+
+struct MotionGateConfig {
+    int gridWidth = 160;          // frame gets shrunk to this width (gray) before comparing
+    int blockSize = 8;            // px at grid scale, 640 input -> 32x32 px blocks
+    float blockThreshold = 10.0f; // mean abs gray diff for a block to count as changed
+    int minChangedBlocks = 1;     // fewer changed blocks = static
+    int maxStaticFrames = 30;     // detect anyway after this many skips, catches slow fades and keeps tracks honest
+};
+
+// cheap change detector in front of the detector
+// every frame is shrunk to a small gray copy and compared block by block (sad) against the
+// last frame that went to the detector, not the previous one, so slow drift adds up and still triggers
+// verdict: changed -> detect it (and it becomes the new reference), static -> last boxes are still good
+// one thread only, keeps its buffers
+class MotionGate {
+public:
+    MotionGateConfig config;
+
+    // true = run the detector on this frame, it becomes the reference
+    bool Check(const cv::Mat& frame);
+    void Reset();
+
+    float ChangedFraction() const { return changedFraction; } // of all blocks, last Check
+
+private:
+    void Shrink(const cv::Mat& frame, cv::Mat& out);
+
+    cv::Mat reference;   // gray, grid size, last detected frame
+    cv::Mat current;
+    cv::Mat small;
+    std::vector<int> sums;        // per block sad
+    float changedFraction = 0.0f;
+    int staticFrames = 0;
+};
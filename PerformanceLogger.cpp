@@ -3,7 +3,6 @@
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
-#include <numeric>
 #include <ctime>
 #include <iostream>
 #ifdef _WIN32
@@ -12,7 +11,18 @@
     #include <sys/stat.h>
 #endif
 
-PerformanceLogger::PerformanceLogger() {
+namespace {
+// localtime_s is msvc only, posix has it as localtime_r with the args swapped
+void LocalTime(std::tm& tm, std::time_t t) {
+#ifdef _WIN32
+    localtime_s(&tm, &t);
+#else
+    localtime_r(&t, &tm);
+#endif
+}
+}
+
+PerformanceLogger::PerformanceLogger() : histograms(std::make_unique<Histograms>()) {
     sessionStart = std::chrono::high_resolution_clock::now();
     lastFrameTime = sessionStart;
 }
@@ -25,27 +35,26 @@ void PerformanceLogger::SetLogging(bool logging) {
     if (logging && !isLogging) {
         // start logging
         StartSession();
+        return;
     }
+    std::lock_guard<std::mutex> lock(statsMutex);
     isLogging = logging;
 }
 
 void PerformanceLogger::StartSession() {
+    std::lock_guard<std::mutex> lock(statsMutex);
     sessionStart = std::chrono::high_resolution_clock::now();
-    lastFrameTime = sessionStart;
-    inferenceTimes.clear();
-    frameTimes.clear();
-    confidences.clear();
-    detectionCounts.clear();
-    totalDetections = 0;
-    totalFrames = 0;
-    framesWithDetections = 0;
+    for (auto& h : histograms->session) h.Reset();
+    totals = SessionTotals();
     isLogging = true;
 }
 
 void PerformanceLogger::StopAndExport() {
-    if (!isLogging || totalFrames == 0) return;
-    
-    isLogging = false;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        if (!isLogging || totals.frames == 0) return;
+        isLogging = false;
+    }
     
     // create logs dir if not exist
     std::string logsDir = "logs";
@@ -58,7 +67,7 @@ void PerformanceLogger::StopAndExport() {
     // gen filename with timestamp
     auto now = std::time(nullptr);
     std::tm tm;
-    localtime_s(&tm, &now);
+    LocalTime(tm, now);
     
     std::ostringstream filename;
     filename << logsDir << "/performance_log_" 
@@ -68,49 +77,117 @@ void PerformanceLogger::StopAndExport() {
     ExportToCSV(filename.str());
 }
 
-void PerformanceLogger::RecordFrame(double inferenceMs, int detectionCount, float avgConfidence) {
+int64_t PerformanceLogger::NowSec() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void PerformanceLogger::RecordInference(double inferenceMs) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    // ema, short enough to follow a res change within a few frames
+    double prev = recentInferenceMs.load();
+    recentInferenceMs = (prev <= 0.0) ? inferenceMs : prev + (inferenceMs - prev) * 0.2;
+
+    histograms->rolling[MetricInference].Record(inferenceMs, NowSec());
+    if (isLogging) histograms->session[MetricInference].Record(inferenceMs);
+}
+
+void PerformanceLogger::RecordMotionGate(bool skipped) {
+    if (!isLogging) return; // cheap out, checked again under the lock
+    std::lock_guard<std::mutex> lock(statsMutex);
     if (!isLogging) return;
-    
+    totals.gateFrames++;
+    if (skipped) totals.gateSkipped++;
+}
+
+double PerformanceLogger::GetMotionSkipRate() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return totals.gateFrames ? (double)totals.gateSkipped / totals.gateFrames : 0.0;
+}
+
+int PerformanceLogger::GetTotalDetections() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return totals.detections;
+}
+
+int PerformanceLogger::GetTotalFrames() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return totals.frames;
+}
+
+void PerformanceLogger::RecordFrame(double inferenceMs, int detectionCount, float avgConfidence) {
     auto now = std::chrono::high_resolution_clock::now();
+    std::lock_guard<std::mutex> lock(statsMutex);
     double frameTime = std::chrono::duration<double, std::milli>(now - lastFrameTime).count();
-    
-    inferenceTimes.push_back(inferenceMs);
-    frameTimes.push_back(frameTime);
-    detectionCounts.push_back(detectionCount);
+    lastFrameTime = now;
+
+    int64_t sec = NowSec();
+    histograms->rolling[MetricLatency].Record(inferenceMs, sec);
+    histograms->rolling[MetricFrameTime].Record(frameTime, sec);
+    if (!isLogging) return;
+
+    histograms->session[MetricLatency].Record(inferenceMs);
+    histograms->session[MetricFrameTime].Record(frameTime);
     if (avgConfidence > 0) {
-        confidences.push_back(avgConfidence);
+        totals.confidenceSum += avgConfidence;
+        totals.confidenceCount++;
     }
-    totalDetections += detectionCount;
+    totals.detections += detectionCount;
     if (detectionCount > 0) {
-        framesWithDetections++;
+        totals.framesWithDetections++;
     }
-    totalFrames++;
-    
-    lastFrameTime = now;
+    totals.frames++;
+}
+
+const char* PerformanceLogger::MetricName(PerfMetric metric) {
+    switch (metric) {
+    case MetricLatency: return "AI Latency";
+    case MetricInference: return "Model Run";
+    case MetricFrameTime: return "Frame Time";
+    default: return "?";
+    }
+}
+
+LatencySummary PerformanceLogger::GetSessionSummary(PerfMetric metric) const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return histograms->session[metric].Summarize();
+}
+
+LatencySummary PerformanceLogger::GetWindowSummary(PerfMetric metric, RollingLatency::Window window) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return histograms->rolling[metric].Summary(window, NowSec());
 }
 
 void PerformanceLogger::ExportToCSV(const std::string& filename) {
-    if (inferenceTimes.empty()) return;
+    LatencySummary metrics[MetricCount];
+    SessionTotals t;
+    {
+        // one snapshot, recorders may already be counting a new session
+        std::lock_guard<std::mutex> lock(statsMutex);
+        for (int m = 0; m < MetricCount; m++) metrics[m] = histograms->session[m].Summarize();
+        t = totals;
+    }
+    const LatencySummary& ai = metrics[MetricLatency];
+    const LatencySummary& frame = metrics[MetricFrameTime];
+    if (ai.count == 0) return;
     
     std::ofstream file(filename);
     if (!file.is_open()) return;
     
     // calc stats
-    double avgInference = std::accumulate(inferenceTimes.begin(), inferenceTimes.end(), 0.0) / inferenceTimes.size();
-    double minInference = *std::min_element(inferenceTimes.begin(), inferenceTimes.end());
-    double maxInference = *std::max_element(inferenceTimes.begin(), inferenceTimes.end());
+    double avgInference = ai.mean;
+    double minInference = ai.min;
+    double maxInference = ai.max;
     
-    double avgFrameTime = std::accumulate(frameTimes.begin(), frameTimes.end(), 0.0) / frameTimes.size();
-    double avgFPS = 1000.0 / avgFrameTime;
-    double minFPS = 1000.0 / (*std::max_element(frameTimes.begin(), frameTimes.end()));
-    double maxFPS = 1000.0 / (*std::min_element(frameTimes.begin(), frameTimes.end()));
+    double avgFPS = frame.mean > 0.0 ? 1000.0 / frame.mean : 0.0;
+    double minFPS = frame.max > 0.0 ? 1000.0 / frame.max : 0.0;
+    double maxFPS = frame.min > 0.0 ? 1000.0 / frame.min : 0.0;
     
-    double avgConfidence = confidences.empty() ? 0.0 : 
-        std::accumulate(confidences.begin(), confidences.end(), 0.0) / confidences.size();
+    double avgConfidence = t.confidenceCount == 0 ? 0.0 : t.confidenceSum / t.confidenceCount;
     
     double sessionDuration = GetSessionDuration();
-    double detectionRate = (double)framesWithDetections / totalFrames * 100.0;
-    double avgDetectionsPerFrame = (double)totalDetections / totalFrames;
+    double detectionRate = (double)t.framesWithDetections / t.frames * 100.0;
+    double avgDetectionsPerFrame = (double)t.detections / t.frames;
+    double motionSkipRate = t.gateFrames ? (double)t.gateSkipped / t.gateFrames : 0.0;
     
     // get session start time
     auto sessionStartTime = std::chrono::system_clock::now() - 
@@ -118,7 +195,7 @@ void PerformanceLogger::ExportToCSV(const std::string& filename) {
             std::chrono::high_resolution_clock::now() - sessionStart);
     std::time_t startTime = std::chrono::system_clock::to_time_t(sessionStartTime);
     std::tm tm;
-    localtime_s(&tm, &startTime);
+    LocalTime(tm, startTime);
     
     // write csv header more metrics
     // standard trick needed for excel separator
@@ -126,14 +203,21 @@ void PerformanceLogger::ExportToCSV(const std::string& filename) {
     file << "Session Start;Session Duration (sec);Total Frames;Frames w/ Detections;Detection Rate (%);"
          << "Avg AI Time (ms);Min AI Time (ms);Max AI Time (ms);"
          << "Avg FPS;Min FPS;Max FPS;"
-         << "Total Detections;Avg Detections/Frame;Avg Confidence\n";
+         << "Total Detections;Avg Detections/Frame;Avg Confidence;Motion Skip Rate (%)";
+    // percentiles per metric from the session histograms
+    for (int m = 0; m < MetricCount; m++) {
+        const char* name = MetricName((PerfMetric)m);
+        file << ";" << name << " p50 (ms);" << name << " p90 (ms);" << name << " p99 (ms);"
+             << name << " p99.9 (ms);" << name << " Max (ms)";
+    }
+    file << "\n";
     
     // write data each value own cell semicolons
     file << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << ";"
          << std::fixed << std::setprecision(2)
          << sessionDuration << ";"
-         << totalFrames << ";"
-         << framesWithDetections << ";"
+         << t.frames << ";"
+         << t.framesWithDetections << ";"
          << detectionRate << ";"
          << avgInference << ";"
          << minInference << ";"
@@ -141,23 +225,29 @@ void PerformanceLogger::ExportToCSV(const std::string& filename) {
          << avgFPS << ";"
          << minFPS << ";"
          << maxFPS << ";"
-         << totalDetections << ";"
+         << t.detections << ";"
          << avgDetectionsPerFrame << ";"
-         << avgConfidence << "\n";
+         << avgConfidence << ";"
+         << motionSkipRate * 100.0;
+    for (const auto& m : metrics) {
+        file << ";" << m.p50 << ";" << m.p90 << ";" << m.p99 << ";" << m.p999 << ";" << m.max;
+    }
+    file << "\n";
     
     file.close();
     std::cout << "Performance log exported to: " << filename << std::endl;
 }
 
+// O(1), mean is kept as a running sum in the histogram
 double PerformanceLogger::GetAvgInferenceMs() const {
-    if (inferenceTimes.empty()) return 0.0;
-    return std::accumulate(inferenceTimes.begin(), inferenceTimes.end(), 0.0) / inferenceTimes.size();
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return histograms->session[MetricLatency].Mean();
 }
 
 double PerformanceLogger::GetAvgFPS() const {
-    if (frameTimes.empty()) return 0.0;
-    double avgFrameTime = std::accumulate(frameTimes.begin(), frameTimes.end(), 0.0) / frameTimes.size();
-    return 1000.0 / avgFrameTime;
+    std::lock_guard<std::mutex> lock(statsMutex);
+    double avgFrameTime = histograms->session[MetricFrameTime].Mean();
+    return avgFrameTime > 0.0 ? 1000.0 / avgFrameTime : 0.0;
 }
 
 double PerformanceLogger::GetSessionDuration() const {
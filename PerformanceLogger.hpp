@@ -1,9 +1,23 @@
 #pragma once
 
+#include "LatencyHistogram.hpp"
 #include <string>
-#include <vector>
 #include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 
+enum PerfMetric {
+    MetricLatency,   // capture -> render, what RecordFrame gets
+    MetricInference, // model run, RecordInference
+    MetricFrameTime, // between RecordFrame calls
+    MetricCount,
+};
+
+// histograms instead of per frame vectors, memory stays the same however long a session runs
+// rolling 1s/10s/60s windows always run, the session totals only while logging
+// recorders and readers sit on different threads (render, capture, infer, gui), one short lock per call
 class PerformanceLogger {
 public:
     PerformanceLogger();
@@ -11,33 +25,58 @@ public:
 
     void StartSession();
     void StopAndExport(); // stop logging and export csv
+    // every render frame, logging or not
     void RecordFrame(double inferenceMs, int detectionCount, float avgConfidence);
-    
+
+    // every detect, logging or not, worker thread writes it
+    void RecordInference(double inferenceMs);
+    double GetRecentInferenceMs() const { return recentInferenceMs.load(); } // smoothed, 0 until first frame
+    // motion gate verdict per captured frame, capture thread writes it, counted while logging
+    void RecordMotionGate(bool skipped);
+    double GetMotionSkipRate() const; // of the frames the gate saw this session, 0..1
+
     bool IsLogging() const { return isLogging; }
     void SetLogging(bool logging);
     
     // get stats for display
     double GetAvgInferenceMs() const;
     double GetAvgFPS() const;
-    int GetTotalDetections() const { return totalDetections; }
-    int GetTotalFrames() const { return totalFrames; }
-    
+    int GetTotalDetections() const;
+    int GetTotalFrames() const;
+    // p50/p90/p99/p99.9/max, ms
+    LatencySummary GetSessionSummary(PerfMetric metric) const;
+    LatencySummary GetWindowSummary(PerfMetric metric, RollingLatency::Window window);
+    static const char* MetricName(PerfMetric metric);
+
 private:
-    bool isLogging = false;
+    std::atomic<bool> isLogging{false}; // flipped under statsMutex, recorders check it again under the lock
+    std::atomic<double> recentInferenceMs{0.0}; // written under statsMutex, read lock free
     
-    std::chrono::high_resolution_clock::time_point sessionStart;
-    std::chrono::high_resolution_clock::time_point lastFrameTime;
+    std::chrono::high_resolution_clock::time_point sessionStart; // set and read by whoever starts/exports sessions (gui)
     
-    // metrics
-    std::vector<double> inferenceTimes;
-    std::vector<double> frameTimes;
-    std::vector<float> confidences;
-    std::vector<int> detectionCounts; // per frame detect counts
-    int totalDetections = 0;
-    int totalFrames = 0;
-    int framesWithDetections = 0;
+    // metrics, everything below under statsMutex
+    std::chrono::high_resolution_clock::time_point lastFrameTime;
+    // ~1MB of buckets, on the heap so a logger on the stack (headless, App in main) stays small
+    struct Histograms {
+        LatencyHistogram session[MetricCount];
+        RollingLatency rolling[MetricCount];
+    };
+    mutable std::mutex statsMutex;
+    std::unique_ptr<Histograms> histograms;
+    // counted only while logging, export copies them out in one go
+    struct SessionTotals {
+        double confidenceSum = 0.0;
+        int confidenceCount = 0;
+        int detections = 0;
+        int frames = 0;
+        int framesWithDetections = 0;
+        uint64_t gateFrames = 0;
+        uint64_t gateSkipped = 0;
+    };
+    SessionTotals totals;
     
     // for fps calc
     double GetSessionDuration() const;
+    static int64_t NowSec();
     void ExportToCSV(const std::string& filename);
 };
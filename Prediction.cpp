@@ -1,229 +1,267 @@
 #include "Prediction.hpp"
+#include "../TraceRecorder.hpp"
 
-void Prediction::UpdateHistory(const std::vector<Detection>& currentDetections) {
-    auto currTime = std::chrono::high_resolution_clock::now();
-    
+float Prediction::MeasurementScale() const {
+    // slider 0.1 .. 1, default 0.6 is the tuned noise, lower = trust boxes less = smoother
+    return 0.6f / std::max(smoothingFactor, 0.05f);
+}
+
+double Prediction::StepTo(FrameClock::time_point t) const {
+    double dt = std::chrono::duration<double>(t - stateTime).count();
+    // safety zero division
+    if (dt < 0.0001) dt = 0.0001;
+    return dt;
+}
+
+void Prediction::UpdateHistory(const std::vector<Detection>& currentDetections, const std::vector<Detection>* lowDetections,
+                               const CapturedFrame* frame) {
+    TRACE_SCOPE("update_history");
+    // observation time is when the pixels were grabbed, not when inference happened to finish
+    FrameClock::time_point observed = frame ? frame->captureTime : FrameClock::now();
+    // AlignToFlow already moved these boxes up to the newest flow frame
+    if (flow.HasReference() && flowTime > observed) observed = flowTime;
+
+    // nothing to confirm against on the very first update, those tracks start confirmed
+    const bool firstUpdate = firstRun;
     if (firstRun) {
-        prevDetections = currentDetections;
-        prevTime = currTime;
+        stateTime = observed;
         firstRun = false;
-        return;
     }
 
-    double dt = std::chrono::duration<double>(currTime - prevTime).count();
-    // safety zero division
-    if (dt < 0.0001) dt = 0.0001; 
-    
+    double dt = StepTo(observed);
+
     if (!enabled) {
         // fix dont clear history when disabled need smooth prevent blink
         // just dont apply prediction in predict func
         // keep processing detects for smooth track
-    } 
-
-    // copy so we can mod velocities
-    std::vector<Detection> processed = currentDetections;
-
-    // match and calc velocity
-    static int nextTrackingId = 0;
-    
-    // 1. predict where old objects should be now
-    for (auto& prev : prevDetections) {
-        float px = prev.velocity.x * (float)dt;
-        float py = prev.velocity.y * (float)dt;
-        prev.box.x += (int)px;
-        prev.box.y += (int)py;
-    }
-
-    // 2. match current to prev greedy with iou distance
-    // we want best match not just first one
-    std::vector<bool> matchedPrev(prevDetections.size(), false);
-    std::vector<bool> matchedCurr(currentDetections.size(), false);
-    
-    std::vector<Detection> finalDetections;
-    
-    // simple greedy match iter current find closest prev
-    // ideally iou or hungarian but distance center center fast
-    
-    struct Match {
-        int curIdx;
-        int prevIdx;
-        float dist;
+    }
+
+    // scratch for this update comes from the arena, freed in one go next time
+    arena.Reset();
+    measScale = MeasurementScale();
+
+    // filter state -> what the rest of the app reads, box stays float
+    auto writeState = [](Detection& d, const MotionFilter& f) {
+        d.box = f.Box();
+        d.smoothBox = d.box;
+        d.velocity = f.Velocity();
+        d.acceleration = f.Acceleration();
     };
-    std::vector<Match> matches;
-    
-    for (size_t i = 0; i < currentDetections.size(); i++) {
-        cv::Point2f cCenter(currentDetections[i].box.x + currentDetections[i].box.width/2.0f, 
-                            currentDetections[i].box.y + currentDetections[i].box.height/2.0f);
-                            
-        for (size_t j = 0; j < prevDetections.size(); j++) {
-            if (prevDetections[j].classId != currentDetections[i].classId) continue;
-            
-            cv::Point2f pCenter(prevDetections[j].box.x + prevDetections[j].box.width/2.0f, 
-                                prevDetections[j].box.y + prevDetections[j].box.height/2.0f);
-                                
-            float dist = (float)cv::norm(cCenter - pCenter);
-            
-            // strict threshold 100px. if farther likely new object
-            // fix increased to 250px catch fast moving objects drift
-            if (dist < 250.0f) {
-                matches.push_back({(int)i, (int)j, dist});
-            }
+
+    // 1. run every track filter forward to now, predicted box + gate for matching
+    for (auto& t : tracks) {
+        t.filter.Predict((float)dt, motion);
+        t.det.box = t.filter.Box();
+        t.variance = t.filter.InnovationVariance(motion, measScale);
+    }
+
+    const int trackCount = (int)tracks.size();
+    const int highCount = (int)currentDetections.size();
+    const int lowCount = lowDetections ? (int)lowDetections->size() : 0;
+    ArenaVector<uint8_t> trackMatched(trackCount, 0, ArenaAllocator<uint8_t>(arena));
+    ArenaVector<uint8_t> highUsed(highCount, 0, ArenaAllocator<uint8_t>(arena));
+    ArenaVector<uint8_t> lowUsed(lowCount, 0, ArenaAllocator<uint8_t>(arena));
+    ArenaVector<int> trackIdx{ArenaAllocator<int>(arena)};
+    ArenaVector<int> detIdx{ArenaAllocator<int>(arena)};
+    trackIdx.reserve(trackCount);
+    detIdx.reserve(std::max(highCount, lowCount));
+
+    // 2. strong detections vs confirmed + lost tracks, see Association.cpp
+    for (int i = 0; i < trackCount; i++) {
+        if (tracks[i].state != TrackState::Tentative) trackIdx.push_back(i);
+    }
+    for (int i = 0; i < highCount; i++) detIdx.push_back(i);
+    MatchRound(association, trackIdx.data(), (int)trackIdx.size(), currentDetections, detIdx.data(), (int)detIdx.size(),
+               trackMatched.data(), highUsed.data());
+
+    // 3. bytetrack second pass, weak detections keep confirmed tracks that the first pass missed
+    // (occluded, blurred, far away) alive instead of dropping them, lost ones need a strong box to come back
+    if (lowCount > 0) {
+        trackIdx.clear();
+        for (int i = 0; i < trackCount; i++) {
+            if (tracks[i].state == TrackState::Confirmed && !trackMatched[i]) trackIdx.push_back(i);
         }
+        detIdx.clear();
+        for (int i = 0; i < lowCount; i++) detIdx.push_back(i);
+        MatchRound(lowAssociation, trackIdx.data(), (int)trackIdx.size(), *lowDetections, detIdx.data(), (int)detIdx.size(),
+                   trackMatched.data(), lowUsed.data());
+    }
+
+    // 4. leftover strong detections vs tentative tracks
+    trackIdx.clear();
+    for (int i = 0; i < trackCount; i++) {
+        if (tracks[i].state == TrackState::Tentative) trackIdx.push_back(i);
+    }
+    detIdx.clear();
+    for (int i = 0; i < highCount; i++) {
+        if (!highUsed[i]) detIdx.push_back(i);
     }
-    
-    // sort matches by distance small first
-    std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b){
-        return a.dist < b.dist;
-    });
-    
-    // assign matches
-    for (const auto& m : matches) {
-        if (matchedCurr[m.curIdx] || matchedPrev[m.prevIdx]) continue;
-        
-        matchedCurr[m.curIdx] = true;
-        matchedPrev[m.prevIdx] = true;
-        
-        // this match
-        Detection& cur = const_cast<Detection&>(currentDetections[m.curIdx]);
-        const Detection& prev = prevDetections[m.prevIdx];
-        
-        // id inheritance
-        if (prev.trackingId == -1) cur.trackingId = nextTrackingId++;
-        else cur.trackingId = prev.trackingId;
-        
-        cur.persistenceFrames = 10; // reset persistence
-        
-        // velocity calc
-        cv::Point2f curCenter(cur.box.x + cur.box.width/2.0f, cur.box.y + cur.box.height/2.0f);
-        cv::Point2f prevCenter(prev.box.x + prev.box.width/2.0f, prev.box.y + prev.box.height/2.0f);
-        
-        cv::Point2f offset = curCenter - prevCenter; // note prevcenter is predicted pos step 1 
-        // logic check step 1 moved prev by velocity so cur should be close to prev
-        // velocity update based on cur oldprev 
-        // but mod prev step 1 
-        // lets rely on simple curpos prevposlastframe dt
-        // need un predicted pos prev for velocity calc
-        // revert predict for velocity calc
-        float px = prev.velocity.x * (float)dt;
-        float py = prev.velocity.y * (float)dt;
-        cv::Point2f oldPrevCenter = prevCenter - cv::Point2f(px, py);
-        
-        cv::Point2f rawVelocity = (curCenter - oldPrevCenter) * (1.0f / (float)dt);
-
-        // cap n damp
-        float speed = (float)cv::norm(rawVelocity);
-        if (speed > 2000.0f) rawVelocity *= (2000.0f / speed); // max cap
-        
-        float alpha = smoothingFactor;
-        if (speed < 50.0f) { alpha = 0.2f; rawVelocity *= 0.5f; } // friction
-
-        cur.velocity = rawVelocity * alpha + prev.velocity * (1.0f - alpha);
-        
-        // fix velocity hysteresis anti wobble
-        float dot = rawVelocity.x * prev.velocity.x + rawVelocity.y * prev.velocity.y;
-        if (dot < 0) rawVelocity = {0, 0}; 
-
-        // fix anti drift reverted relaxed per user feedback
-        // only hard stop if motionless prevent snap back lag feeling
-        float instantSpeed = (float)cv::norm(rawVelocity);
-        if (instantSpeed < 2.0f) { // tuned relaxed 10.0 -> 2.0
-             cur.velocity = {0, 0};
+    MatchRound(association, trackIdx.data(), (int)trackIdx.size(), currentDetections, detIdx.data(), (int)detIdx.size(),
+               trackMatched.data(), highUsed.data());
+
+    // 5. lifecycle
+    nextTracks.clear();
+    for (int i = 0; i < trackCount; i++) {
+        Track& t = tracks[i];
+        if (trackMatched[i]) {
+            t.hits++;
+            t.det.persistenceFrames = maxLostFrames;
+            if (t.state == TrackState::Lost || t.hits >= confirmHits) t.state = TrackState::Confirmed;
         } else {
-             cur.velocity = rawVelocity * alpha + prev.velocity * (1.0f - alpha);
+            // tentative never got going, lost ran out of coasting
+            if (t.state == TrackState::Tentative) continue;
+            if (t.det.persistenceFrames <= 0) continue;
+            t.det.persistenceFrames--;
+            t.state = TrackState::Lost;
+            t.hits = 0;
         }
+        writeState(t.det, t.filter);
+        nextTracks.push_back(t);
+    }
 
-        // fix pos deadzone static objects
-        // if object truly static very low velocity lock pos completely
-        float currentSpeed = (float)cv::norm(cur.velocity);
-        bool isStatic = (currentSpeed < 15.0f); // tuned increased thresh static detection
-        
-        if (isStatic) {
-            // object static lock pos prevent jitter
-            float dx = std::abs((float)cur.box.x - prev.smoothBox.x);
-            float dy = std::abs((float)cur.box.y - prev.smoothBox.y);
-            
-            if (dx < 3.0f) cur.box.x = (int)prev.smoothBox.x; // lock x
-            if (dy < 3.0f) cur.box.y = (int)prev.smoothBox.y; // lock y
-        }
+    // 6. strong detections nobody took are new tracks
+    for (int i = 0; i < highCount; i++) {
+        if (highUsed[i]) continue;
+        Track t;
+        t.det = currentDetections[i];
+        t.det.trackingId = nextTrackingId++;
+        t.det.persistenceFrames = maxLostFrames;
+        t.filter.Init(t.det.box, motion);
+        t.hits = 1;
+        t.state = (firstUpdate || confirmHits <= 1) ? TrackState::Confirmed : TrackState::Tentative;
+        writeState(t.det, t.filter);
+        nextTracks.push_back(t);
+    }
 
-        // fix size deadzone lock tiny changes
-        // tuned increased 5.0f request
-        float dw = std::abs((float)cur.box.width - prev.smoothBox.width);
-        float dh = std::abs((float)cur.box.height - prev.smoothBox.height);
-        
-        float targetW = (float)cur.box.width;
-        float targetH = (float)cur.box.height;
-        
-        if (dw < 5.0f) targetW = prev.smoothBox.width; // lock
-        if (dh < 5.0f) targetH = prev.smoothBox.height; // lock
-        
-        // smooth pos normal alpha
-        cv::Rect2f targetP((float)cur.box.x, (float)cur.box.y, targetW, targetH);
-        
-        cur.smoothBox.x = prev.smoothBox.x * (1.0f - alpha) + targetP.x * alpha;
-        cur.smoothBox.y = prev.smoothBox.y * (1.0f - alpha) + targetP.y * alpha;
-        
-        // smooth size heavy damp 0.05 but applied locked target
-        // if locked target == prev so result == prev perfect lock
-        float sizeAlpha = 0.05f;
-        cur.smoothBox.width = prev.smoothBox.width * (1.0f - sizeAlpha) + targetW * sizeAlpha;
-        cur.smoothBox.height = prev.smoothBox.height * (1.0f - sizeAlpha) + targetH * sizeAlpha;
-        
-        // write back int box
-        cur.box.x = (int)cur.smoothBox.x;
-        cur.box.y = (int)cur.smoothBox.y;
-        cur.box.width = (int)cur.smoothBox.width;
-        cur.box.height = (int)cur.smoothBox.height;
-        
-        finalDetections.push_back(cur);
-    }
-    
-    // 3. handle unmatched current new objevts
-    for (size_t i = 0; i < currentDetections.size(); i++) {
-        if (!matchedCurr[i]) {
-            Detection d = currentDetections[i];
-            d.trackingId = nextTrackingId++;
-            d.persistenceFrames = 10;
-            d.velocity = {0,0};
-            // init smoothbox
-            d.smoothBox = cv::Rect2f((float)d.box.x, (float)d.box.y, (float)d.box.width, (float)d.box.height);
-            finalDetections.push_back(d);
-        }
+    tracks.swap(nextTracks);
+    RebuildVisible();
+    if (observed > stateTime) stateTime = observed;
+    if (frame) stateFrameId = frame->frameId;
+}
+
+void Prediction::RebuildVisible() {
+    visible.clear();
+    for (const auto& t : tracks) {
+        if (t.state == TrackState::Confirmed || (showLost && t.state == TrackState::Lost)) visible.push_back(t.det);
     }
-    
-    // 4. handle unmatched prev coast persist
-    // user request removed entirely prevent ghosts flying objects
-    // if not matched gone immediately
-    /*
-    for (size_t i = 0; i < prevDetections.size(); i++) {
-        if (!matchedPrev[i]) {
-            Detection d = prevDetections[i];
-            if (d.persistenceFrames > 0) {
-                 // ... coast logic removed ...
-            }
-        }
+}
+
+void Prediction::Propagate(const CapturedFrame& frame) {
+    TRACE_SCOPE("propagate");
+    if (frame.image.empty()) return;
+    if (flow.HasReference() && frame.captureTime <= flowTime) return; // tracks already saw something newer
+
+    arena.Reset();
+    const int n = (int)tracks.size();
+    ArenaVector<cv::Rect2f> boxes(n, cv::Rect2f(), ArenaAllocator<cv::Rect2f>(arena));
+    ArenaVector<uint8_t> ok(n, 0, ArenaAllocator<uint8_t>(arena));
+    for (int i = 0; i < n; i++) boxes[i] = tracks[i].det.box;
+    flow.Track(frame.image, boxes.data(), ok.data(), n);
+    flowTime = frame.captureTime;
+
+    double dt = StepTo(frame.captureTime);
+    if (frame.captureTime > stateTime) stateTime = frame.captureTime;
+    stateFrameId = frame.frameId;
+
+    // flow box is a measurement like a detection, just noisier, so velocity keeps up between keyframes
+    measScale = MeasurementScale();
+    for (int i = 0; i < n; i++) {
+        Track& t = tracks[i];
+        t.filter.Predict((float)dt, motion);
+        if (ok[i]) t.filter.Update(boxes[i], motion, measScale * flowNoiseScale);
+        t.det.box = t.filter.Box();
+        t.det.smoothBox = t.det.box;
+        t.det.velocity = t.filter.Velocity();
+        t.det.acceleration = t.filter.Acceleration();
+    }
+    RebuildVisible();
+}
+
+void Prediction::AlignToFlow(const CapturedFrame& detectedFrame, std::vector<Detection>& detections, std::vector<Detection>* lowDetections) {
+    if (detectedFrame.image.empty()) return;
+    if (!flow.HasReference() || detectedFrame.captureTime >= flowTime) {
+        // nothing newer seen, this frame is where flow continues from
+        flow.SetReference(detectedFrame.image);
+        flowTime = detectedFrame.captureTime;
+        return;
     }
-    */
 
-    prevDetections = finalDetections;
-    prevTime = currTime;
+    // flow frames got ahead while the detector ran, bring the detections up to them in one step
+    arena.Reset();
+    const int high = (int)detections.size();
+    const int low = lowDetections ? (int)lowDetections->size() : 0;
+    ArenaVector<cv::Rect2f> boxes(high + low, cv::Rect2f(), ArenaAllocator<cv::Rect2f>(arena));
+    ArenaVector<uint8_t> ok(high + low, 0, ArenaAllocator<uint8_t>(arena));
+    for (int i = 0; i < high; i++) boxes[i] = detections[i].box;
+    for (int i = 0; i < low; i++) boxes[high + i] = (*lowDetections)[i].box;
+    flow.TrackToReference(detectedFrame.image, boxes.data(), ok.data(), high + low);
+    for (int i = 0; i < high; i++) {
+        if (ok[i]) detections[i].box = boxes[i];
+    }
+    for (int i = 0; i < low; i++) {
+        if (ok[high + i]) (*lowDetections)[i].box = boxes[high + i];
+    }
+}
+
+void Prediction::MatchRound(Associator& assoc, const int* trackIdx, int trackCount,
+                            const std::vector<Detection>& detections, const int* detIdx, int detCount,
+                            uint8_t* trackMatched, uint8_t* detUsed) {
+    if (trackCount == 0 || detCount == 0) return;
+
+    ArenaVector<cv::Rect2f> trackBoxes(trackCount, cv::Rect2f(), ArenaAllocator<cv::Rect2f>(arena));
+    ArenaVector<int> trackClasses(trackCount, 0, ArenaAllocator<int>(arena));
+    ArenaVector<cv::Point2f> trackVariance(trackCount, cv::Point2f(), ArenaAllocator<cv::Point2f>(arena));
+    for (int k = 0; k < trackCount; k++) {
+        const Track& t = tracks[trackIdx[k]];
+        trackBoxes[k] = t.det.box;
+        trackClasses[k] = t.det.classId;
+        trackVariance[k] = t.variance;
+    }
+    ArenaVector<cv::Rect2f> detBoxes(detCount, cv::Rect2f(), ArenaAllocator<cv::Rect2f>(arena));
+    ArenaVector<int> detClasses(detCount, 0, ArenaAllocator<int>(arena));
+    for (int k = 0; k < detCount; k++) {
+        detBoxes[k] = detections[detIdx[k]].box;
+        detClasses[k] = detections[detIdx[k]].classId;
+    }
+
+    assoc.Run(trackBoxes.data(), trackClasses.data(), trackCount,
+              detBoxes.data(), detClasses.data(), detCount, trackVariance.data());
+
+    for (const auto& m : assoc.Matches()) {
+        int ti = trackIdx[m.track];
+        int di = detIdx[m.detection];
+        Track& t = tracks[ti];
+        const Detection& d = detections[di];
+
+        // correct the track with the measured box, id stays, the rest comes from the detection
+        t.filter.Update(d.box, motion, measScale);
+        t.det.confidence = d.confidence;
+        t.det.classId = d.classId;
+        t.det.label = d.label;
+
+        trackMatched[ti] = 1;
+        detUsed[di] = 1;
+    }
 }
 
 std::vector<Detection> Prediction::Predict(const std::vector<Detection>& detections, double latencySec) {
-    if (!enabled) return detections; // fix return unmod if disabled
-    if (latencySec > 0.25) latencySec = 0.25; // cap predict time
+    std::vector<Detection> predicted;
+    Predict(detections, latencySec, predicted);
+    return predicted;
+}
+
+void Prediction::Predict(const std::vector<Detection>& detections, double latencySec, std::vector<Detection>& predicted) const {
+    predicted.assign(detections.begin(), detections.end());
+    if (!enabled) return; // fix return unmod if disabled
+    // cap from the measured latency tail, further than that is a stall not latency
+    if (latencySec > latency.Cap()) latencySec = latency.Cap();
+    if (latencySec < 0.0) latencySec = 0.0;
+    const float t = (float)latencySec;
 
-    std::vector<Detection> predicted = detections;
     for (auto& det : predicted) {
-        // fix dont predict static objects velocity near zero
-        float speed = std::sqrt(det.velocity.x * det.velocity.x + det.velocity.y * det.velocity.y);
-        if (speed < 15.0f) { // tuned increased 5.0 to 15.0 aggressive static detect
-            // object essentially static dont apply prediction avoid jitter
-            continue;
-        }
-        
-        float shiftX = det.velocity.x * (float)latencySec * amount;
-        float shiftY = det.velocity.y * (float)latencySec * amount;
+        // extrapolate the filter state, static tracks already have ~0 velocity so no deadzone needed
+        float shiftX = (det.velocity.x * t + 0.5f * det.acceleration.x * t * t) * amount;
+        float shiftY = (det.velocity.y * t + 0.5f * det.acceleration.y * t * t) * amount;
 
         // tuned increased cap 100 to 500 prevent falling behind fast objects
         const float MAX_SHIFT = 500.0f;
@@ -232,8 +270,7 @@ std::vector<Detection> Prediction::Predict(const std::vector<Detection>& detecti
         if (shiftY > MAX_SHIFT) shiftY = MAX_SHIFT;
         if (shiftY < -MAX_SHIFT) shiftY = -MAX_SHIFT;
 
-        det.box.x += (int)shiftX;
-        det.box.y += (int)shiftY;
+        det.box.x += shiftX;
+        det.box.y += shiftY;
     }
-    return predicted;
 }
@@ -3,19 +3,99 @@
 #include <vector>
 #include <chrono>
 #include "../TrashDetector.hpp" // adjusted path if needed assume features subdir
+#include "../FrameArena.hpp"
+#include "../Association.hpp"
+#include "../MotionFilter.hpp"
+#include "../FlowPropagator.hpp"
+#include "../FrameSource.hpp"
+#include "../LatencyModel.hpp"
+
+// where a track is in its life
+// tentative -> confirmed after confirmHits matches in a row, a miss before that deletes it
+// confirmed -> lost on a miss, lost coasts on its filter and comes back with the same id when matched
+// lost for more than maxLostFrames updates -> deleted
+enum class TrackState : uint8_t {
+    Tentative,
+    Confirmed,
+    Lost,
+};
 
 class Prediction {
 public:
     bool enabled = true;
     float amount = 1.0f;          // was predictionAmount
-    float smoothingFactor = 0.6f; // was predictionSmoothing
+    float smoothingFactor = 0.6f; // was predictionSmoothing, now how much the filter trusts a new box
+    MotionFilterConfig motion;    // per track kalman, see MotionFilter.hpp
+
+    int confirmHits = 2;          // a new box has to match this many updates in a row before it shows
+    int maxLostFrames = 10;       // updates a lost track coasts before it is gone
+    bool showLost = false;        // output coasting tracks too, off by default (ghosts)
+
+    FlowConfig& GetFlowConfig() { return flow.config; }
+    float flowNoiseScale = 2.0f;  // a flow box counts as this much noisier than a detector box
+
+    Prediction() { lowAssociation.config.minIou = 0.3f; } // weak boxes only keep a track they clearly overlap
+
+    // measured capture -> display latency, predict never looks further ahead than its cap
+    // render thread only, it feeds it and calls Predict
+    LatencyModel latency;
 
-    void UpdateHistory(const std::vector<Detection>& currentDetections);
+    // lowDetections are the ones under the conf threshold (Decode lowOut), second pass only, may be null
+    // frame = the one the boxes came from, filters step by its capture time so inference jitter
+    // doesnt end up in the velocity, null = now for callers without one
+    void UpdateHistory(const std::vector<Detection>& currentDetections, const std::vector<Detection>* lowDetections = nullptr,
+                       const CapturedFrame* frame = nullptr);
+    // latencySec = how far the wanted moment is past StateTime, capped by latency.Cap()
     std::vector<Detection> Predict(const std::vector<Detection>& detections, double latencySec);
-    std::vector<Detection> GetProcessed() { return prevDetections; } // added
+    // same into out, reuses its capacity so the render loop doesnt allocate
+    void Predict(const std::vector<Detection>& detections, double latencySec, std::vector<Detection>& out) const;
+    // keyframe mode, frames in between detector runs
+    // tracks follow frame by optical flow, no lifecycle changes, call GetProcessed after
+    void Propagate(const CapturedFrame& frame);
+    // call before UpdateHistory with the frame the detections came from
+    // if the tracks already followed newer frames the boxes get moved up to the newest one
+    void AlignToFlow(const CapturedFrame& detectedFrame, std::vector<Detection>& detections, std::vector<Detection>* lowDetections);
+    void ResetFlow() { flow.Reset(); }
+
+    // confirmed tracks (plus lost ones with showLost)
+    const std::vector<Detection>& GetProcessed() const { return visible; } // added
+    size_t TrackCount() const { return tracks.size(); } // every state
+    // capture time / id of the newest frame the track state describes
+    FrameClock::time_point StateTime() const { return stateTime; }
+    uint64_t StateFrameId() const { return stateFrameId; }
 
 private:
-    std::vector<Detection> prevDetections;
-    std::chrono::high_resolution_clock::time_point prevTime;
+    struct Track {
+        Detection det;           // box from the filter, rest from the last matched detection
+        MotionFilter filter;
+        cv::Point2f variance;    // innovation variance this update, for the gate
+        TrackState state = TrackState::Tentative;
+        int hits = 0;            // matches in a row
+    };
+
+    // one association round between a subset of tracks and a subset of detections (index lists)
+    // matched tracks get their filter corrected, both sides get marked
+    void MatchRound(Associator& assoc, const int* trackIdx, int trackCount,
+                    const std::vector<Detection>& detections, const int* detIdx, int detCount,
+                    uint8_t* trackMatched, uint8_t* detUsed);
+
+    std::vector<Track> tracks;
+    std::vector<Track> nextTracks;   // built here then swapped, both keep capacity
+    std::vector<Detection> visible;
+    FrameArena arena{16 * 1024};     // per update scratch (matches flags etc)
+    Associator association;          // strong detections, prev <-> current, keeps its buffers
+    Associator lowAssociation;       // weak detections vs tracks the first pass missed
+    int nextTrackingId = 0;
+    FlowPropagator flow;             // keyframe mode only, holds the last frame the tracks saw
+    FrameClock::time_point flowTime; // capture time of that frame
+    float measScale = 1.0f;          // this update
+    FrameClock::time_point stateTime; // capture time of the last update or propagate
+    uint64_t stateFrameId = 0;
     bool firstRun = true;
+
+    // seconds from the current state to t, never below a tiny step (late or reordered frames)
+    double StepTo(FrameClock::time_point t) const;
+
+    float MeasurementScale() const;
+    void RebuildVisible();
 };
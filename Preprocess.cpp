@@ -0,0 +1,218 @@
+#include "Preprocess.hpp"
+#include <algorithm>
+#include <cmath>
+
+// simd picks, avx2 needs /arch:AVX2 or -mavx2, sse2 is always there on x64
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define PREPROCESS_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define PREPROCESS_SSE2 1
+#endif
+
+namespace {
+
+const float kScale = 1.0f / 255.0f;
+const float kPadValue = 114.0f / 255.0f; // same gray as ultralytics
+
+void FillRow(float* out, int n, float value) {
+    int i = 0;
+#if defined(PREPROCESS_AVX2)
+    __m256 v8 = _mm256_set1_ps(value);
+    for (; i + 8 <= n; i += 8) _mm256_storeu_ps(out + i, v8);
+#elif defined(PREPROCESS_SSE2)
+    __m128 v4 = _mm_set1_ps(value);
+    for (; i + 4 <= n; i += 4) _mm_storeu_ps(out + i, v4);
+#endif
+    for (; i < n; i++) out[i] = value;
+}
+
+// out = (h0 + (h1 - h0) * a) / 255
+void BlendRow(const float* h0, const float* h1, float a, float* out, int n) {
+    int i = 0;
+#if defined(PREPROCESS_AVX2)
+    __m256 va = _mm256_set1_ps(a);
+    __m256 vs = _mm256_set1_ps(kScale);
+    for (; i + 8 <= n; i += 8) {
+        __m256 v0 = _mm256_loadu_ps(h0 + i);
+        __m256 v1 = _mm256_loadu_ps(h1 + i);
+        __m256 v = _mm256_add_ps(v0, _mm256_mul_ps(_mm256_sub_ps(v1, v0), va));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(v, vs));
+    }
+#elif defined(PREPROCESS_SSE2)
+    __m128 va = _mm_set1_ps(a);
+    __m128 vs = _mm_set1_ps(kScale);
+    for (; i + 4 <= n; i += 4) {
+        __m128 v0 = _mm_loadu_ps(h0 + i);
+        __m128 v1 = _mm_loadu_ps(h1 + i);
+        __m128 v = _mm_add_ps(v0, _mm_mul_ps(_mm_sub_ps(v1, v0), va));
+        _mm_storeu_ps(out + i, _mm_mul_ps(v, vs));
+    }
+#endif
+    for (; i < n; i++) out[i] = (h0[i] + (h1[i] - h0[i]) * a) * kScale;
+}
+
+// no resize needed, just split channels and scale
+void ConvertRowIdentity(const uchar* src, int channels, float* r, float* g, float* b, int n) {
+    int i = 0;
+#if defined(PREPROCESS_SSE2)
+    if (channels == 4) {
+        // 4 bgra pixels -> 4x4 floats -> transpose gives b g r a planes
+        const __m128i zero = _mm_setzero_si128();
+        const __m128 vs = _mm_set1_ps(kScale);
+        for (; i + 4 <= n; i += 4) {
+            __m128i px = _mm_loadu_si128((const __m128i*)(src + i * 4));
+            __m128i lo = _mm_unpacklo_epi8(px, zero);
+            __m128i hi = _mm_unpackhi_epi8(px, zero);
+            __m128 p0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+            __m128 p1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+            __m128 p2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+            __m128 p3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+            _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+            _mm_storeu_ps(b + i, _mm_mul_ps(p0, vs));
+            _mm_storeu_ps(g + i, _mm_mul_ps(p1, vs));
+            _mm_storeu_ps(r + i, _mm_mul_ps(p2, vs));
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        const uchar* p = src + i * channels;
+        b[i] = p[0] * kScale;
+        g[i] = p[1] * kScale;
+        r[i] = p[2] * kScale;
+    }
+}
+
+// same sample positions as cv::resize INTER_LINEAR (half pixel centers)
+void BuildAxis(int srcLen, int dstLen, std::vector<int>& i0, std::vector<int>& i1, std::vector<float>& alpha) {
+    i0.resize(dstLen);
+    i1.resize(dstLen);
+    alpha.resize(dstLen);
+
+    double scale = (double)srcLen / dstLen;
+    for (int d = 0; d < dstLen; d++) {
+        double s = (d + 0.5) * scale - 0.5;
+        int s0 = (int)std::floor(s);
+        float a = (float)(s - s0);
+        if (s0 < 0) { s0 = 0; a = 0.0f; }
+        if (s0 >= srcLen - 1) { s0 = srcLen - 1; a = 0.0f; }
+        i0[d] = s0;
+        i1[d] = std::min(s0 + 1, srcLen - 1);
+        alpha[d] = a;
+    }
+}
+
+} // namespace
+
+void LetterboxKernel::Prepare(int srcW, int srcH, int channels, int dstW, int dstH) {
+    if (srcW == cachedSrcW && srcH == cachedSrcH && channels == cachedChannels &&
+        dstW == cachedDstW && dstH == cachedDstH) {
+        return;
+    }
+
+    cachedSrcW = srcW;
+    cachedSrcH = srcH;
+    cachedChannels = channels;
+    cachedDstW = dstW;
+    cachedDstH = dstH;
+
+    // same math as the old letterbox so boxes map back identically
+    info.ratio = std::min((float)dstW / srcW, (float)dstH / srcH);
+    info.newW = std::max(1, (int)(srcW * info.ratio));
+    info.newH = std::max(1, (int)(srcH * info.ratio));
+    info.padX = (dstW - info.newW) / 2;
+    info.padY = (dstH - info.newH) / 2;
+
+    BuildAxis(srcW, info.newW, xOfs0, xOfs1, xAlpha);
+    for (int x = 0; x < info.newW; x++) {
+        xOfs0[x] *= channels;
+        xOfs1[x] *= channels;
+    }
+    BuildAxis(srcH, info.newH, yRow0, yRow1, yAlpha);
+
+    rowBuf[0].assign(3 * info.newW, 0.0f);
+    rowBuf[1].assign(3 * info.newW, 0.0f);
+}
+
+void LetterboxKernel::HorizontalRow(const uchar* srcRow, float* out) const {
+    const int n = info.newW;
+    float* r = out;
+    float* g = out + n;
+    float* b = out + 2 * n;
+    for (int x = 0; x < n; x++) {
+        const uchar* p0 = srcRow + xOfs0[x];
+        const uchar* p1 = srcRow + xOfs1[x];
+        float a = xAlpha[x];
+        b[x] = p0[0] + (p1[0] - p0[0]) * a;
+        g[x] = p0[1] + (p1[1] - p0[1]) * a;
+        r[x] = p0[2] + (p1[2] - p0[2]) * a;
+    }
+}
+
+LetterboxInfo LetterboxKernel::Run(const cv::Mat& src, float* dst, int dstW, int dstH) {
+    CV_Assert(src.depth() == CV_8U && (src.channels() == 3 || src.channels() == 4));
+
+    const int channels = src.channels();
+    Prepare(src.cols, src.rows, channels, dstW, dstH);
+
+    const size_t plane = (size_t)dstW * dstH;
+    float* planes[3] = { dst, dst + plane, dst + 2 * plane }; // r g b
+    const int newW = info.newW;
+    const int newH = info.newH;
+    const int rightPad = dstW - info.padX - newW;
+
+    // top and bottom bars
+    for (int c = 0; c < 3; c++) {
+        for (int y = 0; y < info.padY; y++) FillRow(planes[c] + (size_t)y * dstW, dstW, kPadValue);
+        for (int y = info.padY + newH; y < dstH; y++) FillRow(planes[c] + (size_t)y * dstW, dstW, kPadValue);
+    }
+
+    const bool identity = (newW == src.cols && newH == src.rows);
+
+    // new frame so cached rows are stale
+    rowBufSrcY[0] = -1;
+    rowBufSrcY[1] = -1;
+
+    // get horizontally resized src row, keep the other slot if it holds keepY
+    auto fetch = [&](int y, int keepY) -> const float* {
+        if (rowBufSrcY[0] == y) return rowBuf[0].data();
+        if (rowBufSrcY[1] == y) return rowBuf[1].data();
+        int slot = (rowBufSrcY[0] == keepY) ? 1 : 0;
+        HorizontalRow(src.ptr<uchar>(y), rowBuf[slot].data());
+        rowBufSrcY[slot] = y;
+        return rowBuf[slot].data();
+    };
+
+    for (int oy = 0; oy < newH; oy++) {
+        size_t rowStart = (size_t)(info.padY + oy) * dstW;
+        float* r = planes[0] + rowStart;
+        float* g = planes[1] + rowStart;
+        float* b = planes[2] + rowStart;
+
+        // side bars
+        for (int c = 0; c < 3; c++) {
+            float* row = planes[c] + rowStart;
+            FillRow(row, info.padX, kPadValue);
+            FillRow(row + info.padX + newW, rightPad, kPadValue);
+        }
+
+        if (identity) {
+            ConvertRowIdentity(src.ptr<uchar>(oy), channels, r + info.padX, g + info.padX, b + info.padX, newW);
+            continue;
+        }
+
+        int y0 = yRow0[oy];
+        int y1 = yRow1[oy];
+        float a = yAlpha[oy];
+        const float* h0 = fetch(y0, y1);
+        const float* h1 = (a > 0.0f) ? fetch(y1, y0) : h0;
+
+        for (int c = 0; c < 3; c++) {
+            BlendRow(h0 + c * newW, h1 + c * newW, a, planes[c] + rowStart + info.padX, newW);
+        }
+    }
+
+    return info;
+}
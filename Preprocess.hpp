@@ -0,0 +1,47 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// where the image landed inside the letterbox, needed to map boxes back
+struct LetterboxInfo {
+    float ratio = 1.0f;
+    int padX = 0;
+    int padY = 0;
+    int newW = 0;
+    int newH = 0;
+};
+
+// fused letterbox for yolo input
+// resize (bilinear like cv::resize) + 114 pad + bgr->rgb + 1/255 + hwc->chw in one pass
+// writes straight into the planar float tensor, no temp mats
+// takes 8bit bgr or bgra
+class LetterboxKernel {
+public:
+    // dst must hold 3 * dstW * dstH floats
+    LetterboxInfo Run(const cv::Mat& src, float* dst, int dstW, int dstH);
+
+private:
+    void Prepare(int srcW, int srcH, int channels, int dstW, int dstH);
+    void HorizontalRow(const uchar* srcRow, float* out) const;
+
+    // tables rebuilt only when sizes change
+    int cachedSrcW = -1;
+    int cachedSrcH = -1;
+    int cachedChannels = -1;
+    int cachedDstW = -1;
+    int cachedDstH = -1;
+    LetterboxInfo info;
+
+    std::vector<int> xOfs0;     // byte offset of left src pixel per out x
+    std::vector<int> xOfs1;     // right src pixel
+    std::vector<float> xAlpha;  // weight of right pixel
+    std::vector<int> yRow0;
+    std::vector<int> yRow1;
+    std::vector<float> yAlpha;
+
+    // two horizontally resized src rows, 3 planes each
+    // neighbour out rows mostly share src rows so we keep them around
+    std::vector<float> rowBuf[2];
+    int rowBufSrcY[2] = { -1, -1 };
+};
@@ -0,0 +1,425 @@
+// replay benchmark, which model / input size / thread count to run on this machine
+// a recorded frame set goes through the real detect -> track pipeline once per combination,
+// speed and quality land in one table (stdout, and csv if asked)
+// replay_bench target in CMakeLists.txt, linux like HeadlessMain
+//
+// usage: replay_bench --source frames/ --models a.onnx,b.onnx [--key value ...]
+//   source      image folder (sorted by name) or video, loaded into ram first so decoding isnt measured
+//   gt          yolo label folder (<image stem>.txt, "class cx cy w h [track]") or mot csv ("frame,id,x,y,w,h[,class]")
+//               without it only the speed columns get filled
+//   models resolutions threads   comma separated, every combination runs
+//   labels conf nms low_conf prediction fps max_frames warmup agnostic cache csv
+//   map_conf    detector threshold of the separate untimed pass map50 is scored from (default 0.001),
+//               precision / recall / id switches stay at conf
+//   fps 0 replays as fast as the pipeline takes frames (throughput), > 0 paces like a live source (drops show up)
+// rows marked * are on the speed/quality front: nothing else is both faster and better
+#include "TrashDetector.hpp"
+#include "FrameSource.hpp"
+#include "DetectionPipeline.hpp"
+#include "features/Prediction.hpp"
+#include "LatencyHistogram.hpp"
+#include "ReplayEval.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct BenchConfig {
+    std::string source;
+    std::string gt;
+    std::vector<std::string> models;
+    std::vector<int> resolutions{640};
+    std::vector<int> threads{std::thread::hardware_concurrency() > 0 ? (int)std::thread::hardware_concurrency() : 4};
+    std::string labels;
+    float conf = 0.5f;         // same default as the gui, precision/recall are measured at the operating point
+    float mapConf = 0.001f;    // ap needs the whole score range, not just what survives conf
+    float nms = 0.45f;
+    float lowConf = 0.1f;
+    bool prediction = true;    // off scores raw detector boxes, id switches need it on
+    double fps = 0.0;
+    size_t maxFrames = 0;      // 0 = whole source
+    int warmup = 5;            // detector runs per combination before the clock starts
+    bool agnostic = false;     // ignore classes when matching, for labels from another class list
+    bool cache = true;
+    std::string csv;
+};
+
+// one table row
+struct BenchRow {
+    std::string model;
+    int resolution = 0;
+    int threads = 0;
+    double fps = 0.0;
+    LatencySummary latency;
+    uint64_t frames = 0;
+    uint64_t dropped = 0;
+    bool scored = false;
+    EvalResult eval;
+    bool front = false;
+};
+
+std::string Trim(const std::string& s) {
+    size_t a = s.find_first_not_of(" \t\r\n");
+    if (a == std::string::npos) return "";
+    size_t b = s.find_last_not_of(" \t\r\n");
+    return s.substr(a, b - a + 1);
+}
+
+bool ParseBool(const std::string& v) {
+    return v == "1" || v == "true" || v == "yes" || v == "on";
+}
+
+std::vector<std::string> SplitList(const std::string& spec) {
+    std::vector<std::string> out;
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        item = Trim(item);
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+std::vector<int> SplitInts(const std::string& spec) {
+    std::vector<int> out;
+    for (const auto& item : SplitList(spec)) out.push_back(std::stoi(item));
+    return out;
+}
+
+bool ParseArgs(int argc, char** argv, BenchConfig& cfg, std::string* errorMsg) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0 || i + 1 >= argc) {
+            if (errorMsg) *errorMsg = "expected --key value, got " + arg;
+            return false;
+        }
+        std::string key = arg.substr(2);
+        std::string value = argv[++i];
+        try {
+            if (key == "source") cfg.source = value;
+            else if (key == "gt") cfg.gt = value;
+            else if (key == "models") cfg.models = SplitList(value);
+            else if (key == "resolutions") cfg.resolutions = SplitInts(value);
+            else if (key == "threads") cfg.threads = SplitInts(value);
+            else if (key == "labels") cfg.labels = value;
+            else if (key == "conf") cfg.conf = std::stof(value);
+            else if (key == "map_conf") cfg.mapConf = std::stof(value);
+            else if (key == "nms") cfg.nms = std::stof(value);
+            else if (key == "low_conf") cfg.lowConf = std::stof(value);
+            else if (key == "prediction") cfg.prediction = ParseBool(value);
+            else if (key == "fps") cfg.fps = std::stod(value);
+            else if (key == "max_frames") cfg.maxFrames = (size_t)std::stoul(value);
+            else if (key == "warmup") cfg.warmup = std::max(0, std::stoi(value));
+            else if (key == "agnostic") cfg.agnostic = ParseBool(value);
+            else if (key == "cache") cfg.cache = ParseBool(value);
+            else if (key == "csv") cfg.csv = value;
+            else {
+                if (errorMsg) *errorMsg = "unknown setting " + key;
+                return false;
+            }
+        } catch (const std::exception&) {
+            if (errorMsg) *errorMsg = "bad value for " + key + ": " + value;
+            return false;
+        }
+    }
+    if (cfg.source.empty() || cfg.models.empty() || cfg.resolutions.empty() || cfg.threads.empty()) {
+        if (errorMsg) *errorMsg = "source, models, resolutions and threads are required";
+        return false;
+    }
+    return true;
+}
+
+// whole frame set into ram, names kept for the yolo labels
+bool LoadFrames(const BenchConfig& cfg, std::vector<cv::Mat>& frames, std::vector<std::string>& names, std::string* errorMsg) {
+    if (fs::is_directory(cfg.source)) {
+        ImageDirectorySource dir(cfg.source);
+        for (const auto& file : dir.GetFiles()) {
+            if (cfg.maxFrames && frames.size() >= cfg.maxFrames) break;
+            cv::Mat image = cv::imread(file, cv::IMREAD_COLOR);
+            if (image.empty()) {
+                std::cerr << "skipping unreadable image " << file << std::endl;
+                continue;
+            }
+            frames.push_back(image);
+            names.push_back(file);
+        }
+    } else {
+        std::unique_ptr<FrameSource> source = CreateReplaySource(cfg.source, -1.0, false, errorMsg);
+        if (!source) return false;
+        CapturedFrame frame;
+        while ((!cfg.maxFrames || frames.size() < cfg.maxFrames) && source->Grab(frame)) {
+            frames.push_back(frame.image.clone()); // the source may reuse its buffer
+            names.push_back(std::to_string(frames.size()));
+        }
+    }
+    if (frames.empty()) {
+        if (errorMsg) *errorMsg = "no frames in " + cfg.source;
+        return false;
+    }
+    return true;
+}
+
+// ap from raw detector output at mapConf, straight calls and not timed
+// the pipeline run only has boxes above conf, that cuts the precision/recall curve off at the operating point
+double ScoreMap(const BenchConfig& cfg, TrashDetector& detector, const std::vector<cv::Mat>& frames, const GroundTruth& truth) {
+    DetectionEvaluator eval(truth, frames.size(), 0.5f, cfg.agnostic);
+    for (size_t i = 0; i < frames.size(); i++) eval.AddFrame(i, detector.Detect(frames[i], cfg.mapConf, cfg.nms));
+    return eval.Finish().map50;
+}
+
+// one combination, the frame set goes through once
+BenchRow RunOnce(const BenchConfig& cfg, TrashDetector& detector, const std::vector<cv::Mat>& frames, const GroundTruth* truth) {
+    BenchRow row;
+
+    // first runs pay for allocator and kernel setup, they dont belong in the percentiles
+    for (int i = 0; i < cfg.warmup; i++) detector.Detect(frames[i % frames.size()], cfg.conf, cfg.nms);
+
+    Prediction prediction;
+    prediction.enabled = cfg.prediction;
+    LatencyHistogram latency;
+    std::vector<std::vector<Detection>> published(frames.size());
+    std::vector<uint8_t> done(frames.size(), 0);
+    std::atomic<size_t> next{0};
+    std::atomic<bool> sourceDone{false};
+    FrameClock::time_point lastPublish;
+
+    DetectionPipeline pipeline(detector);
+    pipeline.confThreshold = cfg.conf;
+    pipeline.nmsThreshold = cfg.nms;
+    pipeline.lowConfThreshold = cfg.lowConf;
+    pipeline.targetFps = (int)cfg.fps;
+
+    DetectionPipeline::Callbacks cb;
+    cb.grab = [&](CapturedFrame& frame) {
+        size_t index = next;
+        if (index >= frames.size()) {
+            sourceDone = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            return false;
+        }
+        next = index + 1;
+        frame.image = frames[index]; // shared, nothing in the pipeline writes into it
+        frame.frameId = index;
+        frame.captureTime = FrameClock::now();
+        return true;
+    };
+    cb.track = [&](PipelineResult& result, std::vector<Detection>& weak, bool) {
+        if (!cfg.prediction) return;
+        prediction.UpdateHistory(result.detections, &weak, &result.frame);
+        result.detections = prediction.GetProcessed();
+        result.stateTime = prediction.StateTime();
+    };
+    // post thread, only copies out, scoring happens after the run so it doesnt slow the pipeline
+    cb.publish = [&](PipelineResult& result) {
+        auto now = FrameClock::now();
+        latency.Record(std::chrono::duration<double, std::milli>(now - result.frame.captureTime).count());
+        size_t index = (size_t)result.frame.frameId;
+        if (index < published.size()) {
+            published[index] = result.detections;
+            done[index] = 1;
+        }
+        lastPublish = now;
+    };
+
+    auto start = FrameClock::now();
+    pipeline.Start(std::move(cb));
+    const PipelineStats& stats = pipeline.Stats();
+    // every captured frame either publishes or gets counted as dropped somewhere, wait for all of them
+    // the last one may still be in a multi second cpu inference, only a pipeline making no progress
+    // at all for kDrainTimeout gets cut off
+    const auto kDrainTimeout = std::chrono::seconds(30);
+    auto accounted = [&] {
+        return stats.completed + stats.dropped[StagePreprocess] + stats.dropped[StageInfer] + stats.dropped[StagePost];
+    };
+    uint64_t lastAccounted = 0;
+    auto lastProgress = FrameClock::now();
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint64_t now = accounted();
+        if (now != lastAccounted) {
+            lastAccounted = now;
+            lastProgress = FrameClock::now();
+        }
+        if (sourceDone && now >= stats.captured) break;
+        if (FrameClock::now() - lastProgress > kDrainTimeout) {
+            std::cerr << "pipeline stuck, " << stats.captured - now << " frame(s) never came out" << std::endl;
+            break;
+        }
+    }
+    pipeline.Stop();
+
+    double elapsed = std::chrono::duration<double>(lastPublish - start).count();
+    row.frames = stats.completed;
+    row.dropped = stats.dropped[StagePreprocess] + stats.dropped[StageInfer] + stats.dropped[StagePost];
+    row.fps = elapsed > 0.0 ? row.frames / elapsed : 0.0;
+    row.latency = latency.Summarize();
+
+    if (truth) {
+        DetectionEvaluator eval(*truth, frames.size(), 0.5f, cfg.agnostic);
+        for (size_t i = 0; i < frames.size(); i++) {
+            if (done[i]) eval.AddFrame(i, published[i]);
+        }
+        row.eval = eval.Finish();
+        row.scored = true;
+    }
+    return row;
+}
+
+// a row is on the front when no other row is at least as fast and as good and strictly better in one
+void MarkFront(std::vector<BenchRow>& rows) {
+    for (auto& a : rows) {
+        double qa = a.scored ? a.eval.map50 : 0.0;
+        a.front = true;
+        for (const auto& b : rows) {
+            double qb = b.scored ? b.eval.map50 : 0.0;
+            if (&a != &b && b.fps >= a.fps && qb >= qa && (b.fps > a.fps || qb > qa)) {
+                a.front = false;
+                break;
+            }
+        }
+    }
+}
+
+void PrintTable(const std::vector<BenchRow>& rows, std::ostream& out) {
+    char line[512];
+    snprintf(line, sizeof(line), "%-24s %5s %3s %8s %7s %7s %7s %7s %7s %6s %6s %6s %5s %s\n", "model", "input", "thr", "fps",
+             "p50ms", "p90ms", "p99ms", "maxms", "mAP50", "prec", "recall", "idsw", "drop", "");
+    out << line;
+    for (const auto& r : rows) {
+        std::string name = fs::path(r.model).filename().string();
+        if (name.size() > 24) name = name.substr(0, 21) + "...";
+        char map[16] = "-", prec[16] = "-", rec[16] = "-", idsw[16] = "-";
+        if (r.scored) {
+            snprintf(map, sizeof(map), "%.3f", r.eval.map50);
+            snprintf(prec, sizeof(prec), "%.3f", r.eval.precision);
+            snprintf(rec, sizeof(rec), "%.3f", r.eval.recall);
+            if (r.eval.idSwitches >= 0) snprintf(idsw, sizeof(idsw), "%d", r.eval.idSwitches);
+        }
+        snprintf(line, sizeof(line), "%-24s %5d %3d %8.1f %7.1f %7.1f %7.1f %7.1f %7s %6s %6s %6s %5llu %s\n", name.c_str(),
+                 r.resolution, r.threads, r.fps, r.latency.p50, r.latency.p90, r.latency.p99, r.latency.max, map, prec, rec, idsw,
+                 (unsigned long long)r.dropped, r.front ? "*" : "");
+        out << line;
+    }
+}
+
+bool WriteCsv(const std::vector<BenchRow>& rows, const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "error: cant write " << path << std::endl;
+        return false;
+    }
+    out << "model,input,threads,fps,latency_p50_ms,latency_p90_ms,latency_p99_ms,latency_max_ms,frames,dropped,"
+           "map50,precision,recall,id_switches,frames_missing,front\n";
+    for (const auto& r : rows) {
+        out << r.model << "," << r.resolution << "," << r.threads << "," << r.fps << "," << r.latency.p50 << ","
+            << r.latency.p90 << "," << r.latency.p99 << "," << r.latency.max << "," << r.frames << "," << r.dropped << ",";
+        if (r.scored) {
+            out << r.eval.map50 << "," << r.eval.precision << "," << r.eval.recall << ",";
+            if (r.eval.idSwitches >= 0) out << r.eval.idSwitches;
+            out << "," << r.eval.framesMissing;
+        } else {
+            out << ",,,,";
+        }
+        out << "," << (r.front ? 1 : 0) << "\n";
+    }
+    return (bool)out;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchConfig cfg;
+    std::string error;
+    if (!ParseArgs(argc, argv, cfg, &error)) {
+        std::cerr << "error: " << error << "\n"
+                  << "usage: " << argv[0] << " --source frames/ --models a.onnx,b.onnx [--gt labels/|gt.txt]"
+                  << " [--resolutions 320,640] [--threads 1,4] [--csv out.csv] ..." << std::endl;
+        return 2;
+    }
+
+    std::vector<cv::Mat> frames;
+    std::vector<std::string> names;
+    if (!LoadFrames(cfg, frames, names, &error)) {
+        std::cerr << "error: " << error << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<GroundTruth> truth;
+    if (!cfg.gt.empty()) {
+        truth = std::make_unique<GroundTruth>();
+        bool ok;
+        if (fs::is_directory(cfg.gt)) {
+            std::vector<cv::Size> sizes;
+            for (const auto& f : frames) sizes.push_back(cv::Size(f.cols, f.rows));
+            ok = truth->LoadYoloDir(cfg.gt, names, sizes, &error);
+        } else {
+            ok = truth->LoadMot(cfg.gt, &error);
+        }
+        if (!ok) {
+            std::cerr << "error: " << error << std::endl;
+            return 1;
+        }
+        if (cfg.prediction && !truth->HasTrackIds()) std::cerr << "labels have no track ids, id switches left out" << std::endl;
+    }
+    std::cerr << frames.size() << " frames from " << cfg.source << std::endl;
+
+    std::vector<BenchRow> rows;
+    std::map<std::pair<std::string, int>, double> mapCache;
+    for (const auto& model : cfg.models) {
+        for (int threads : cfg.threads) {
+            // threads are baked into the session, resolution only picks another binding
+            TrashDetector detector;
+            detector.GetModelCache().enabled = cfg.cache;
+            if (!cfg.labels.empty()) detector.LoadLabels(cfg.labels);
+            if (!detector.LoadModel(model, false, threads, &error)) {
+                std::cerr << "skipping " << model << ": " << error << std::endl;
+                break;
+            }
+
+            std::vector<int> resolutions = cfg.resolutions;
+            if (detector.IsFixedResolution()) {
+                // one row is all a fixed input model can give
+                std::cerr << model << " has a fixed " << detector.GetFixedResolution() << " input" << std::endl;
+                resolutions.assign(1, detector.GetFixedResolution());
+            }
+            for (int resolution : resolutions) {
+                detector.SetInputResolution(resolution);
+                detector.WarmInputResolution(); // bound now, not on the loader while the first timed frames run
+                std::cerr << "running " << fs::path(model).filename().string() << " @" << resolution << " x" << threads << " threads" << std::endl;
+                BenchRow row = RunOnce(cfg, detector, frames, truth.get());
+                if (row.scored) {
+                    // the threads dont change what the model outputs, one pass per model and size is enough
+                    auto key = std::make_pair(model, resolution);
+                    auto it = mapCache.find(key);
+                    if (it == mapCache.end()) it = mapCache.emplace(key, ScoreMap(cfg, detector, frames, *truth)).first;
+                    row.eval.map50 = it->second;
+                }
+                row.model = model;
+                row.resolution = resolution;
+                row.threads = threads;
+                rows.push_back(row);
+            }
+        }
+    }
+    if (rows.empty()) {
+        std::cerr << "error: no model ran" << std::endl;
+        return 1;
+    }
+
+    MarkFront(rows);
+    PrintTable(rows, std::cout);
+    if (!cfg.csv.empty() && !WriteCsv(rows, cfg.csv)) return 1;
+    return 0;
+}
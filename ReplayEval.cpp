@@ -0,0 +1,185 @@
+#include "ReplayEval.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// same as the associator's
+float Iou(const cv::Rect2f& a, const cv::Rect2f& b) {
+    float iw = std::min(a.x + a.width, b.x + b.width) - std::max(a.x, b.x);
+    float ih = std::min(a.y + a.height, b.y + b.height) - std::max(a.y, b.y);
+    if (iw <= 0.0f || ih <= 0.0f) return 0.0f;
+    float inter = iw * ih;
+    return inter / std::max(a.width * a.height + b.width * b.height - inter, 1e-6f);
+}
+
+} // namespace
+
+bool GroundTruth::LoadYoloDir(const std::string& dir, const std::vector<std::string>& imageFiles, const std::vector<cv::Size>& sizes,
+                              std::string* errorMsg) {
+    if (!fs::is_directory(dir)) {
+        if (errorMsg) *errorMsg = "no label folder " + dir;
+        return false;
+    }
+    frames.assign(imageFiles.size(), {});
+    trackIds = false;
+    bool anyIds = false, allIds = true;
+    size_t labelled = 0;
+
+    for (size_t i = 0; i < imageFiles.size(); i++) {
+        std::ifstream file(fs::path(dir) / (fs::path(imageFiles[i]).stem().string() + ".txt"));
+        if (!file.is_open()) continue;
+        labelled++;
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream in(line);
+            GroundTruthBox gt;
+            float cx, cy, w, h;
+            if (!(in >> gt.classId >> cx >> cy >> w >> h)) continue; // blank or comment
+            int track;
+            if (in >> track) {
+                gt.trackId = track;
+                anyIds = true;
+            } else {
+                allIds = false;
+            }
+            float fw = (float)sizes[i].width;
+            float fh = (float)sizes[i].height;
+            gt.box = cv::Rect2f((cx - w / 2) * fw, (cy - h / 2) * fh, w * fw, h * fh);
+            frames[i].push_back(gt);
+        }
+    }
+    if (labelled == 0) {
+        if (errorMsg) *errorMsg = "no label txt in " + dir + " matches an image name";
+        return false;
+    }
+    // half labelled ids would count every unlabelled object as fine, dont pretend
+    trackIds = anyIds && allIds;
+    return true;
+}
+
+bool GroundTruth::LoadMot(const std::string& path, std::string* errorMsg) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        if (errorMsg) *errorMsg = "cant open " + path;
+        return false;
+    }
+    frames.clear();
+    trackIds = true;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream in(line);
+        int frame;
+        GroundTruthBox gt;
+        float x, y, w, h;
+        if (!(in >> frame >> gt.trackId >> x >> y >> w >> h) || frame < 1) continue;
+        if (!(in >> gt.classId)) gt.classId = 0;
+        if (gt.trackId < 0) trackIds = false;
+        gt.box = cv::Rect2f(x, y, w, h);
+        if ((size_t)frame > frames.size()) frames.resize(frame);
+        frames[frame - 1].push_back(gt);
+    }
+    if (frames.empty()) {
+        if (errorMsg) *errorMsg = "no labels in " + path;
+        return false;
+    }
+    return true;
+}
+
+DetectionEvaluator::DetectionEvaluator(const GroundTruth& truth, size_t frameCount, float iouThreshold, bool classAgnostic)
+    : truth(truth), frameCount(frameCount), iouThreshold(iouThreshold), classAgnostic(classAgnostic), added(frameCount, 0) {
+    for (size_t f = 0; f < frameCount; f++) {
+        for (const auto& gt : truth.Frame(f)) labelCount[ClassOf(gt.classId)]++;
+    }
+}
+
+void DetectionEvaluator::AddFrame(size_t index, const std::vector<Detection>& detections) {
+    if (index >= frameCount || added[index]) return;
+    added[index] = 1;
+    const std::vector<GroundTruthBox>& labels = truth.Frame(index);
+
+    order.resize(detections.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = (int)i;
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return detections[a].confidence > detections[b].confidence; });
+    labelUsed.assign(labels.size(), 0);
+
+    for (int d : order) {
+        const Detection& det = detections[d];
+        int cls = ClassOf(det.classId);
+        int best = -1;
+        float bestIou = iouThreshold;
+        for (size_t g = 0; g < labels.size(); g++) {
+            if (labelUsed[g] || ClassOf(labels[g].classId) != cls) continue;
+            float iou = Iou(det.box, labels[g].box);
+            if (iou >= bestIou) {
+                bestIou = iou;
+                best = (int)g;
+            }
+        }
+        scored[cls].push_back({ det.confidence, best >= 0 });
+        if (best < 0) continue;
+        labelUsed[best] = 1;
+
+        // tracker output only, raw detector boxes have no id to switch
+        int labelTrack = labels[best].trackId;
+        if (labelTrack < 0 || det.trackingId < 0) continue;
+        auto it = lastTrackOf.find(labelTrack);
+        if (it != lastTrackOf.end() && it->second != det.trackingId) idSwitches++;
+        lastTrackOf[labelTrack] = det.trackingId;
+    }
+}
+
+EvalResult DetectionEvaluator::Finish() const {
+    EvalResult result;
+    uint64_t hits = 0, boxes = 0, labels = 0;
+    double apSum = 0.0;
+    int apClasses = 0;
+
+    for (const auto& [cls, count] : labelCount) {
+        labels += count;
+        if (count == 0) continue;
+        apClasses++;
+        auto it = scored.find(cls);
+        if (it == scored.end()) continue; // never detected, ap 0
+
+        std::vector<Scored> sorted = it->second;
+        std::sort(sorted.begin(), sorted.end(), [](const Scored& a, const Scored& b) { return a.confidence > b.confidence; });
+        std::vector<double> precision(sorted.size()), recall(sorted.size());
+        uint64_t tp = 0;
+        for (size_t i = 0; i < sorted.size(); i++) {
+            if (sorted[i].hit) tp++;
+            precision[i] = (double)tp / (i + 1);
+            recall[i] = (double)tp / count;
+        }
+        // precision envelope, then area over the recall steps
+        for (size_t i = sorted.size(); i-- > 1;) precision[i - 1] = std::max(precision[i - 1], precision[i]);
+        double ap = 0.0, prevRecall = 0.0;
+        for (size_t i = 0; i < sorted.size(); i++) {
+            ap += (recall[i] - prevRecall) * precision[i];
+            prevRecall = recall[i];
+        }
+        apSum += ap;
+    }
+    // boxes of classes nobody labelled are false positives too
+    for (const auto& [cls, list] : scored) {
+        for (const Scored& s : list) {
+            boxes++;
+            if (s.hit) hits++;
+        }
+    }
+
+    result.map50 = apClasses ? apSum / apClasses : 0.0;
+    result.precision = boxes ? (double)hits / boxes : 0.0;
+    result.recall = labels ? (double)hits / labels : 0.0;
+    result.idSwitches = truth.HasTrackIds() ? idSwitches : -1;
+    for (uint8_t a : added) {
+        if (!a) result.framesMissing++;
+    }
+    return result;
+}
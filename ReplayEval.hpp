@@ -0,0 +1,77 @@
+#pragma once
+
+#include "TrashDetector.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+// one labelled object
+struct GroundTruthBox {
+    cv::Rect2f box;    // frame pixels
+    int classId = 0;
+    int trackId = -1;  // -1 when the labels have no ids
+};
+
+// labels per frame, index = position in the replayed frame set (0 based)
+class GroundTruth {
+public:
+    // yolo txt next to each image, <dir>/<image stem>.txt with "class cx cy w h [track]" per line
+    // normalized to the image size, a missing txt is an unlabelled (empty) frame
+    bool LoadYoloDir(const std::string& dir, const std::vector<std::string>& imageFiles, const std::vector<cv::Size>& sizes,
+                     std::string* errorMsg = nullptr);
+    // mot style csv, "frame,id,x,y,w,h[,class]" in pixels, frame 1 based, id -1 = no id, class 0 if left out
+    bool LoadMot(const std::string& path, std::string* errorMsg = nullptr);
+
+    const std::vector<GroundTruthBox>& Frame(size_t index) const { return index < frames.size() ? frames[index] : empty; }
+    size_t FrameCount() const { return frames.size(); }
+    bool HasTrackIds() const { return trackIds; }
+
+private:
+    std::vector<std::vector<GroundTruthBox>> frames;
+    std::vector<GroundTruthBox> empty;
+    bool trackIds = false;
+};
+
+struct EvalResult {
+    double map50 = 0.0;        // mean ap over classes that have labels, only meaningful from a low threshold pass
+    double precision = 0.0;    // at the conf threshold the run used
+    double recall = 0.0;
+    int idSwitches = -1;       // -1 when the labels have no track ids
+    uint64_t framesMissing = 0; // never published, every label in them counts as missed
+};
+
+// published frames against ground truth
+// ap per class is the area under the all point interpolated precision/recall curve (voc 2010 style)
+// matching is greedy by confidence, a box is a hit on the best unmatched label of its class at iou >= iouThreshold
+// id switches are counted like mot: a labelled object hit by a different track id than the last time it was hit
+class DetectionEvaluator {
+public:
+    // frameCount = frames replayed, ones never added count as all misses
+    DetectionEvaluator(const GroundTruth& truth, size_t frameCount, float iouThreshold = 0.5f, bool classAgnostic = false);
+
+    void AddFrame(size_t index, const std::vector<Detection>& detections);
+    EvalResult Finish() const;
+
+private:
+    struct Scored {
+        float confidence;
+        bool hit;
+    };
+
+    int ClassOf(int classId) const { return classAgnostic ? 0 : classId; }
+
+    const GroundTruth& truth;
+    size_t frameCount;
+    float iouThreshold;
+    bool classAgnostic;
+
+    std::map<int, std::vector<Scored>> scored; // by class
+    std::map<int, uint64_t> labelCount;        // by class, over all frameCount frames
+    std::vector<uint8_t> added;
+    std::map<int, int> lastTrackOf;            // label track id -> predicted tracking id
+    int idSwitches = 0;
+
+    // per frame scratch
+    std::vector<int> order;
+    std::vector<uint8_t> labelUsed;
+};
@@ -0,0 +1,92 @@
+#include "ResolutionController.hpp"
+#include <algorithm>
+
+namespace {
+// multiples of 32 so yolo strides line up
+const int kLadder[] = { 320, 352, 416, 480, 512, 608, 640 };
+const int kLadderCount = (int)(sizeof(kLadder) / sizeof(kLadder[0]));
+// recent ms is smoothed, give it a few frames to reflect a new res before trusting it
+const int kSettleFrames = 5;
+}
+
+const int* ResolutionController::Ladder(int& count) {
+    count = kLadderCount;
+    return kLadder;
+}
+
+int ResolutionController::IndexOf(int res) const {
+    // nearest step at or below res
+    int idx = 0;
+    for (int i = 0; i < kLadderCount; i++) if (kLadder[i] <= res) idx = i;
+    return idx;
+}
+
+int ResolutionController::ClampIndex(int idx) const {
+    int lo = IndexOf(config.minRes);
+    int hi = std::max(lo, IndexOf(config.maxRes));
+    return std::clamp(idx, lo, hi);
+}
+
+void ResolutionController::Reset(int res) {
+    current = kLadder[ClampIndex(IndexOf(res))];
+    framesSinceChange = 0;
+    overBudgetFrames = 0;
+}
+
+int ResolutionController::Update(double recentInferenceMs, const std::vector<Detection>& tracked, int frameW, int frameH) {
+    float smallest = -1.0f;
+    for (const auto& det : tracked) {
+        float side = std::min(det.box.width, det.box.height);
+        if (smallest < 0.0f || side < smallest) smallest = side;
+    }
+    return Update(recentInferenceMs, smallest, frameW, frameH);
+}
+
+int ResolutionController::Update(double recentInferenceMs, float smallest, int frameW, int frameH) {
+    int cur = ClampIndex(IndexOf(current));
+    framesSinceChange++;
+
+    // 1. latency cap, largest step predicted to fit the budget with a bit of headroom
+    int latencyCap = ClampIndex(kLadderCount - 1);
+    if (recentInferenceMs > 0.0) {
+        double msPerPx = recentInferenceMs / ((double)kLadder[cur] * kLadder[cur]);
+        latencyCap = ClampIndex(0);
+        for (int i = latencyCap; i <= ClampIndex(kLadderCount - 1); i++) {
+            double predicted = msPerPx * kLadder[i] * kLadder[i];
+            if (predicted <= config.budgetMs * 0.9) latencyCap = i;
+        }
+    }
+
+    // 2. object size, lowest step where the smallest object keeps minObjectPx
+    // nothing tracked means we are searching, go as high as latency allows
+    int sizeWant = ClampIndex(kLadderCount - 1);
+    int frameMax = std::max(frameW, frameH);
+    if (smallest >= 0.0f && frameMax > 0) {
+        sizeWant = ClampIndex(kLadderCount - 1);
+        for (int i = ClampIndex(0); i <= ClampIndex(kLadderCount - 1); i++) {
+            // letterbox scales the long side of the frame to the input size
+            if (smallest * kLadder[i] / frameMax >= config.minObjectPx) { sizeWant = i; break; }
+        }
+    }
+
+    int target = std::min(latencyCap, sizeWant);
+
+    // 3. hysteresis, down fast when over budget, up slowly
+    int next = cur;
+    bool overBudget = recentInferenceMs > config.budgetMs;
+    if (framesSinceChange > kSettleFrames) overBudgetFrames = overBudget ? overBudgetFrames + 1 : 0;
+
+    if (target < cur) {
+        // objects got big is not urgent, blowing the budget is
+        if (overBudgetFrames >= config.overrunFrames || framesSinceChange >= config.holdFrames) next = cur - 1;
+    } else if (target > cur && framesSinceChange >= config.holdFrames && !overBudget) {
+        next = cur + 1;
+    }
+
+    if (next != cur) {
+        framesSinceChange = 0;
+        overBudgetFrames = 0;
+    }
+    current = kLadder[next];
+    return current;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "TrashDetector.hpp"
+#include <atomic>
+#include <vector>
+
+struct ResolutionConfig {
+    bool enabled = false;
+    double budgetMs = 40.0;       // inference time we want to stay under
+    int minRes = 320;
+    int maxRes = 640;
+    int minObjectPx = 40;         // smallest tracked object should be at least this big in model input
+    int holdFrames = 20;          // frames between steps up, stops flapping
+    int overrunFrames = 3;        // frames over budget before stepping down
+};
+
+// picks the model input size per frame for dynamic shape models
+// latency: cost scales with pixels, so recent ms / res^2 predicts the cost of other steps
+// objects: big close objects survive a lower res fine, small far ones need the full one
+// result goes through TrashDetector::SetInputResolution, fixed res models are left alone
+class ResolutionController {
+public:
+    ResolutionConfig config;
+
+    // recentInferenceMs is the smoothed detect time at Current(), tracked are last frames objects in frame pixels
+    int Update(double recentInferenceMs, const std::vector<Detection>& tracked, int frameW, int frameH);
+    // same with just the shortest side of the smallest tracked box, < 0 when nothing is tracked
+    int Update(double recentInferenceMs, float smallestObjectPx, int frameW, int frameH);
+
+    int Current() const { return current; }
+    void Reset(int res);
+
+    // steps the controller moves between, same as the gui list
+    static const int* Ladder(int& count);
+
+private:
+    int ClampIndex(int idx) const;
+    int IndexOf(int res) const;
+
+    std::atomic<int> current = 640; // gui reads this
+    int framesSinceChange = 0;
+    int overBudgetFrames = 0;
+};
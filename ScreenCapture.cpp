@@ -45,6 +45,17 @@ void ScreenCapture::SetROI(int x, int y, int w, int h) {
     useROI = true;
 }
 
+bool ScreenCapture::Grab(CapturedFrame& out) {
+    // stamp before the blit, pixels are from that moment
+    auto t = FrameClock::now();
+    // pooled buffer, GetDIBits writes straight into it
+    if (targetWidth > 0 && targetHeight > 0) AllocImage(out, targetHeight, targetWidth, CV_8UC4);
+    Capture(out.image);
+    if (out.image.empty()) return false;
+    Stamp(out, t);
+    return true;
+}
+
 void ScreenCapture::Capture(cv::Mat& frame) {
     // 1. determine capture size
     int capW = useROI ? roiW : screenWidth;
@@ -109,12 +120,12 @@ void ScreenCapture::Capture(cv::Mat& frame) {
     bi.biClrUsed = 0;
     bi.biClrImportant = 0;
 
-    // make cv mat wrapper
+    // make cv mat wrapper, no op if the caller handed us a pooled one of this size
     frame.create(targetHeight, targetWidth, CV_8UC4);
     
     // copy direct to frame data
     GetDIBits(hMemoryDC, hBitmap, 0, targetHeight, frame.data, (BITMAPINFO*)&bi, DIB_RGB_COLORS);
     
-    // opencv uses bgr but windows gdi gave bgra
-    cv::cvtColor(frame, frame, cv::COLOR_BGRA2BGR);
+    // stays bgra, letterbox reads it directly and the preview converts anyway
+    // bgr conversion here cost a full copy + alloc per frame
 }
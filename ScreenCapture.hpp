@@ -1,11 +1,12 @@
 #pragma once
 
+#include "FrameSource.hpp"
 #include <opencv2/opencv.hpp>
 #include <windows.h>
 #include <vector>
 
 // handling screen capture class using gdi
-class ScreenCapture {
+class ScreenCapture : public FrameSource {
 public:
     ScreenCapture();
     ~ScreenCapture();
@@ -13,15 +14,20 @@ public:
     // start resources here
     void Init(int width, int height);
 
-    // take screenshot put in frame
+    // take screenshot put in frame, bgra
     void Capture(cv::Mat& frame);
+
+    // framesource version, stamps id and time
+    bool Grab(CapturedFrame& out) override;
+    bool IsLive() const override { return true; }
+    std::string Name() const override { return "screen"; }
     
     // release stuff
     void Release();
     
     // perf control
     void SetFastMode(bool enabled) { fastMode = enabled; }
-    void SetROI(int x, int y, int w, int h);
+    void SetROI(int x, int y, int w, int h) override;
 
 private:
     int screenWidth = 0;
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// bounded single producer single consumer ring, no locks
+// one thread pushes one thread pops, capacity must be a power of two
+// popped slots are reset to T() so whatever they hold is released on the consumer side
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 1 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    // false if full, value is left untouched then
+    bool TryPush(T&& value) {
+        size_t tail = writeIndex.load(std::memory_order_relaxed);
+        if (tail - readIndex.load(std::memory_order_acquire) == Capacity) return false;
+        items[tail & (Capacity - 1)] = std::move(value);
+        writeIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(T& out) {
+        size_t head = readIndex.load(std::memory_order_relaxed);
+        if (head == writeIndex.load(std::memory_order_acquire)) return false;
+        T& item = items[head & (Capacity - 1)];
+        out = std::move(item);
+        item = T();
+        readIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // latest wins, takes everything queued and keeps only the newest
+    // returns how many older items were thrown away, -1 if nothing was queued
+    int PopLatest(T& out) {
+        int dropped = -1;
+        while (TryPop(out)) dropped++;
+        return dropped;
+    }
+
+    bool Empty() const {
+        return readIndex.load(std::memory_order_acquire) == writeIndex.load(std::memory_order_acquire);
+    }
+
+private:
+    // producer and consumer indices on their own cache lines
+    alignas(64) std::atomic<size_t> readIndex{0};
+    alignas(64) std::atomic<size_t> writeIndex{0};
+    alignas(64) T items[Capacity];
+};
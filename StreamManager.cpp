@@ -0,0 +1,281 @@
+#include "StreamManager.hpp"
+#include "TraceRecorder.hpp"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+// batches a ready stream may sit out before it jumps the queue
+const int kStarveBatches = 3;
+
+double MsSince(FrameClock::time_point start) {
+    return std::chrono::duration<double, std::milli>(FrameClock::now() - start).count();
+}
+
+void Ema(std::atomic<double>& value, double sample, double alpha = 0.1) {
+    // single writer per value, no cas needed
+    double prev = value.load(std::memory_order_relaxed);
+    value.store(prev <= 0.0 ? sample : prev + (sample - prev) * alpha, std::memory_order_relaxed);
+}
+
+FrameClock::time_point DeadlineOf(const CapturedFrame& frame, double deadlineMs) {
+    return frame.captureTime + std::chrono::duration_cast<FrameClock::duration>(std::chrono::duration<double, std::milli>(deadlineMs));
+}
+
+} // namespace
+
+StreamManager::StreamManager(TrashDetector& detector) : detector(detector) {}
+
+StreamManager::~StreamManager() {
+    Stop();
+}
+
+int StreamManager::AddStream(StreamConfig config) {
+    if (running) return -1;
+    auto stream = std::make_unique<Stream>();
+    stream->prediction.enabled = config.prediction;
+    if (config.name.empty()) config.name = config.source ? config.source->Name() : "stream" + std::to_string(streams.size());
+    stream->config = std::move(config);
+    streams.push_back(std::move(stream));
+    return (int)streams.size() - 1;
+}
+
+bool StreamManager::AllSourcesDone() const {
+    for (const auto& s : streams) {
+        if (!s->stats.sourceDone) return false;
+    }
+    return true;
+}
+
+void StreamManager::Start(std::function<void(int, PipelineResult&)> callback) {
+    if (running || streams.empty()) return;
+    onResult = std::move(callback);
+    detector.AttachPipeline();
+    running = true;
+    for (auto& s : streams) {
+        Stream* stream = s.get();
+        stream->captureThread = std::thread([this, stream] { CaptureLoop(*stream); });
+    }
+    schedulerThread = std::thread(&StreamManager::SchedulerLoop, this);
+}
+
+void StreamManager::Stop() {
+    if (!running) return;
+    running = false;
+    frameReady.Notify();
+    frameTaken.Notify();
+    for (auto& s : streams) {
+        if (s->captureThread.joinable()) s->captureThread.join();
+    }
+    if (schedulerThread.joinable()) schedulerThread.join();
+    detector.DetachPipeline();
+
+    // pooled frames go back here
+    for (auto& s : streams) {
+        CapturedFrame frame;
+        while (s->queue.TryPop(frame)) {}
+        s->pending = CapturedFrame();
+        s->hasPending = false;
+        s->queued = false;
+    }
+}
+
+void StreamManager::CaptureLoop(Stream& stream) {
+    TraceRecorder::SetThreadName("stream capture");
+    uint64_t seen = 0;
+    while (running) {
+        // one frame per stream in flight, grabbing more would only go stale before the next batch
+        if (stream.queued) {
+            frameTaken.WaitFor(seen, 2);
+            continue;
+        }
+
+        CapturedFrame frame;
+        bool grabbed;
+        {
+            TRACE_SCOPE("capture");
+            grabbed = stream.config.source && stream.config.source->Grab(frame);
+        }
+        if (!grabbed) {
+            stream.stats.sourceDone = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        stream.stats.captured++;
+
+        stream.queued = true;
+        if (!stream.queue.TryPush(std::move(frame))) stream.stats.dropped++;
+        frameReady.Notify();
+    }
+}
+
+int StreamManager::CollectPending() {
+    int count = 0;
+    for (auto& s : streams) {
+        CapturedFrame frame;
+        int dropped = s->queue.PopLatest(frame);
+        if (dropped >= 0) {
+            // newer frame replaces one that never made it into a batch
+            s->stats.dropped += dropped + (s->hasPending ? 1 : 0);
+            s->pending = std::move(frame);
+            s->hasPending = true;
+        }
+        if (s->hasPending) count++;
+    }
+    return count;
+}
+
+double StreamManager::EstimateBatchMs(int batch) const {
+    batch = std::min(std::max(batch, 1), kMaxBatch);
+    double known = stats.batchMs[batch].load(std::memory_order_relaxed);
+    if (known > 0.0) return known;
+
+    // not run at this size yet, scale the closest smaller one linearly
+    for (int b = batch - 1; b >= 1; b--) {
+        double ms = stats.batchMs[b].load(std::memory_order_relaxed);
+        if (ms > 0.0) return ms * batch / b;
+    }
+    return 0.0;
+}
+
+void StreamManager::PickBatch(int count, std::vector<int>& picked) {
+    ready.clear();
+    for (int i = 0; i < (int)streams.size(); i++) {
+        if (streams[i]->hasPending) ready.push_back(i);
+    }
+
+    // starving first, then earliest deadline, then whoever ran longest ago
+    auto before = [this](int a, int b) {
+        const Stream& sa = *streams[a];
+        const Stream& sb = *streams[b];
+        bool starveA = sa.skipped >= kStarveBatches;
+        bool starveB = sb.skipped >= kStarveBatches;
+        if (starveA != starveB) return starveA;
+        auto da = DeadlineOf(sa.pending, sa.config.deadlineMs);
+        auto db = DeadlineOf(sb.pending, sb.config.deadlineMs);
+        if (da != db) return da < db;
+        return sa.lastServed < sb.lastServed;
+    };
+    std::sort(ready.begin(), ready.end(), before);
+
+    count = std::min(count, (int)ready.size());
+    picked.assign(ready.begin(), ready.begin() + count);
+    for (int i = count; i < (int)ready.size(); i++) streams[ready[i]]->skipped++;
+}
+
+void StreamManager::SchedulerLoop() {
+    TraceRecorder::SetThreadName("scheduler");
+    uint64_t seen = 0;
+    std::vector<int> picked;
+    picked.reserve(kMaxBatch);
+
+    while (running) {
+        int readyCount = CollectPending();
+        if (readyCount == 0) {
+            frameReady.WaitFor(seen, 10);
+            continue;
+        }
+
+        int limit = std::min(std::max(1, maxBatch.load()), detector.GetMaxBatch());
+        int active = 0;
+        for (const auto& s : streams) {
+            if (!s->stats.sourceDone || s->hasPending) active++;
+        }
+        int want = std::min(limit, active);
+
+        // a fuller batch is nearly free per frame, wait for stragglers while the earliest deadline allows it
+        if (readyCount < want) {
+            auto earliest = FrameClock::time_point::max();
+            for (const auto& s : streams) {
+                if (s->hasPending) earliest = std::min(earliest, DeadlineOf(s->pending, s->config.deadlineMs));
+            }
+            double slackMs = std::chrono::duration<double, std::milli>(earliest - FrameClock::now()).count();
+            double waitMs = std::min(batchWindowMs.load(), slackMs - EstimateBatchMs(readyCount + 1));
+            if (waitMs > 0.0) {
+                auto until = FrameClock::now() + std::chrono::duration_cast<FrameClock::duration>(std::chrono::duration<double, std::milli>(waitMs));
+                while (running && readyCount < want && FrameClock::now() < until) {
+                    frameReady.WaitUntil(seen, until);
+                    readyCount = CollectPending();
+                }
+            }
+        }
+        if (!running) break;
+
+        PickBatch(limit, picked);
+
+        // their streams can grab the next frame while this batch runs
+        for (int id : picked) streams[id]->queued = false;
+        frameTaken.Notify();
+
+        RunBatch(picked);
+    }
+}
+
+void StreamManager::RunBatch(const std::vector<int>& picked) {
+    int n = (int)picked.size();
+    if (n == 0) return;
+
+    auto t0 = FrameClock::now();
+    batchFrames.clear();
+    for (int id : picked) batchFrames.push_back(&streams[id]->pending.image);
+
+    DetectJob job;
+    bool prepared = false;
+    if (detector.IsLoaded()) {
+        TRACE_SCOPE("preprocess");
+        prepared = (n == 1) ? detector.Prepare(*batchFrames[0], job) : detector.PrepareBatch(batchFrames.data(), n, job);
+        if (!prepared && n > 1) {
+            // model got swapped for a fixed batch one under us, go one by one
+            for (int id : picked) RunBatch(std::vector<int>{id});
+            return;
+        }
+    }
+    if (prepared) detector.Infer(job);
+
+    const float conf = confThreshold;
+    const float nms = nmsThreshold;
+    const float low = lowConfThreshold;
+    for (int i = 0; i < n; i++) {
+        Stream& stream = *streams[picked[i]];
+        TraceRecorder::SetFrame(stream.pending.frameId);
+        results[i].detections.clear();
+        if (prepared) {
+            lowDetections.clear();
+            bool track = stream.prediction.enabled;
+            detector.Decode(job, conf, nms, results[i].detections, i, (track && low > 0.0f) ? &lowDetections : nullptr, low);
+            if (track) {
+                stream.prediction.UpdateHistory(results[i].detections, &lowDetections, &stream.pending);
+                results[i].detections = stream.prediction.GetProcessed();
+            }
+        }
+        results[i].stateTime = stream.pending.captureTime;
+        results[i].frame = std::move(stream.pending);
+        stream.hasPending = false;
+        stream.skipped = 0;
+        stream.lastServed = ++batchCounter;
+    }
+    job.Release(); // slot back before the callbacks
+
+    if (prepared) {
+        Ema(stats.batchMs[n], MsSince(t0));
+        Ema(stats.avgBatch, n);
+        stats.batches++;
+        stats.frames += n;
+    }
+
+    for (int i = 0; i < n; i++) {
+        int id = picked[i];
+        Stream& stream = *streams[id];
+        TraceRecorder::SetFrame(results[i].frame.frameId);
+        if (onResult) {
+            TRACE_SCOPE("publish");
+            onResult(id, results[i]);
+        }
+
+        auto now = FrameClock::now();
+        if (now > DeadlineOf(results[i].frame, stream.config.deadlineMs)) stream.stats.deadlineMisses++;
+        Ema(stream.stats.latencyMs, std::chrono::duration<double, std::milli>(now - results[i].frame.captureTime).count());
+        stream.stats.completed++;
+        results[i].frame = CapturedFrame();
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "TrashDetector.hpp"
+#include "FrameSource.hpp"
+#include "SpscQueue.hpp"
+#include "DetectionPipeline.hpp"
+#include "features/Prediction.hpp"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct StreamConfig {
+    std::string name;
+    std::shared_ptr<FrameSource> source;
+    double deadlineMs = 100.0;   // capture to result budget, earliest deadline goes first
+    bool prediction = true;
+};
+
+struct StreamStats {
+    std::atomic<uint64_t> captured{0};
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> dropped{0};         // replaced by a newer frame before inference got to it
+    std::atomic<uint64_t> deadlineMisses{0};  // result came after captureTime + deadlineMs
+    std::atomic<double> latencyMs{0.0};       // ema capture to result
+    std::atomic<bool> sourceDone{false};
+};
+
+struct StreamManagerStats {
+    std::atomic<uint64_t> batches{0};
+    std::atomic<uint64_t> frames{0};
+    std::atomic<double> avgBatch{0.0};                 // ema frames per run
+    std::atomic<double> batchMs[kMaxBatch + 1] = {};   // ema prep + run + decode per batch size
+};
+
+// several sources on one detector
+// every stream has its own capture thread, latest wins ring and Prediction history
+// one scheduler thread stacks the ready frames into a single [B, 3, H, W] run
+// batch order is earliest deadline first, ties go to the stream served longest ago
+// it waits a little for more streams to fill the batch but never past the earliest deadline
+// models with a fixed batch dim just run frames one by one in the same order
+class StreamManager {
+public:
+    explicit StreamManager(TrashDetector& detector);
+    ~StreamManager();
+
+    // only before Start, returns the stream id
+    int AddStream(StreamConfig config);
+    int StreamCount() const { return (int)streams.size(); }
+
+    // onResult runs on the scheduler thread
+    void Start(std::function<void(int stream, PipelineResult&)> onResult);
+    void Stop();
+    bool IsRunning() const { return running; }
+
+    // knobs, read every batch
+    std::atomic<float> confThreshold{0.5f};
+    std::atomic<float> nmsThreshold{0.45f};
+    std::atomic<float> lowConfThreshold{0.1f}; // weak boxes for the per stream tracker, 0 = off
+    std::atomic<int> maxBatch{kMaxBatch};    // capped by what the model allows
+    std::atomic<double> batchWindowMs{4.0};  // longest wait for stragglers
+
+    const StreamStats& Stats(int stream) const { return streams[stream]->stats; }
+    const StreamManagerStats& Stats() const { return stats; }
+    const std::string& Name(int stream) const { return streams[stream]->config.name; }
+    bool AllSourcesDone() const;
+
+private:
+    struct Stream {
+        StreamConfig config;
+        Prediction prediction;
+        StreamStats stats;
+        SpscQueue<CapturedFrame, 2> queue;
+        std::thread captureThread;
+        std::atomic<bool> queued{false}; // a frame is waiting for a batch, capture holds off
+
+        // scheduler thread only
+        CapturedFrame pending;
+        bool hasPending = false;
+        uint64_t lastServed = 0;  // batch counter when it last ran
+        int skipped = 0;          // batches it was ready for but left out of
+    };
+
+    void CaptureLoop(Stream& stream);
+    void SchedulerLoop();
+
+    // moves newest queued frames into pending, returns how many streams are ready
+    int CollectPending();
+    // ready streams in run order, at most count
+    void PickBatch(int count, std::vector<int>& picked);
+    void RunBatch(const std::vector<int>& picked);
+    double EstimateBatchMs(int batch) const;
+
+    TrashDetector& detector;
+    std::vector<std::unique_ptr<Stream>> streams;
+    std::function<void(int, PipelineResult&)> onResult;
+    StreamManagerStats stats;
+
+    std::atomic<bool> running{false};
+    std::thread schedulerThread;
+
+    StageWake frameReady; // some stream queued a frame
+    StageWake frameTaken; // a batch picked frames, their streams can grab again
+
+    // scheduler thread scratch
+    std::vector<int> ready;
+    std::vector<const cv::Mat*> batchFrames;
+    PipelineResult results[kMaxBatch]; // reused, detections keep their capacity
+    std::vector<Detection> lowDetections;
+    uint64_t batchCounter = 0;
+};
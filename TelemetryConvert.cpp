@@ -0,0 +1,146 @@
+// telemetry log converter, binary logs from TelemetryWriter to something analysis tools read
+// build alone with TelemetryLog.cpp, no opencv no onnxruntime
+//
+// usage: telemetry_convert [--csv out.csv] [--columns outdir] log_000.bin [log_001.bin ...]
+//   --csv      one csv with the same columns the writer uses in csv mode
+//   --columns  one raw little endian file per column plus schema.json, numpy.fromfile / pandas / duckdb
+//              read them without parsing, capture_unix_us is added so runs line up with wall time
+// files are appended in the order given, pass the rotated parts of a run oldest first
+#include "TelemetryLog.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Column {
+    const char* name;
+    const char* type; // numpy style dtype
+    size_t size;
+    // copies the field out of a record
+    void (*get)(const TelemetryRecord&, int64_t unixOffsetUs, void* out);
+};
+
+#define TELEMETRY_COLUMN(name, type, field) \
+    { name, type, sizeof(TelemetryRecord::field), [](const TelemetryRecord& r, int64_t, void* out) { std::memcpy(out, &r.field, sizeof(r.field)); } }
+
+const Column kColumns[] = {
+    TELEMETRY_COLUMN("frame", "<u8", frameId),
+    TELEMETRY_COLUMN("stream", "<i2", streamId),
+    TELEMETRY_COLUMN("kind", "|u1", kind),
+    TELEMETRY_COLUMN("capture_us", "<i8", captureUs),
+    { "capture_unix_us", "<i8", sizeof(int64_t), [](const TelemetryRecord& r, int64_t offset, void* out) {
+        int64_t unixUs = r.captureUs + offset;
+        std::memcpy(out, &unixUs, sizeof(unixUs));
+    } },
+    TELEMETRY_COLUMN("pre_start_us", "<u4", preprocessStartUs),
+    TELEMETRY_COLUMN("pre_done_us", "<u4", preprocessDoneUs),
+    TELEMETRY_COLUMN("infer_start_us", "<u4", inferStartUs),
+    TELEMETRY_COLUMN("infer_done_us", "<u4", inferDoneUs),
+    TELEMETRY_COLUMN("post_start_us", "<u4", postStartUs),
+    TELEMETRY_COLUMN("publish_us", "<u4", publishUs),
+    TELEMETRY_COLUMN("detections", "<u2", detections),
+    TELEMETRY_COLUMN("input_w", "<u2", inputW),
+    TELEMETRY_COLUMN("input_h", "<u2", inputH),
+    TELEMETRY_COLUMN("frame_w", "<u2", frameW),
+    TELEMETRY_COLUMN("frame_h", "<u2", frameH),
+    TELEMETRY_COLUMN("threads", "|u1", threads),
+};
+
+#undef TELEMETRY_COLUMN
+
+struct LoadedFile {
+    TelemetryFileHeader header;
+    std::vector<TelemetryRecord> records;
+};
+
+bool WriteCsv(const std::vector<LoadedFile>& files, const std::string& path) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        std::cerr << "error: cant write " << path << std::endl;
+        return false;
+    }
+    std::string buffer = TelemetryCsvHeader();
+    for (const auto& file : files) {
+        for (const auto& record : file.records) {
+            AppendTelemetryCsv(record, buffer);
+            if (buffer.size() > (1 << 20)) {
+                out.write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+        }
+    }
+    out.write(buffer.data(), buffer.size());
+    return (bool)out;
+}
+
+bool WriteColumns(const std::vector<LoadedFile>& files, const std::string& dir) {
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+
+    size_t rows = 0;
+    for (const auto& file : files) rows += file.records.size();
+
+    std::vector<char> data;
+    for (const Column& column : kColumns) {
+        // a column at a time, one pass over the records each, memory stays at one column
+        data.resize(rows * column.size);
+        size_t row = 0;
+        for (const auto& file : files) {
+            int64_t offset = file.header.startUnixUs - file.header.startSteadyUs;
+            for (const auto& record : file.records) column.get(record, offset, data.data() + (row++) * column.size);
+        }
+
+        std::string path = (std::filesystem::path(dir) / (std::string(column.name) + ".bin")).string();
+        std::ofstream out(path, std::ios::binary);
+        if (!out.write(data.data(), data.size())) {
+            std::cerr << "error: cant write " << path << std::endl;
+            return false;
+        }
+    }
+
+    std::ofstream schema(std::filesystem::path(dir) / "schema.json");
+    schema << "{\"rows\":" << rows << ",\"columns\":[";
+    for (size_t i = 0; i < sizeof(kColumns) / sizeof(kColumns[0]); i++) {
+        schema << (i ? "," : "") << "{\"name\":\"" << kColumns[i].name << "\",\"dtype\":\"" << kColumns[i].type
+               << "\",\"file\":\"" << kColumns[i].name << ".bin\"}";
+    }
+    schema << "],\"kind\":{\"0\":\"detected\",\"1\":\"flow\",\"2\":\"static\"}}\n";
+    return (bool)schema;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string csvPath, columnsDir;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--csv" && i + 1 < argc) csvPath = argv[++i];
+        else if (arg == "--columns" && i + 1 < argc) columnsDir = argv[++i];
+        else inputs.push_back(arg);
+    }
+    if (inputs.empty() || (csvPath.empty() && columnsDir.empty())) {
+        std::cerr << "usage: " << argv[0] << " [--csv out.csv] [--columns outdir] log_000.bin [log_001.bin ...]" << std::endl;
+        return 2;
+    }
+
+    std::vector<LoadedFile> files(inputs.size());
+    size_t total = 0;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        std::string error;
+        if (!ReadTelemetryFile(inputs[i], files[i].header, files[i].records, &error)) {
+            std::cerr << "error: " << error << std::endl;
+            return 1;
+        }
+        total += files[i].records.size();
+    }
+
+    if (!csvPath.empty() && !WriteCsv(files, csvPath)) return 1;
+    if (!columnsDir.empty() && !WriteColumns(files, columnsDir)) return 1;
+    std::cerr << total << " records from " << inputs.size() << " file(s)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include "TelemetryLog.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+int64_t TelemetryNowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* TelemetryCsvHeader() {
+    return "frame,stream,kind,capture_us,pre_start_us,pre_done_us,infer_start_us,infer_done_us,post_start_us,publish_us,"
+           "detections,input_w,input_h,frame_w,frame_h,threads\n";
+}
+
+void AppendTelemetryCsv(const TelemetryRecord& r, std::string& out) {
+    char line[256];
+    int n = snprintf(line, sizeof(line), "%llu,%d,%u,%lld,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
+                     (unsigned long long)r.frameId, (int)r.streamId, (unsigned)r.kind, (long long)r.captureUs,
+                     r.preprocessStartUs, r.preprocessDoneUs, r.inferStartUs, r.inferDoneUs, r.postStartUs, r.publishUs,
+                     (unsigned)r.detections, (unsigned)r.inputW, (unsigned)r.inputH, (unsigned)r.frameW, (unsigned)r.frameH,
+                     (unsigned)r.threads);
+    if (n > 0) out.append(line, (size_t)std::min(n, (int)sizeof(line) - 1));
+}
+
+bool ReadTelemetryFile(const std::string& path, TelemetryFileHeader& header, std::vector<TelemetryRecord>& out, std::string* errorMsg) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        if (errorMsg) *errorMsg = "cant open " + path;
+        return false;
+    }
+    if (!in.read((char*)&header, sizeof(header)) || std::memcmp(header.magic, "SRTL", 4) != 0) {
+        if (errorMsg) *errorMsg = path + " is not a telemetry log";
+        return false;
+    }
+    if (header.version != 1 || header.recordSize != sizeof(TelemetryRecord)) {
+        if (errorMsg) *errorMsg = path + " has an unknown record layout";
+        return false;
+    }
+    TelemetryRecord record;
+    while (in.read((char*)&record, sizeof(record))) out.push_back(record);
+    return true;
+}
+
+TelemetryWriter::~TelemetryWriter() {
+    Stop();
+}
+
+bool TelemetryWriter::Start(std::string* errorMsg) {
+    if (running) return true;
+    if (thread.joinable()) thread.join(); // writer that stopped on its own
+    {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        lastError.clear();
+    }
+    int64_t stamp = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    if (stamp != runStamp) fileIndex = 0; // restarted within the same second, keep counting so nothing gets overwritten
+    runStamp = stamp;
+    // left over from a push that raced the last Stop, writer isnt running so popping here is fine
+    TelemetryRecord stale;
+    while (queue.TryPop(stale)) {}
+    files.clear();
+    totalBytes = 0;
+    if (!OpenNext(errorMsg)) return false;
+    running = true;
+    thread = std::thread(&TelemetryWriter::WriteLoop, this);
+    return true;
+}
+
+void TelemetryWriter::Stop() {
+    // the writer may have stopped on its own, its thread still needs the join
+    running = false;
+    if (thread.joinable()) thread.join();
+}
+
+std::string TelemetryWriter::LastError() const {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    return lastError;
+}
+
+bool TelemetryWriter::Push(const TelemetryRecord& record) {
+    if (!running) return false;
+    TelemetryRecord copy = record;
+    if (queue.TryPush(std::move(copy))) return true;
+    dropped++;
+    return false;
+}
+
+bool TelemetryWriter::OpenNext(std::string* errorMsg) {
+    CloseFile();
+    std::filesystem::path p(config.path);
+    if (p.has_parent_path()) {
+        std::error_code ec;
+        std::filesystem::create_directories(p.parent_path(), ec);
+    }
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), "_%lld_%03d%s", (long long)runStamp, fileIndex++, config.csv ? ".csv" : ".bin");
+    std::string name = config.path + suffix;
+
+    file.open(name, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        if (errorMsg) *errorMsg = "cant write telemetry to " + name;
+        std::cerr << "cant write telemetry to " << name << std::endl;
+        return false;
+    }
+
+    // header first, every file stands on its own
+    if (config.csv) {
+        const char* header = TelemetryCsvHeader();
+        file.write(header, std::strlen(header));
+        fileBytes = std::strlen(header);
+    } else {
+        TelemetryFileHeader header;
+        header.startUnixUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        header.startSteadyUs = TelemetryNowUs();
+        file.write((const char*)&header, sizeof(header));
+        fileBytes = sizeof(header);
+    }
+    fileRecords = 0;
+    files.emplace_back(name, fileBytes);
+    totalBytes += fileBytes;
+    bytesWritten += fileBytes;
+    return true;
+}
+
+void TelemetryWriter::CloseFile() {
+    if (file.is_open()) file.close();
+}
+
+void TelemetryWriter::EnforceBudget() {
+    // never the file being written
+    while (files.size() > 1 && totalBytes > config.maxTotalBytes) {
+        std::error_code ec;
+        std::filesystem::remove(files.front().first, ec);
+        totalBytes -= files.front().second;
+        files.pop_front();
+    }
+}
+
+void TelemetryWriter::WriteLoop() {
+    auto lastFlush = std::chrono::steady_clock::now();
+    TelemetryRecord record;
+    // keeps going after Stop until the ring is empty
+    for (;;) {
+        buffer.clear();
+        int batch = 0;
+        while (batch < 1024 && queue.TryPop(record)) {
+            if (config.csv) AppendTelemetryCsv(record, buffer);
+            else buffer.append((const char*)&record, sizeof(record));
+            batch++;
+        }
+
+        if (batch > 0 && file.is_open()) {
+            // rotate on record boundaries
+            if (fileBytes + buffer.size() > config.maxFileBytes && fileRecords > 0) {
+                std::string error;
+                if (!OpenNext(&error)) {
+                    // nowhere to write, stop taking records instead of queueing into nothing
+                    running = false;
+                    {
+                        std::lock_guard<std::mutex> lock(errorMutex);
+                        lastError = error;
+                    }
+                    uint64_t lost = batch;
+                    while (queue.TryPop(record)) lost++;
+                    dropped += lost;
+                    break;
+                }
+                EnforceBudget();
+            }
+            file.write(buffer.data(), buffer.size());
+            fileBytes += buffer.size();
+            files.back().second = fileBytes;
+            totalBytes += buffer.size();
+            bytesWritten += buffer.size();
+            fileRecords += batch;
+            written += batch;
+            EnforceBudget();
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastFlush >= std::chrono::milliseconds(config.flushMs)) {
+            if (file.is_open()) file.flush();
+            lastFlush = now;
+        }
+        if (batch == 0) {
+            if (!running) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    CloseFile();
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "SpscQueue.hpp"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// what produced the boxes of a frame
+enum TelemetryKind : uint8_t {
+    TelemetryDetected = 0, // went through the detector
+    TelemetryFlow = 1,     // keyframe mode, moved by optical flow
+    TelemetryStatic = 2,   // motion gate, last boxes reused
+};
+
+// one published frame, fixed size so a binary log is a header and an array of these
+// stage stamps are us after captureUs, 0 = that stage didnt run for this frame
+struct TelemetryRecord {
+    uint64_t frameId = 0;
+    int64_t captureUs = 0;         // steady clock, same as the trace
+    uint32_t preprocessStartUs = 0;
+    uint32_t preprocessDoneUs = 0;
+    uint32_t inferStartUs = 0;
+    uint32_t inferDoneUs = 0;
+    uint32_t postStartUs = 0;
+    uint32_t publishUs = 0;
+    uint16_t detections = 0;
+    uint16_t inputW = 0;           // model input, 0 when no detector run
+    uint16_t inputH = 0;
+    uint16_t frameW = 0;
+    uint16_t frameH = 0;
+    int16_t streamId = -1;
+    uint8_t threads = 0;           // intra op threads of the session
+    uint8_t kind = TelemetryDetected;
+    uint8_t reserved[10] = {};
+};
+static_assert(sizeof(TelemetryRecord) == 64, "telemetry record layout is part of the file format");
+
+// start of every binary log file, little endian like the records
+struct TelemetryFileHeader {
+    char magic[4] = {'S', 'R', 'T', 'L'};
+    uint16_t version = 1;
+    uint16_t recordSize = sizeof(TelemetryRecord);
+    int64_t startUnixUs = 0;       // wall clock when the file was opened
+    int64_t startSteadyUs = 0;     // steady clock at the same moment, maps captureUs to wall time
+};
+static_assert(sizeof(TelemetryFileHeader) == 24, "telemetry header layout is part of the file format");
+
+struct TelemetryConfig {
+    std::string path = "logs/telemetry"; // files are path_<unix sec>_<n>.bin (or .csv)
+    bool csv = false;                     // text instead of binary, ~3x bigger
+    uint64_t maxFileBytes = 64ull << 20;  // rotate past this
+    uint64_t maxTotalBytes = 512ull << 20; // oldest files of this run get deleted past this
+    int flushMs = 500;                    // a crash loses at most about this much
+};
+
+// per frame telemetry to disk without touching the pipeline threads
+// the producer pushes fixed size records into a lock free ring, a background thread
+// batches them to the file, flushes every flushMs and rotates/deletes to stay in budget
+// one producer thread only (the post thread), a full ring drops records and counts them
+class TelemetryWriter {
+public:
+    TelemetryConfig config;
+
+    ~TelemetryWriter();
+    bool Start(std::string* errorMsg = nullptr);
+    void Stop(); // writes whatever is queued first
+    // false after Stop, and after the writer gave up on a file it couldnt open (see LastError)
+    bool IsRunning() const { return running; }
+    // why the writer stopped on its own, empty if it didnt, cleared by Start
+    std::string LastError() const;
+
+    // never blocks, false if not running or the ring is full
+    bool Push(const TelemetryRecord& record);
+
+    uint64_t Written() const { return written; }
+    uint64_t Dropped() const { return dropped; }
+    uint64_t BytesWritten() const { return bytesWritten; }
+
+private:
+    void WriteLoop();
+    bool OpenNext(std::string* errorMsg = nullptr);
+    void CloseFile();
+    void EnforceBudget();
+
+    SpscQueue<TelemetryRecord, 4096> queue; // ~4s at 1000 fps, 256KB
+    std::atomic<bool> running{false};
+    std::thread thread;
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> bytesWritten{0};
+    mutable std::mutex errorMutex;
+    std::string lastError;
+
+    // writer thread only
+    std::ofstream file;
+    std::string buffer;
+    uint64_t fileBytes = 0;
+    uint64_t fileRecords = 0;
+    int fileIndex = 0;
+    int64_t runStamp = 0;
+    std::deque<std::pair<std::string, uint64_t>> files; // this run, oldest first, with sizes
+    uint64_t totalBytes = 0;
+};
+
+// helpers shared with TelemetryConvert.cpp
+int64_t TelemetryNowUs(); // steady clock us
+const char* TelemetryCsvHeader();
+void AppendTelemetryCsv(const TelemetryRecord& record, std::string& out);
+// whole binary log into out, false on a bad header, a torn last record is ignored
+bool ReadTelemetryFile(const std::string& path, TelemetryFileHeader& header, std::vector<TelemetryRecord>& out,
+                       std::string* errorMsg = nullptr);
@@ -0,0 +1,162 @@
+#include "TraceRecorder.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+thread_local uint64_t threadFrame = TraceRecorder::kNoFrame;
+thread_local std::string threadName;
+
+// thread names go into json as is, keep them printable
+std::string JsonSafe(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if ((unsigned char)c >= 0x20) out += c;
+    }
+    return out;
+}
+
+} // namespace
+
+// gives the ring back when its thread exits, pipelines restart their threads on every Start
+struct TraceRingOwner {
+    TraceRecorder::Ring* ring = nullptr;
+    ~TraceRingOwner() {
+        if (ring) TraceRecorder::Get().ReleaseRing(ring);
+    }
+};
+
+namespace {
+
+thread_local TraceRingOwner threadRing;
+
+} // namespace
+
+TraceRecorder& TraceRecorder::Get() {
+    static TraceRecorder recorder;
+    return recorder;
+}
+
+int64_t TraceRecorder::NowNs() {
+    // same clock as the frame stamps so traces line up with captureTime
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TraceRecorder::Ring* TraceRecorder::ThreadRing() {
+    if (threadRing.ring) return threadRing.ring;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    // an exited thread's ring if there is one, same name first (a restarted stage) so its timeline
+    // just carries on, any other free one loses its old events
+    const std::string& name = threadName;
+    Ring* ring = nullptr;
+    for (auto& r : rings) {
+        if (r->inUse) continue;
+        if (!name.empty() && r->threadName == name) {
+            ring = r.get();
+            break;
+        }
+        if (!ring) ring = r.get();
+    }
+    if (ring && ring->threadName != name) ring->cleared.store(ring->head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    if (!ring) {
+        rings.push_back(std::make_unique<Ring>());
+        ring = rings.back().get();
+        ring->tid = (int)rings.size();
+    }
+    ring->inUse = true;
+    ring->threadName = name.empty() ? "thread " + std::to_string(ring->tid) : name;
+    threadRing.ring = ring;
+    return ring;
+}
+
+void TraceRecorder::ReleaseRing(Ring* ring) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    ring->inUse = false;
+}
+
+void TraceRecorder::SetThreadName(const char* name) {
+    threadName = name;
+    if (!threadRing.ring) return; // named when it takes a ring
+    TraceRecorder& rec = Get();
+    std::lock_guard<std::mutex> lock(rec.registryMutex);
+    threadRing.ring->threadName = name;
+}
+
+void TraceRecorder::SetFrame(uint64_t frameId) {
+    threadFrame = frameId;
+}
+
+void TraceRecorder::Record(const char* name, int64_t startNs, int64_t durNs) {
+    Ring* ring = ThreadRing();
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    TraceEvent& e = ring->events[head % kRingSize];
+    e.name = name;
+    e.startNs = startNs;
+    e.durNs = durNs;
+    e.frameId = threadFrame;
+    ring->head.store(head + 1, std::memory_order_release); // export sees the event only once its written
+}
+
+void TraceRecorder::Clear() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto& ring : rings) ring->cleared.store(ring->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+bool TraceRecorder::ExportChrome(const std::string& path) {
+    struct Copy {
+        int tid;
+        std::string threadName;
+        std::vector<TraceEvent> events;
+    };
+    std::vector<Copy> copies;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto& ring : rings) {
+            Copy c;
+            c.tid = ring->tid;
+            c.threadName = ring->threadName;
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            uint64_t from = std::max(ring->cleared.load(std::memory_order_relaxed), head > (uint64_t)kRingSize ? head - kRingSize : 0);
+            for (uint64_t i = from; i < head; i++) c.events.push_back(ring->events[i % kRingSize]);
+            // the owner kept writing, whatever it lapped during the copy may be torn
+            uint64_t after = ring->head.load(std::memory_order_acquire);
+            uint64_t valid = after > (uint64_t)kRingSize ? after - kRingSize : 0;
+            if (valid > from) c.events.erase(c.events.begin(), c.events.begin() + (size_t)std::min<uint64_t>(valid - from, c.events.size()));
+            copies.push_back(std::move(c));
+        }
+    }
+
+    int64_t origin = INT64_MAX;
+    for (const auto& c : copies) {
+        for (const auto& e : c.events) origin = std::min(origin, e.startNs);
+    }
+    if (origin == INT64_MAX) origin = 0;
+
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "cant write trace " << path << std::endl;
+        return false;
+    }
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    char line[256];
+    for (const auto& c : copies) {
+        file << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << c.tid
+             << ",\"args\":{\"name\":\"" << JsonSafe(c.threadName) << "\"}}";
+        first = false;
+        for (const auto& e : c.events) {
+            int n = snprintf(line, sizeof(line), ",\n{\"ph\":\"X\",\"name\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                             e.name, c.tid, (e.startNs - origin) / 1000.0, e.durNs / 1000.0);
+            file.write(line, std::min(n, (int)sizeof(line) - 1));
+            if (e.frameId != kNoFrame) file << ",\"args\":{\"frame\":" << e.frameId << "}";
+            file << "}";
+        }
+    }
+    file << "\n]}\n";
+    return true;
+}
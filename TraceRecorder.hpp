@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// per stage timing for chrome://tracing / ui.perfetto.dev
+// TRACE_SCOPE("name") times the enclosing block, name has to be a literal (only the pointer is kept)
+// every thread writes its own ring, no locks and no allocs on the hot path, the first event of a
+// thread takes a ring once (mutex, plus an alloc unless an exited thread left one free)
+// off by default, a scope while off is one relaxed load and no clock read, threads that never
+// record while on never get a ring
+struct TraceEvent {
+    const char* name;
+    int64_t startNs;
+    int64_t durNs;
+    uint64_t frameId; // frame the thread was on, kNoFrame if none
+};
+
+class TraceRecorder {
+public:
+    static const int kRingSize = 1 << 15; // events per thread, oldest get overwritten
+    static const uint64_t kNoFrame = ~0ull;
+
+    // one per process, the macros write here
+    static TraceRecorder& Get();
+
+    void SetEnabled(bool on) { enabled.store(on, std::memory_order_relaxed); }
+    bool IsEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    // label for the calling thread in the trace, cheap, only kept until the thread records
+    static void SetThreadName(const char* name);
+    // frame id the next events of the calling thread belong to, shows up as args.frame
+    static void SetFrame(uint64_t frameId);
+
+    static int64_t NowNs();
+    void Record(const char* name, int64_t startNs, int64_t durNs);
+
+    // whatever is still in the rings as chrome trace json ("X" events, ts/dur in us)
+    // safe while threads keep tracing, events overwritten during the copy are left out
+    bool ExportChrome(const std::string& path);
+    // drop everything recorded so far, rings stay
+    void Clear();
+
+private:
+    struct Ring {
+        TraceEvent events[kRingSize];
+        std::atomic<uint64_t> head{0};    // events ever written, only the owner thread writes it
+        std::atomic<uint64_t> cleared{0}; // export starts here after Clear
+        std::string threadName;           // under registryMutex
+        int tid = 0;
+        bool inUse = false;               // under registryMutex, false once the owner thread exited
+    };
+    friend struct TraceRingOwner;
+
+    Ring* ThreadRing();
+    void ReleaseRing(Ring* ring);
+
+    std::atomic<bool> enabled{false};
+    std::mutex registryMutex;
+    // never shrinks, a finished thread's events stay exportable until another thread reuses its ring
+    std::vector<std::unique_ptr<Ring>> rings;
+};
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name)
+        : name(TraceRecorder::Get().IsEnabled() ? name : nullptr), start(this->name ? TraceRecorder::NowNs() : 0) {}
+    ~TraceScope() {
+        if (name) TraceRecorder::Get().Record(name, start, TraceRecorder::NowNs() - start);
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+    int64_t start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
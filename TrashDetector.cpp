@@ -1,89 +1,281 @@
 #include "TrashDetector.hpp"
+#include "TraceRecorder.hpp"
 #include <iostream>
 #include <algorithm>
 #include <fstream>
 #include <regex>
-#include <opencv2/dnn.hpp>
+#include <chrono>
+#include <filesystem>
+#include <cassert>
 
 TrashDetector::TrashDetector() 
-    : env(ORT_LOGGING_LEVEL_WARNING, "TrashDetector"), session(nullptr) {
+    : env(ORT_LOGGING_LEVEL_WARNING, "TrashDetector"),
+      memoryInfo(Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault)) {
 }
 
-bool TrashDetector::LoadModel(const std::string& modelPath, bool useCUDA, int numThreads, std::string* errorMsg) {
+TrashDetector::~TrashDetector() {
+    {
+        std::lock_guard<std::mutex> lock(loadMutex);
+        stopLoader = true;
+    }
+    loadCv.notify_all();
+    if (loaderThread.joinable()) loaderThread.join();
+}
+
+DetectJob& DetectJob::operator=(DetectJob&& other) noexcept {
+    if (this != &other) {
+        Release();
+        model = std::move(other.model);
+        io = std::move(other.io);
+        slot = other.slot;
+        count = other.count;
+        for (int i = 0; i < count; i++) items[i] = other.items[i];
+        inferred = other.inferred;
+        other.slot = -1;
+    }
+    return *this;
+}
+
+void DetectJob::Release() {
+    if (io && slot >= 0) io->slots[slot].busy.store(false, std::memory_order_release);
+    slot = -1;
+    count = 0;
+    io.reset();
+    model.reset();
+}
+
+void TrashDetector::BindSlot(ModelInstance& m, const BoundIo& io, IoSlot& slot) {
+    if (slot.input.empty()) slot.input.assign((size_t)io.batch * 3 * io.width * io.height, 0.0f);
+
+    std::vector<int64_t> inputShape = {io.batch, 3, io.height, io.width};
+    slot.inputTensor = Ort::Value::CreateTensor<float>(memoryInfo, slot.input.data(), slot.input.size(), inputShape.data(), inputShape.size());
+    slot.binding = std::make_unique<Ort::IoBinding>(*m.session);
+    slot.binding->BindInput(m.inputNodeNamesAllocated[0], slot.inputTensor);
+
+    size_t outputSize = 1;
+    for (int64_t d : io.outputShape) outputSize *= (size_t)d;
+    slot.output.assign(outputSize, 0.0f);
+    slot.outputTensor = Ort::Value::CreateTensor<float>(memoryInfo, slot.output.data(), slot.output.size(), io.outputShape.data(), io.outputShape.size());
+    slot.binding->BindOutput(m.outputNodeNamesAllocated[0], slot.outputTensor);
+}
+
+std::shared_ptr<BoundIo> TrashDetector::GetBinding(ModelInstance& m, int width, int height, int batch) {
+    {
+        std::lock_guard<std::mutex> lock(m.bindMutex);
+        for (auto& io : m.boundIo) {
+            if (io->width == width && io->height == height && io->batch == batch) return io;
+        }
+    }
+
+    // built and warmed without the lock, Prepare keeps finding the old bindings meanwhile
+    // own run options, this runs on the loader thread
+    Ort::RunOptions warmupOptions;
+
+    auto io = std::make_shared<BoundIo>();
+    io->width = width;
+    io->height = height;
+    io->batch = batch;
+
+    // output shape from model, dynamic dims need one run to find out
+    io->outputShape = m.session->GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+    bool dynamicOutput = false;
+    for (int64_t d : io->outputShape) if (d <= 0) dynamicOutput = true;
+
+    IoSlot& first = io->slots[0];
+    if (dynamicOutput) {
+        first.input.assign((size_t)batch * 3 * width * height, 0.0f);
+        std::vector<int64_t> inputShape = {batch, 3, height, width};
+        Ort::Value probeInput = Ort::Value::CreateTensor<float>(memoryInfo, first.input.data(), first.input.size(), inputShape.data(), inputShape.size());
+        Ort::IoBinding probe(*m.session);
+        probe.BindInput(m.inputNodeNamesAllocated[0], probeInput);
+        probe.BindOutput(m.outputNodeNamesAllocated[0], memoryInfo);
+        m.session->Run(warmupOptions, probe);
+        io->outputShape = probe.GetOutputValues().front().GetTensorTypeAndShapeInfo().GetShape();
+    }
+
+    BindSlot(m, *io, first);
+    io->outputPerItem = first.output.size() / (size_t)batch;
+
+    // pick decoder once here so detect never branches on layout
+    io->head = DetectHeadLayout(io->outputShape, forceHeadLayout);
+    io->decode = SelectDecoder(io->head.layout, io->head.classes);
+
+    // warm up, first run does lazy init inside ort
+    m.session->Run(warmupOptions, *first.binding);
+
+    std::lock_guard<std::mutex> lock(m.bindMutex);
+    for (auto& other : m.boundIo) {
+        if (other->width == width && other->height == height && other->batch == batch) return other; // someone was faster
+    }
+    const int MAX_BINDINGS = 16; // whole adaptive res ladder plus a few batch sizes
+    if ((int)m.boundIo.size() >= MAX_BINDINGS) m.boundIo.erase(m.boundIo.begin()); // drop oldest, jobs still using it keep it alive
+    m.boundIo.push_back(io);
+    return io;
+}
+
+std::shared_ptr<BoundIo> TrashDetector::FindBinding(const std::shared_ptr<ModelInstance>& m, int width, int height, int batch) {
+    std::shared_ptr<BoundIo> fallback;
+    {
+        std::lock_guard<std::mutex> lock(m->bindMutex);
+        for (auto& io : m->boundIo) {
+            if (io->width == width && io->height == height && io->batch == batch) return io;
+            if (io->batch == batch) fallback = io; // newest of this batch size wins
+        }
+    }
+
+    // first frame at this size, a warm up run here would stall the frame, the loader does it
+    std::lock_guard<std::mutex> lock(loadMutex);
+    for (const auto& req : pendingBinds) {
+        if (req.model.lock() == m && req.width == width && req.height == height && req.batch == batch) return fallback;
+    }
+    pendingBinds.push_back(BindRequest{ m, width, height, batch });
+    if (!loaderThread.joinable()) loaderThread = std::thread(&TrashDetector::LoaderLoop, this);
+    loadCv.notify_one();
+    return fallback;
+}
+
+bool TrashDetector::WarmInputResolution(int batch) {
+    std::shared_ptr<ModelInstance> m = std::atomic_load(&model);
+    if (!m) return false;
+    int useW = (m->fixedInputWidth > 0) ? m->fixedInputWidth : inputWidth.load();
+    int useH = (m->fixedInputHeight > 0) ? m->fixedInputHeight : inputHeight.load();
     try {
-        Ort::SessionOptions sessionOptions;
-        sessionOptions.SetIntraOpNumThreads(numThreads);
-        // resetting the dimensions because we are loading new model so we need to reset them
-        fixedInputWidth = -1;
-        fixedInputHeight = -1;
-        
-        // sequential execution is faster for batch 1 so we use it
-        sessionOptions.SetInterOpNumThreads(1); 
-        sessionOptions.SetExecutionMode(ExecutionMode::ORT_SEQUENTIAL);
-        sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
-
-        if (useCUDA) {
-            // to use cuda we need libs but they are missing so we skip it for now
-            // if we had dlls it would work but we dont
-            // so we skip it to prevent linker errors yes
+        return GetBinding(*m, useW, useH, batch) != nullptr;
+    } catch (const Ort::Exception& e) {
+        std::cerr << "runtime error during bind " << e.what() << std::endl;
+        return false;
+    }
+}
+
+int TrashDetector::AcquireSlot(ModelInstance& m, BoundIo& io) {
+    for (int i = 0; i < kIoSlots; i++) {
+        bool expected = false;
+        if (!io.slots[i].busy.compare_exchange_strong(expected, true, std::memory_order_acquire)) continue;
+        // later slots only get buffers once a pipeline actually needs them
+        if (!io.slots[i].binding) BindSlot(m, io, io.slots[i]);
+        return i;
+    }
+    return -1;
+}
+
+std::shared_ptr<ModelInstance> TrashDetector::BuildModel(const std::string& modelPath, bool useCUDA, int numThreads, std::string* errorMsg) {
+    try {
+        auto buildStart = std::chrono::steady_clock::now();
+        auto m = std::make_shared<ModelInstance>();
+        m->path = modelPath;
+        m->threads = numThreads;
+
+        // same options for cold and cached, only the optimization level differs
+        auto makeOptions = [&](GraphOptimizationLevel level) {
+            Ort::SessionOptions sessionOptions;
+            sessionOptions.SetIntraOpNumThreads(numThreads);
             
-            // FIXME: dynamic lookup or static link required.
-            // OrtSessionOptionsAppendExecutionProvider_CUDA(sessionOptions, 0); 
-            std::cout << "bro gpu requested but support disabled in build rip" << std::endl;
-            // wait acts i think we can enable this if we just copy the dlls right? or am i stupid
+            // sequential execution is faster for batch 1 so we use it
+            sessionOptions.SetInterOpNumThreads(1); 
+            sessionOptions.SetExecutionMode(ExecutionMode::ORT_SEQUENTIAL);
+            sessionOptions.SetGraphOptimizationLevel(level);
+
+            if (useCUDA) {
+                // to use cuda we need libs but they are missing so we skip it for now
+                // if we had dlls it would work but we dont
+                // so we skip it to prevent linker errors yes
+                
+                // FIXME: dynamic lookup or static link required.
+                // OrtSessionOptionsAppendExecutionProvider_CUDA(sessionOptions, 0); 
+                std::cout << "bro gpu requested but support disabled in build rip" << std::endl;
+                // wait acts i think we can enable this if we just copy the dlls right? or am i stupid
+            }
+            return sessionOptions;
+        };
+
+        auto openSession = [&](const std::string& path, const Ort::SessionOptions& options) {
+#ifdef _WIN32
+            std::wstring wPath(path.begin(), path.end());
+            return std::make_unique<Ort::Session>(env, wPath.c_str(), options);
+#else
+            return std::make_unique<Ort::Session>(env, path.c_str(), options);
+#endif
+        };
+
+        // optimized graph cache, see ModelCache.cpp
+        auto t0 = std::chrono::steady_clock::now();
+        std::string cacheKey = modelCache.enabled
+            ? modelCache.MakeKey(modelPath, numThreads, inputWidth.load(), inputHeight.load(), useCUDA) : "";
+
+        if (modelCache.Has(cacheKey)) {
+            try {
+                // already optimized, running the passes again would just burn time
+                m->session = openSession(modelCache.PathFor(cacheKey), makeOptions(GraphOptimizationLevel::ORT_DISABLE_ALL));
+                m->fromCache = true;
+            } catch (const Ort::Exception& e) {
+                std::cerr << "cached model broken, rebuilding " << e.what() << std::endl;
+                modelCache.Drop(cacheKey);
+            }
         }
 
+        if (!m->session) {
+            Ort::SessionOptions sessionOptions = makeOptions(GraphOptimizationLevel::ORT_ENABLE_ALL);
+            std::string tmpPath = modelCache.TempPathFor(cacheKey);
+            if (!tmpPath.empty()) {
+                std::error_code ec;
+                std::filesystem::create_directories(modelCache.dir, ec);
 #ifdef _WIN32
-        std::wstring wModelPath(modelPath.begin(), modelPath.end());
-        session = std::make_unique<Ort::Session>(env, wModelPath.c_str(), sessionOptions);
+                std::wstring wTmpPath(tmpPath.begin(), tmpPath.end());
+                sessionOptions.SetOptimizedModelFilePath(wTmpPath.c_str());
 #else
-        session = std::make_unique<Ort::Session>(env, modelPath.c_str(), sessionOptions);
+                sessionOptions.SetOptimizedModelFilePath(tmpPath.c_str());
 #endif
+            }
+            m->session = openSession(modelPath, sessionOptions);
+        }
+
+        m->sessionMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        if (m->fromCache) {
+            m->coldMs = modelCache.ColdMs(cacheKey);
+            std::cout << "cached start " << (int)m->sessionMs << " ms";
+            if (m->coldMs >= 0.0) std::cout << " (cold was " << (int)m->coldMs << " ms)";
+            std::cout << std::endl;
+        } else {
+            std::cout << "cold start " << (int)m->sessionMs << " ms" << std::endl;
+            if (modelCache.Commit(cacheKey, m->sessionMs)) std::cout << "optimized model cached as " << cacheKey << std::endl;
+        }
         std::cout << "model loaded from path " << modelPath << std::endl;
         
         // --- dynamic input output res ---
         Ort::AllocatorWithDefaultOptions allocator;
-        
-        // reset lists
-        inputNodeNames.clear();
-        outputNodeNames.clear();
-        inputNodeNamesAllocated.clear();
-        outputNodeNamesAllocated.clear();
 
-        size_t numInputNodes = session->GetInputCount();
+        size_t numInputNodes = m->session->GetInputCount();
         for (size_t i = 0; i < numInputNodes; i++) {
-            auto inputName = session->GetInputNameAllocated(i, allocator);
-            inputNodeNames.push_back(inputName.get());
+            auto inputName = m->session->GetInputNameAllocated(i, allocator);
+            m->inputNodeNames.push_back(inputName.get());
         }
         
-        size_t numOutputNodes = session->GetOutputCount();
+        size_t numOutputNodes = m->session->GetOutputCount();
         for (size_t i = 0; i < numOutputNodes; i++) {
-            auto outputName = session->GetOutputNameAllocated(i, allocator);
-            outputNodeNames.push_back(outputName.get());
+            auto outputName = m->session->GetOutputNameAllocated(i, allocator);
+            m->outputNodeNames.push_back(outputName.get());
         }
 
         // fix crash by detecting shape automatically
         try {
-            auto typeInfo = session->GetInputTypeInfo(0);
+            auto typeInfo = m->session->GetInputTypeInfo(0);
             auto tensorInfo = typeInfo.GetTensorTypeAndShapeInfo();
             auto shape = tensorInfo.GetShape();
             
             // check if width height are fixed not -1
             // usually shape is 1 3 h w or -1 3 -1 -1
             if (shape.size() >= 4) {
+                // free batch dim lets the stream manager stack frames
+                m->dynamicBatch = shape[0] <= 0;
                 int64_t h = shape[2];
                 int64_t w = shape[3];
                 
                 if (h > 0 && w > 0) {
                    // fixed res model force it
-                   fixedInputWidth = (int)w;
-                   fixedInputHeight = (int)h;
-                   inputWidth = fixedInputWidth;   // force now
-                   inputHeight = fixedInputHeight; 
+                   m->fixedInputWidth = (int)w;
+                   m->fixedInputHeight = (int)h;
                    std::cout << "model requires fixed res " << w << "x" << h << std::endl;
                 } else {
-                   fixedInputWidth = -1;
-                   fixedInputHeight = -1;
                    std::cout << "model supports dynamic res" << std::endl;
                 }
             }
@@ -92,24 +284,160 @@ bool TrashDetector::LoadModel(const std::string& modelPath, bool useCUDA, int nu
         }
         
         // setup pointers for run
-        for (const auto& name : inputNodeNames) inputNodeNamesAllocated.push_back(name.c_str());
-        for (const auto& name : outputNodeNames) outputNodeNamesAllocated.push_back(name.c_str());
+        for (const auto& name : m->inputNodeNames) m->inputNodeNamesAllocated.push_back(name.c_str());
+        for (const auto& name : m->outputNodeNames) m->outputNodeNamesAllocated.push_back(name.c_str());
         
+        // bind io for the res it will run at now instead of on first frame
+        // this is also the warm up run
+        int bindW = m->fixedInputWidth > 0 ? m->fixedInputWidth : inputWidth.load();
+        int bindH = m->fixedInputHeight > 0 ? m->fixedInputHeight : inputHeight.load();
+        std::shared_ptr<BoundIo> io = GetBinding(*m, bindW, bindH);
+        if (!io->decode) std::cerr << "unsupported output layout, detect will return nothing" << std::endl;
+        m->head = io->head;
+
         // logs removed for performance
         // std::cout << "DEBUG: Found Input: " << (inputNodeNames.empty() ? "?" : inputNodeNames[0]) << std::endl;
         // std::cout << "DEBUG: Found Output: " << (outputNodeNames.empty() ? "?" : outputNodeNames[0]) << std::endl;
 
-        return true;
+        m->loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+        return m;
     } catch (const Ort::Exception& e) {
         std::string err = e.what();
         std::cerr << "error loading model " << err << std::endl;
         if (errorMsg) *errorMsg = err;
-        return false;
+        return nullptr;
+    }
+}
+
+bool TrashDetector::LoadModel(const std::string& modelPath, bool useCUDA, int numThreads, std::string* errorMsg) {
+    auto m = BuildModel(modelPath, useCUDA, numThreads, errorMsg);
+    if (!m) return false;
+
+    if (m->fixedInputWidth > 0) {
+        inputWidth = m->fixedInputWidth;   // force now
+        inputHeight = m->fixedInputHeight;
+    }
+    // old one dies when the last detect using it returns
+    std::atomic_store(&model, m);
+
+    std::lock_guard<std::mutex> lock(loadMutex);
+    if (!pendingLoad) {
+        loadStatus.state = ModelLoadState::Ready;
+        loadStatus.path = modelPath;
+        loadStatus.message.clear();
+        loadStatus.loadMs = m->loadMs;
+        loadStatus.sessionMs = m->sessionMs;
+        loadStatus.fromCache = m->fromCache;
+        loadStatus.coldMs = m->coldMs;
+        loadStatus.head = m->head;
+        loadStatus.generation++;
     }
+    return true;
+}
+
+void TrashDetector::LoadModelAsync(const std::string& modelPath, bool useCUDA, int numThreads) {
+    std::lock_guard<std::mutex> lock(loadMutex);
+    pendingLoad = LoadRequest{ modelPath, useCUDA, numThreads };
+    loadStatus.state = ModelLoadState::Loading;
+    loadStatus.path = modelPath;
+    loadStatus.message.clear();
+    if (!loaderThread.joinable()) loaderThread = std::thread(&TrashDetector::LoaderLoop, this);
+    loadCv.notify_one();
+}
+
+ModelLoadStatus TrashDetector::GetLoadStatus() const {
+    std::lock_guard<std::mutex> lock(loadMutex);
+    return loadStatus;
+}
+
+void TrashDetector::LoaderLoop() {
+    while (true) {
+        std::optional<LoadRequest> next;
+        std::optional<BindRequest> bind;
+        {
+            std::unique_lock<std::mutex> lock(loadMutex);
+            auto ready = [this] { return stopLoader || pendingLoad.has_value() || !pendingBinds.empty(); };
+            // while old models wait for their last frame look again every few ms, otherwise sleep until asked
+            if (retired.empty()) loadCv.wait(lock, ready);
+            else loadCv.wait_for(lock, std::chrono::milliseconds(20), ready);
+            if (stopLoader) return;
+            next.swap(pendingLoad);
+            // a model swap makes bindings for the old one pointless, load first
+            if (!next && !pendingBinds.empty()) bind = pendingBinds.front();
+        }
+
+        // the frame in flight finished with it, free it here so the worker never pays for tearing down a session
+        // nothing can take a new reference once it is swapped out, so a count of 1 stays 1
+        retired.erase(std::remove_if(retired.begin(), retired.end(),
+                                     [](const std::shared_ptr<ModelInstance>& m) { return m.use_count() == 1; }),
+                      retired.end());
+        if (bind) {
+            // off the preprocess thread so a resolution change never stalls a frame on the warm up run
+            if (std::shared_ptr<ModelInstance> m = bind->model.lock()) {
+                try {
+                    GetBinding(*m, bind->width, bind->height, bind->batch);
+                } catch (const Ort::Exception& e) {
+                    std::cerr << "runtime error during bind " << e.what() << std::endl;
+                }
+            }
+            std::lock_guard<std::mutex> lock(loadMutex);
+            pendingBinds.erase(pendingBinds.begin()); // only the loader removes, front is still ours
+        }
+        if (!next) continue;
+        const LoadRequest& req = *next;
+
+        std::string error;
+        auto fresh = BuildModel(req.path, req.useCUDA, req.numThreads, &error);
+
+        std::shared_ptr<ModelInstance> old;
+        if (fresh) {
+            if (fresh->fixedInputWidth > 0) {
+                inputWidth = fresh->fixedInputWidth;
+                inputHeight = fresh->fixedInputHeight;
+            }
+            // swap, worker picks it up on its next frame
+            old = std::atomic_exchange(&model, fresh);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(loadMutex);
+            // a newer request came in meanwhile, stay in loading
+            if (!pendingLoad) {
+                loadStatus.state = fresh ? ModelLoadState::Ready : ModelLoadState::Failed;
+                loadStatus.path = req.path;
+                loadStatus.message = error;
+                loadStatus.loadMs = fresh ? fresh->loadMs : 0.0;
+                loadStatus.sessionMs = fresh ? fresh->sessionMs : 0.0;
+                loadStatus.fromCache = fresh && fresh->fromCache;
+                loadStatus.coldMs = fresh ? fresh->coldMs : -1.0;
+                loadStatus.head = fresh ? fresh->head : HeadInfo();
+                loadStatus.generation++;
+            }
+        }
+
+        // no waiting on the frame still using it, a newer request goes straight to the next build
+        if (old) retired.push_back(std::move(old));
+    }
+}
+
+HeadInfo TrashDetector::GetHeadInfo() const {
+    auto m = std::atomic_load(&model);
+    return m ? m->head : HeadInfo();
+}
+
+bool TrashDetector::IsFixedResolution() const {
+    auto m = std::atomic_load(&model);
+    return m && m->fixedInputWidth > 0 && m->fixedInputHeight > 0;
+}
+
+int TrashDetector::GetFixedResolution() const {
+    auto m = std::atomic_load(&model);
+    return m ? m->fixedInputWidth : -1;
 }
 
 bool TrashDetector::LoadLabels(const std::string& labelPath) {
-    customLabels.clear();
+    // a bad file falls back to the built in names like before
+    std::atomic_store(&labels, LabelTable::Default());
     std::ifstream file(labelPath);
     if (!file.is_open()) return false;
     
@@ -118,219 +446,217 @@ bool TrashDetector::LoadLabels(const std::string& labelPath) {
     // Simple regex to find "id": "name" pattern
     std::regex pattern(R"(\"(\d+)\"\s*:\s*\"([^\"]+)\")");
     std::smatch matches;
+    std::vector<std::string> names;
     
     std::string::const_iterator searchStart(content.cbegin());
     while (std::regex_search(searchStart, content.cend(), matches, pattern)) {
         int id = std::stoi(matches[1].str());
         std::string name = matches[2].str();
         
-        if (id >= customLabels.size()) {
-            customLabels.resize(id + 1);
+        if (id >= (int)names.size()) {
+            names.resize(id + 1);
         }
-        customLabels[id] = name;
+        names[id] = name;
         
         searchStart = matches.suffix().first;
     }
     
-    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    
-    // simple regex to find id name pattern
-    std::regex pattern(R"(\"(\d+)\"\s*:\s*\"([^\"]+)\")");
-    return !customLabels.empty();
-}
+    if (names.empty()) return false;
 
-std::string TrashDetector::GetLabel(int classId) {
-    if (!customLabels.empty()) {
-        if (classId >= 0 && classId < customLabels.size() && !customLabels[classId].empty()) {
-            return customLabels[classId];
-        }
-        return "Class " + std::to_string(classId);
-    }
+    // swapped in whole, the decoder may be reading the old one right now
+    std::atomic_store(&labels, LabelTable::FromNames(names));
+    return true;
+}
 
-    switch (classId) {
-        case 39: return "Bottle";
-        case 41: return "Cup";
-        case 45: return "Bowl";
-        case 44: return "Spoon";
-        case 0:  return "Person (Debug)"; 
-        default: return "Object " + std::to_string(classId);
-    }
+std::vector<Detection> TrashDetector::Detect(const cv::Mat& rawFrame, float confThreshold, float nmsThreshold) {
+    assert(pipelines.load() == 0 && "sync Detect while a pipeline runs on this detector");
+    std::vector<Detection> detections;
+    DetectJob job;
+    if (!PrepareWith(detectLetterbox, rawFrame, job)) return detections;
+    if (!Infer(job)) return detections;
+    DecodeWith(detectScratch, job, confThreshold, nmsThreshold, detections, 0, nullptr, 0.0f);
+    return detections;
 }
 
-bool TrashDetector::IsTrash(int classId) {
-    return true; 
+bool TrashDetector::Prepare(const cv::Mat& rawFrame, DetectJob& job) {
+    return PrepareWith(letterbox, rawFrame, job);
 }
 
-std::vector<Detection> TrashDetector::Detect(const cv::Mat& rawFrame, float confThreshold, float nmsThreshold) {
-    std::vector<Detection> detections;
-    if (!session) return detections; 
+bool TrashDetector::PrepareWith(LetterboxKernel& kernel, const cv::Mat& rawFrame, DetectJob& job) {
+    job.Release();
+
+    // hold our own ref for the whole frame, a swap mid frame cant free it
+    std::shared_ptr<ModelInstance> m = std::atomic_load(&model);
+    if (!m || rawFrame.empty()) return false;
 
-    // 1. Preprocessing letterbox
-    int originalW = rawFrame.cols;
-    int originalH = rawFrame.rows;
-    
-    // 1. preprocessing (letterbox)
     // fix ensure we use fixed res if model demands it
-    // user request removed enforcement user accepts crash risk for speed
-    int useW = inputWidth; 
-    int useH = inputHeight;
-    // int useW = (fixedInputWidth > 0) ? fixedInputWidth : inputWidth;
-    // int useH = (fixedInputHeight > 0) ? fixedInputHeight : inputHeight;
-    
-    // originalW/H already declared above
-    
-    float ratio = std::min((float)useW / originalW, (float)useH / originalH);
-    int newW = (int)(originalW * ratio);
-    int newH = (int)(originalH * ratio);
-    
-    cv::Mat resized;
-    cv::resize(rawFrame, resized, cv::Size(newW, newH));
-    
-    cv::Mat frame(useH, useW, CV_8UC3, cv::Scalar(114, 114, 114));
-    
-    int padX = (useW - newW) / 2;
-    int padY = (useH - newH) / 2;
+    // back on since models swap async, res and model could mismatch for a frame
+    int useW = (m->fixedInputWidth > 0) ? m->fixedInputWidth : inputWidth.load();
+    int useH = (m->fixedInputHeight > 0) ? m->fixedInputHeight : inputHeight.load();
     
-    resized.copyTo(frame(cv::Rect(padX, padY, newW, newH)));
-    
-    // optimized use blobfromimage for fast preprocessing simd
-    // resizes if needed but we already did letterbox
-    // swaps bgr rgb swaprb true
-    // normalizes 1/255
-    // chw layout
-    cv::Mat blob;
-    // Note: We use 'frame' which is the letterboxed image. 
-    // We already resized/padded it to useW/useH manually to keep aspect ratio.
-    // So we pass 'false' for crop.
-    cv::dnn::blobFromImage(frame, blob, 1.0/255.0, cv::Size(useW, useH), cv::Scalar(0,0,0), true, false);
-
-    // Blob is 1x3xHxW contiguous float buffer
-    size_t inputTensorSize = 1 * 3 * useH * useW;
-    std::vector<int64_t> inputShape = {1, 3, useH, useW};
-
-    auto memoryInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-    
-    // note we use frame which is letterboxed
-    // we already resized padded it to useW useH manually to keep aspect ratio
-    // so we pass false for crop
-    cv::dnn::blobFromImage(frame, blob, 1.0/255.0, cv::Size(useW, useH), cv::Scalar(0,0,0), true, false);
+    if (m->inputNodeNamesAllocated.empty() || m->outputNodeNamesAllocated.empty()) return false;
 
-    // blob is 1x3xhxw contiguous float buffer
-    Ort::Value inputTensor = Ort::Value::CreateTensor<float>(
-        memoryInfo, blob.ptr<float>(), inputTensorSize, inputShape.data(), inputShape.size()
-    );
+    try {
+        // bound buffers for this res, the previous res until the loader has this one warm
+        std::shared_ptr<BoundIo> io = FindBinding(m, useW, useH, 1);
+        if (!io) return false;
+        int slot = AcquireSlot(*m, *io);
+        if (slot < 0) return false; // everything in flight, caller drops the frame
 
-    if (inputNodeNamesAllocated.empty() || outputNodeNamesAllocated.empty()) return detections;
+        job.model = m;
+        job.io = io;
+        job.slot = slot;
+        job.count = 1;
+        job.items[0].frameW = rawFrame.cols;
+        job.items[0].frameH = rawFrame.rows;
+        job.inferred = false;
+
+        // fused letterbox straight into the bound input tensor
+        // resize pad bgr->rgb 1/255 and chw in one pass, see Preprocess.cpp
+        job.items[0].letterbox = kernel.Run(rawFrame, io->slots[slot].input.data(), io->width, io->height);
+        return true;
+    } catch (const Ort::Exception& e) {
+        std::cerr << "runtime error during bind " << e.what() << std::endl;
+        job.Release();
+        return false;
+    }
+}
+
+bool TrashDetector::PrepareBatch(const cv::Mat* const* frames, int count, DetectJob& job) {
+    job.Release();
+
+    std::shared_ptr<ModelInstance> m = std::atomic_load(&model);
+    if (!m || count <= 0) return false;
+    if (count == 1) return Prepare(*frames[0], job);
+    if (!m->dynamicBatch || count > kMaxBatch) return false;
+
+    int useW = (m->fixedInputWidth > 0) ? m->fixedInputWidth : inputWidth.load();
+    int useH = (m->fixedInputHeight > 0) ? m->fixedInputHeight : inputHeight.load();
 
-    const char* const* inputNames = inputNodeNamesAllocated.data();
-    const char* const* outputNames = outputNodeNamesAllocated.data();
-    
     try {
-        auto outputTensors = session->Run(Ort::RunOptions{nullptr}, inputNames, &inputTensor, 1, outputNames, 1);
-        
-        float* floatData = outputTensors.front().GetTensorMutableData<float>();
-        auto typeInfo = outputTensors.front().GetTensorTypeAndShapeInfo();
-        auto shape = typeInfo.GetShape();
-        
-        int channelsNum = 0;
-        int anchorsNum = 0;
-        
-        if (shape.size() == 3) {
-             channelsNum = (int)shape[1];
-             anchorsNum = (int)shape[2];
-        } else {
-             std::cerr << "unexpected output shape size " << shape.size() << std::endl;
-             return detections;
-        }
+        // one binding per batch size, a partial batch never pays for empty items
+        // a new batch size fails until the loader has bound it, the caller runs the frames one by one meanwhile
+        std::shared_ptr<BoundIo> io = FindBinding(m, useW, useH, count);
+        if (!io) return false;
+        int slot = AcquireSlot(*m, *io);
+        if (slot < 0) return false;
 
-        static bool shapeLogged = false;
-        if (!shapeLogged) {
-            // std::cout << "[DEBUG] Output Shape: [" << shape[0] << ", " << shape[1] << ", " << shape[2] << "]" << std::endl;
-            shapeLogged = true;
-        }
+        job.model = m;
+        job.io = io;
+        job.slot = slot;
+        job.count = count;
+        job.inferred = false;
 
-        int classesNum = channelsNum - 4;
-        
-        std::vector<int> classIds;
-        std::vector<float> confidences;
-        std::vector<cv::Rect> boxes;
-        
-        for (int i = 0; i < anchorsNum; i++) {
-            float maxScore = -1.0f;
-            int maxClassId = -1;
-            
-            for (int c = 0; c < classesNum; c++) {
-                float score = floatData[(4 + c) * anchorsNum + i];
-                if (score > maxScore) {
-                    maxScore = score;
-                    maxClassId = c;
-                }
-            }
-            
-            if (maxScore > confThreshold) {
-                if (!IsTrash(maxClassId)) continue;
-                
-                float cx = floatData[0 * anchorsNum + i];
-                float cy = floatData[1 * anchorsNum + i];
-                float w = floatData[2 * anchorsNum + i];
-                float h = floatData[3 * anchorsNum + i];
-                
-                bool isNormalized = (w < 1.0f && h < 1.0f && cx < 1.0f && cy < 1.0f);
-                if (isNormalized) {
-                    cx *= useW;
-                    cy *= useH;
-                    w *= useW;
-                    h *= useH;
-                }
-                
-                static bool rawLogged = false;
-                if (!rawLogged) {
-                    // std::cout << "[DEBUG] Raw Detection: " << cx << "," << cy << " " << w << "x" << h 
-                    //           << " (Norm: " << (isNormalized ? "Yes" : "No") << ")" << std::endl;
-                    rawLogged = true;
-                }
-                
-                float x = cx - w / 2.0f;
-                float y = cy - h / 2.0f;
-                
-                float x_original = (x - padX) / ratio;
-                float y_original = (y - padY) / ratio;
-                float w_original = w / ratio;
-                float h_original = h / ratio;
-                
-                int left = std::max(0, std::min((int)x_original, originalW));
-                int top = std::max(0, std::min((int)y_original, originalH));
-                int width = std::min((int)w_original, originalW - left);
-                int height = std::min((int)h_original, originalH - top);
-                
-                boxes.push_back(cv::Rect(left, top, width, height));
-                confidences.push_back(maxScore);
-                classIds.push_back(maxClassId);
-            }
-        }
-        
-        std::vector<int> indices;
-        cv::dnn::NMSBoxes(boxes, confidences, confThreshold, nmsThreshold, indices);
-        
-        for (int idx : indices) {
-            Detection det;
-            det.box = boxes[idx];
-            det.confidence = confidences[idx];
-            det.classId = classIds[idx];
-            det.label = GetLabel(det.classId);
-            detections.push_back(det);
-            
-            /*
-            std::cout << "[DETECT] Found: " << det.label 
-                      << " (ID: " << det.classId << ") " 
-                      << " | Conf: " << (int)(det.confidence * 100) << "%" 
-                      << " | Box: [" << det.box.x << "," << det.box.y << "]" 
-                      << std::endl;
-            */
+        const size_t itemSize = (size_t)3 * io->width * io->height;
+        float* input = io->slots[slot].input.data();
+        for (int i = 0; i < count; i++) {
+            job.items[i].frameW = frames[i]->cols;
+            job.items[i].frameH = frames[i]->rows;
+            job.items[i].letterbox = letterbox.Run(*frames[i], input + i * itemSize, io->width, io->height);
         }
+        return true;
+    } catch (const Ort::Exception& e) {
+        std::cerr << "runtime error during batch bind " << e.what() << std::endl;
+        job.Release();
+        return false;
+    }
+}
+
+int TrashDetector::GetMaxBatch() const {
+    auto m = std::atomic_load(&model);
+    return (m && m->dynamicBatch) ? kMaxBatch : 1;
+}
+
+bool TrashDetector::Infer(DetectJob& job) {
+    if (!job.Valid()) return false;
+    try {
+        TRACE_SCOPE("session_run");
+        job.model->session->Run(runOptions, *job.io->slots[job.slot].binding);
+        job.inferred = true;
+        return true;
     } catch (const Ort::Exception& e) {
         std::cerr << "runtime error during detect " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void TrashDetector::Decode(const DetectJob& job, float confThreshold, float nmsThreshold, std::vector<Detection>& detections, int item,
+                          std::vector<Detection>* lowOut, float lowThreshold) {
+    DecodeWith(decodeScratch, job, confThreshold, nmsThreshold, detections, item, lowOut, lowThreshold);
+}
+
+void TrashDetector::DecodeWith(DecodeScratch& scratch, const DetectJob& job, float confThreshold, float nmsThreshold,
+                               std::vector<Detection>& detections, int item, std::vector<Detection>* lowOut, float lowThreshold) {
+    if (!job.Valid() || !job.inferred || item < 0 || item >= job.count) return;
+
+    const BoundIo& io = *job.io;
+    const float* floatData = io.slots[job.slot].output.data() + item * io.outputPerItem;
+    const DetectJob::Item& frame = job.items[item];
+    const HeadInfo& head = io.head;
+    if (!io.decode) return;
+
+    // low boxes go through decode and nms with the rest, a strong box still suppresses a weak one on top of it
+    const bool splitLow = lowOut && lowThreshold < confThreshold;
+    const float decodeThreshold = splitLow ? lowThreshold : confThreshold;
+
+    // layout specialized decoder, see YoloDecoder.cpp
+    DecodeParams params;
+    params.confThreshold = decodeThreshold;
+    params.inputW = io.width;
+    params.inputH = io.height;
+    params.frameW = frame.frameW;
+    params.frameH = frame.frameH;
+    params.letterbox = frame.letterbox;
+    {
+        TRACE_SCOPE("decode");
+        io.decode(floatData, head.classes, head.anchors, params, scratch.candidates);
+    }
+
+    // class aware nms with capped candidates, see BoxNms.cpp
+    // end to end heads already did it inside the model
+    if (head.needsNms) {
+        TRACE_SCOPE("nms");
+        // the engine's copy is Decode only, the shared one is never written from here
+        scratch.nms.config = *std::atomic_load(&nmsConfig);
+        scratch.nms.config.iouThreshold = nmsThreshold;
+        scratch.nms.config.softScoreThreshold = decodeThreshold;
+        scratch.nms.Run(scratch.candidates, scratch.keepIdx, scratch.keepScores);
+    } else {
+        scratch.keepIdx.resize(scratch.candidates.Size());
+        scratch.keepScores.resize(scratch.candidates.Size());
+        for (size_t i = 0; i < scratch.candidates.Size(); i++) {
+            scratch.keepIdx[i] = (int)i;
+            scratch.keepScores[i] = scratch.candidates.score[i];
+        }
     }
     
-    return detections;
+    std::shared_ptr<const LabelTable> names = std::atomic_load(&labels);
+    size_t first = detections.size();
+    AppendDetections(scratch.candidates, scratch.keepIdx, scratch.keepScores, *names, detections);
+
+    if (splitLow) {
+        // compact the strong ones in place, weak ones move over, order kept on both sides
+        size_t kept = first;
+        for (size_t i = first; i < detections.size(); i++) {
+            if (detections[i].confidence >= confThreshold) detections[kept++] = detections[i];
+            else lowOut->push_back(detections[i]);
+        }
+        detections.resize(kept);
+    }
+}
+
+void AppendDetections(const CandidateBoxes& candidates, const std::vector<int>& keepIdx, const std::vector<float>& keepScores,
+                      const LabelTable& labels, std::vector<Detection>& out) {
+    for (size_t k = 0; k < keepIdx.size(); k++) {
+        int idx = keepIdx[k];
+
+        Detection det;
+        det.box = cv::Rect2f(candidates.x1[idx], candidates.y1[idx],
+                             candidates.x2[idx] - candidates.x1[idx],
+                             candidates.y2[idx] - candidates.y1[idx]);
+        det.confidence = keepScores[k];
+        det.classId = candidates.classId[idx];
+        det.label = labels.Name(det.classId); // pointer into the table, no string built
+        out.push_back(det);
+    }
 }
@@ -2,70 +2,284 @@
 
 #include <opencv2/opencv.hpp>
 #include <onnxruntime_cxx_api.h>
+#include "Preprocess.hpp"
+#include "YoloDecoder.hpp"
+#include "BoxNms.hpp"
+#include "ModelCache.hpp"
+#include "LabelTable.hpp"
 #include <vector>
 #include <string>
 #include <optional>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <type_traits>
 
 // detection struct for data
+// plain data so copying a frame of them is a memcpy and never allocates
 struct Detection {
-    cv::Rect box;
-    float confidence;
-    int classId;
-    std::string label;
+    cv::Rect2f box;            // frame pixels, float so smoothing doesnt round every frame
+    float confidence = 0.0f;
+    int classId = -1;
+    const char* label = "";    // interned in LabelTable, valid for the whole process
     
     // new sub pixel smooth
     cv::Rect2f smoothBox; 
     
     // prediction data
     cv::Point2f velocity = {0,0};
+    cv::Point2f acceleration = {0,0}; // px/s^2, from the track filter
     int trackingId = -1;       // unique id for track
     int persistenceFrames = 0; // frames to keep alive lost
 };
+static_assert(std::is_trivially_copyable<Detection>::value, "Detection has to stay plain data");
+
+// kept boxes from nms -> detections, appends to out
+void AppendDetections(const CandidateBoxes& candidates, const std::vector<int>& keepIdx, const std::vector<float>& keepScores,
+                      const LabelTable& labels, std::vector<Detection>& out);
+
+// one set of tensors + binding, a frame in flight owns one slot
+struct IoSlot {
+    std::vector<float> input;
+    std::vector<float> output;
+    Ort::Value inputTensor{nullptr};
+    Ort::Value outputTensor{nullptr};
+    std::unique_ptr<Ort::IoBinding> binding;
+    std::atomic<bool> busy{false};
+};
+
+// preprocess + infer + decode + one waiting in a queue
+const int kIoSlots = 4;
+
+// most frames one batched run takes, models need a dynamic batch dim for more than 1
+const int kMaxBatch = 8;
+
+// input output tensors bound once per model + resolution
+// steady state run just reuses them, no allocs
+// slots get their buffers on first use, sync Detect only ever needs slot 0
+struct BoundIo {
+    int width = 0;
+    int height = 0;
+    int batch = 1;              // input is [batch, 3, h, w]
+    size_t outputPerItem = 0;   // floats of output per batch item
+    std::vector<int64_t> outputShape;
+    HeadInfo head;              // layout found from outputShape
+    DecodeFn decode = nullptr;  // specialized for layout + classes
+    IoSlot slots[kIoSlots];
+};
+
+// everything tied to one loaded model, built off thread and swapped in as a whole
+struct ModelInstance {
+    std::string path;
+    std::unique_ptr<Ort::Session> session;
+
+    // dynamic io names
+    std::vector<std::string> inputNodeNames;
+    std::vector<std::string> outputNodeNames;
+    std::vector<const char*> inputNodeNamesAllocated;
+    std::vector<const char*> outputNodeNamesAllocated;
+
+    int fixedInputWidth = -1; // if > 0 overrides inputWidth
+    int fixedInputHeight = -1;
+    bool dynamicBatch = false;  // input dim 0 is free so frames can be batched
+    bool fromCache = false;  // session came from the optimized graph cache
+    double sessionMs = 0.0;  // session creation time, cold or cached
+    double loadMs = 0.0;     // whole build, session + first binding + warm up
+    double coldMs = -1.0;    // cached start only, what the cold build took, < 0 if unknown
+    int threads = 0;         // intra op threads it was built with
+    HeadInfo head; // from the first binding, gui reads this so it never touches boundIo
+
+    // few resolutions cached so switching res doesnt rebind every time
+    // declared after session so it dies first, shared so a job keeps its binding if it gets evicted
+    // pipeline threads look bindings up while the loader adds new ones, both under bindMutex
+    std::mutex bindMutex;
+    std::vector<std::shared_ptr<BoundIo>> boundIo;
+};
+
+// one frame between Prepare, Infer and Decode
+// holds its model and binding alive and owns one io slot until destroyed, move only
+class DetectJob {
+public:
+    DetectJob() = default;
+    ~DetectJob() { Release(); }
+    DetectJob(DetectJob&& other) noexcept { *this = std::move(other); }
+    DetectJob& operator=(DetectJob&& other) noexcept;
+    DetectJob(const DetectJob&) = delete;
+    DetectJob& operator=(const DetectJob&) = delete;
+
+    bool Valid() const { return io && slot >= 0; }
+    void Release();
+
+    // per frame in the batch, count is 1 outside batching
+    struct Item {
+        int frameW = 0;
+        int frameH = 0;
+        LetterboxInfo letterbox;
+    };
+
+    // model before io so the binding dies before its session
+    std::shared_ptr<ModelInstance> model;
+    std::shared_ptr<BoundIo> io;
+    int slot = -1;
+    int count = 0;
+    Item items[kMaxBatch];
+    bool inferred = false;
+};
+
+// decoder output + nms buffers reused every frame, one set per thread that decodes
+struct DecodeScratch {
+    CandidateBoxes candidates;
+    NmsEngine nms;
+    std::vector<int> keepIdx;
+    std::vector<float> keepScores;
+};
+
+// load progress for the gui, sync LoadModel fills it too so headless tools can log it
+enum class ModelLoadState { Idle, Loading, Ready, Failed };
+
+struct ModelLoadStatus {
+    ModelLoadState state = ModelLoadState::Idle;
+    std::string path;
+    std::string message;
+    double loadMs = 0.0;    // whole load, session + first binding + warm up, same on the sync and async path
+    double sessionMs = 0.0; // session creation only, what coldMs is comparable to
+    bool fromCache = false;
+    double coldMs = -1.0;   // cached start only, session creation of the cold build, < 0 if unknown
+    HeadInfo head;
+    int generation = 0; // bumps on every finished load so the gui can spot changes
+};
 
 // handling loading of onnx model
 class TrashDetector {
 public:
     TrashDetector();
+    ~TrashDetector();
     
     // load new model from disk return true if success
+    // blocks, use LoadModelAsync from the gui thread
     bool LoadModel(const std::string& modelPath, bool useCUDA = false, int numThreads = 4, std::string* errorMsg = nullptr);
+
+    // build + warm up on a background thread, swapped in between frames when ready
+    // a newer request replaces one that hasnt started yet
+    void LoadModelAsync(const std::string& modelPath, bool useCUDA = false, int numThreads = 4);
+    ModelLoadStatus GetLoadStatus() const;
+
+    // swapped in whole, safe while the pipeline runs
     bool LoadLabels(const std::string& labelPath);
-    bool IsLoaded() const { return session != nullptr; }
+    const char* GetLabel(int classId) const { return std::atomic_load(&labels)->Name(classId); }
+    bool IsLoaded() const { return std::atomic_load(&model) != nullptr; }
     
-    // detect on image
+    // detect on image, Prepare + Infer + Decode in one go
+    // own scratch so it never shares buffers with the stages, still only between pipeline runs and from one thread
     std::vector<Detection> Detect(const cv::Mat& frame, float confThreshold = 0.5f, float nmsThreshold = 0.45f);
 
+    // same split in stages so a pipeline can run them on different threads
+    // each stage must stay on one thread, different stages may run at the same time on different jobs
+    // letterbox into a free io slot of the current model, false if no model or all slots busy
+    bool Prepare(const cv::Mat& frame, DetectJob& job);
+    // several frames into one [count, 3, h, w] input, count <= GetMaxBatch()
+    bool PrepareBatch(const cv::Mat* const* frames, int count, DetectJob& job);
+    // session run on the job's slot
+    bool Infer(DetectJob& job);
+    // decode + nms + labels for one item of the job, appends to out
+    // with lowOut set boxes scoring in [lowThreshold, confThreshold) go there after the same nms, for the tracker
+    void Decode(const DetectJob& job, float confThreshold, float nmsThreshold, std::vector<Detection>& out, int item = 0,
+                std::vector<Detection>* lowOut = nullptr, float lowThreshold = 0.1f);
+
+    // frames one run can take, 1 unless the model has a dynamic batch dim
+    int GetMaxBatch() const;
+
+    // pipelines hold this while their stage threads run, Detect asserts nobody does
+    void AttachPipeline() { pipelines++; }
+    void DetachPipeline() { pipelines--; }
+
     // new dynamic res for performance
+    // a size without a binding yet gets bound and warmed on the loader thread, frames keep the old size until then
     void SetInputResolution(int size) {
         inputWidth = size;
         inputHeight = size;
     }
+    // binds and warms the current size now on the calling thread, for tools that time the frames right after a change
+    bool WarmInputResolution(int batch = 1);
     
+    // output layout of current model, unknown until loaded
+    HeadInfo GetHeadInfo() const;
+    // force a layout when the shape guess is wrong (transposed v8 export), next LoadModel applies it
+    void SetHeadLayoutOverride(HeadLayout layout) { forceHeadLayout = layout; }
+
+    // nms mode class aware caps etc, iou and the soft floor come from the Decode args
+    // swapped in whole like the labels, Decode takes a copy per frame so the gui can set it while the pipeline runs
+    NmsConfig GetNmsConfig() const { return *std::atomic_load(&nmsConfig); }
+    void SetNmsConfig(const NmsConfig& config) { std::atomic_store(&nmsConfig, std::make_shared<const NmsConfig>(config)); }
+
+    // optimized graph cache, on by default
+    ModelCache& GetModelCache() { return modelCache; }
+
     // check if model forces res
-    bool IsFixedResolution() const { return fixedInputWidth > 0 && fixedInputHeight > 0; }
-    int GetFixedResolution() const { return fixedInputWidth; }
+    bool IsFixedResolution() const;
+    int GetFixedResolution() const;
 
 private:
     // ort resources
     Ort::Env env;
-    std::unique_ptr<Ort::Session> session;
-    
-    // dynamic io names
-    std::vector<std::string> inputNodeNames;
-    std::vector<std::string> outputNodeNames;
-    std::vector<const char*> inputNodeNamesAllocated;
-    std::vector<const char*> outputNodeNamesAllocated;
+    Ort::MemoryInfo memoryInfo{nullptr};
+    Ort::RunOptions runOptions;
+
+    // current model, readers take a copy with atomic_load so a swap never frees it under them
+    std::shared_ptr<ModelInstance> model;
+    ModelCache modelCache;
+
+    std::shared_ptr<ModelInstance> BuildModel(const std::string& modelPath, bool useCUDA, int numThreads, std::string* errorMsg);
+    // builds + warms a binding on the calling thread if there is none yet, loader thread or before the model is published
+    std::shared_ptr<BoundIo> GetBinding(ModelInstance& m, int width, int height, int batch = 1);
+    // Prepare side, never builds: exact match, else the newest binding of that batch size while the loader builds the new one
+    std::shared_ptr<BoundIo> FindBinding(const std::shared_ptr<ModelInstance>& m, int width, int height, int batch);
+    void BindSlot(ModelInstance& m, const BoundIo& io, IoSlot& slot);
+    int AcquireSlot(ModelInstance& m, BoundIo& io);
+    bool PrepareWith(LetterboxKernel& kernel, const cv::Mat& frame, DetectJob& job);
+    void DecodeWith(DecodeScratch& scratch, const DetectJob& job, float confThreshold, float nmsThreshold, std::vector<Detection>& out,
+                    int item, std::vector<Detection>* lowOut, float lowThreshold);
 
-    int inputWidth = 640; // fix default 640 accuracy
-    int inputHeight = 640;
+    // background loader
+    struct LoadRequest {
+        std::string path;
+        bool useCUDA = false;
+        int numThreads = 4;
+    };
+    // binding a frame asked for, stays queued until built so repeats dont queue it twice
+    struct BindRequest {
+        std::weak_ptr<ModelInstance> model;
+        int width = 0;
+        int height = 0;
+        int batch = 1;
+    };
+    void LoaderLoop();
+    std::thread loaderThread;
+    mutable std::mutex loadMutex;
+    std::condition_variable loadCv;
+    std::optional<LoadRequest> pendingLoad;
+    std::vector<BindRequest> pendingBinds;
+    ModelLoadStatus loadStatus;
+    bool stopLoader = false;
+    // swapped out models, loader thread only, freed there once the last job holding one is done
+    std::vector<std::shared_ptr<ModelInstance>> retired;
+
+    std::atomic<int> inputWidth = 640; // fix default 640 accuracy
+    std::atomic<int> inputHeight = 640;
     
-    int fixedInputWidth = -1; // if > 0 overrides inputWidth
-    int fixedInputHeight = -1;
+    HeadLayout forceHeadLayout = HeadLayout::Unknown;
     
-    // custom labels
-    std::vector<std::string> customLabels;
+    // preprocessing writes straight into the bound input, Prepare only
+    LetterboxKernel letterbox;
+    DecodeScratch decodeScratch; // Decode only
+    // sync Detect only
+    LetterboxKernel detectLetterbox;
+    DecodeScratch detectScratch;
+    std::atomic<int> pipelines{0};
 
-    // help functs
-    std::string GetLabel(int classId);
-    bool IsTrash(int classId);
+    // class names, readers atomic_load it like the model
+    std::shared_ptr<const LabelTable> labels = LabelTable::Default();
+    std::shared_ptr<const NmsConfig> nmsConfig = std::make_shared<const NmsConfig>();
 };
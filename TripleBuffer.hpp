@@ -0,0 +1,35 @@
+#pragma once
+
+#include <atomic>
+
+// one writer one reader handoff, neither side ever waits
+// writer fills Back() and publishes, reader Fetch()es the newest and reads Front()
+// three copies so the writer always has one the reader isnt looking at
+template <typename T>
+class TripleBuffer {
+public:
+    // writer side, whatever was in here before is stale, overwrite all of it
+    T& Back() { return buffers[backIndex]; }
+
+    void Publish() {
+        backIndex = middle.exchange(backIndex | kFresh, std::memory_order_acq_rel) & kIndexMask;
+    }
+
+    // reader side, true if Front() changed
+    bool Fetch() {
+        if (!(middle.load(std::memory_order_relaxed) & kFresh)) return false;
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & kIndexMask;
+        return true;
+    }
+
+    const T& Front() const { return buffers[frontIndex]; }
+
+private:
+    static const int kIndexMask = 3;
+    static const int kFresh = 4; // middle holds something the reader hasnt seen
+
+    T buffers[3];
+    int backIndex = 0;                 // writer only
+    alignas(64) std::atomic<int> middle{1};
+    alignas(64) int frontIndex = 2;    // reader only
+};
@@ -0,0 +1,308 @@
+#include "YoloDecoder.hpp"
+#include <algorithm>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define DECODER_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define DECODER_SSE2 1
+#endif
+
+void CandidateBoxes::Reserve(size_t n) {
+    if (n <= x1.size()) return;
+    x1.resize(n); y1.resize(n);
+    x2.resize(n); y2.resize(n);
+    score.resize(n);
+    classId.resize(n);
+}
+
+namespace {
+
+// x1 y1 x2 y2 in input space -> clipped frame space
+inline void PushCorners(float x1, float y1, float x2, float y2, float s, int cls, const DecodeParams& p, CandidateBoxes& out) {
+    const LetterboxInfo& lb = p.letterbox;
+    float invRatio = 1.0f / lb.ratio;
+    x1 = (x1 - lb.padX) * invRatio;
+    y1 = (y1 - lb.padY) * invRatio;
+    x2 = (x2 - lb.padX) * invRatio;
+    y2 = (y2 - lb.padY) * invRatio;
+
+    x1 = std::clamp(x1, 0.0f, (float)p.frameW);
+    y1 = std::clamp(y1, 0.0f, (float)p.frameH);
+    x2 = std::clamp(x2, x1, (float)p.frameW);
+    y2 = std::clamp(y2, y1, (float)p.frameH);
+
+    out.Push(x1, y1, x2, y2, s, cls);
+}
+
+inline void PushCenter(float cx, float cy, float w, float h, float s, int cls, const DecodeParams& p, CandidateBoxes& out) {
+    // some exports give 0..1 coords
+    bool isNormalized = (w < 1.0f && h < 1.0f && cx < 1.0f && cy < 1.0f);
+    if (isNormalized) {
+        cx *= p.inputW;
+        cy *= p.inputH;
+        w *= p.inputW;
+        h *= p.inputH;
+    }
+    PushCorners(cx - w * 0.5f, cy - h * 0.5f, cx + w * 0.5f, cy + h * 0.5f, s, cls, p, out);
+}
+
+// channels first keeps box rows apart
+inline void PushBox(const float* data, int anchors, int i, float s, int cls, const DecodeParams& p, CandidateBoxes& out) {
+    PushCenter(data[0 * anchors + i], data[1 * anchors + i], data[2 * anchors + i], data[3 * anchors + i], s, cls, p, out);
+}
+
+// plain loop for block tails and non simd builds
+template <int kClasses>
+void DecodeScalar(const float* data, int classesRt, int anchors, int begin, int end, const DecodeParams& p, CandidateBoxes& out) {
+    const int classes = kClasses > 0 ? kClasses : classesRt;
+    for (int i = begin; i < end; i++) {
+        float maxScore = data[4 * anchors + i];
+        int maxClass = 0;
+        for (int c = 1; c < classes; c++) {
+            float s = data[(4 + c) * anchors + i];
+            if (s > maxScore) { maxScore = s; maxClass = c; }
+        }
+        if (maxScore > p.confThreshold) PushBox(data, anchors, i, maxScore, maxClass, p, out);
+    }
+}
+
+// kClasses > 0 bakes the class count in so the class loop unrolls, 0 is the generic one
+template <int kClasses>
+void DecodeChannelsFirstT(const float* data, int classesRt, int anchors, const DecodeParams& p, CandidateBoxes& out) {
+    const int classes = kClasses > 0 ? kClasses : classesRt;
+    out.Clear();
+    if (classes <= 0 || anchors <= 0) return;
+
+    const float* scores = data + 4 * (size_t)anchors;
+    int i = 0;
+
+#if defined(DECODER_AVX2)
+    // 32 anchors per block, 4 max + 4 argmax registers
+    const __m256 conf = _mm256_set1_ps(p.confThreshold);
+    for (; i + 32 <= anchors; i += 32) {
+        const float* row = scores + i;
+        __m256 m0 = _mm256_loadu_ps(row);
+        __m256 m1 = _mm256_loadu_ps(row + 8);
+        __m256 m2 = _mm256_loadu_ps(row + 16);
+        __m256 m3 = _mm256_loadu_ps(row + 24);
+        __m256i a0 = _mm256_setzero_si256(), a1 = a0, a2 = a0, a3 = a0;
+
+        for (int c = 1; c < classes; c++) {
+            row += anchors;
+            __m256i cls = _mm256_set1_epi32(c);
+            __m256 v0 = _mm256_loadu_ps(row);
+            __m256 v1 = _mm256_loadu_ps(row + 8);
+            __m256 v2 = _mm256_loadu_ps(row + 16);
+            __m256 v3 = _mm256_loadu_ps(row + 24);
+            __m256 g0 = _mm256_cmp_ps(v0, m0, _CMP_GT_OQ);
+            __m256 g1 = _mm256_cmp_ps(v1, m1, _CMP_GT_OQ);
+            __m256 g2 = _mm256_cmp_ps(v2, m2, _CMP_GT_OQ);
+            __m256 g3 = _mm256_cmp_ps(v3, m3, _CMP_GT_OQ);
+            m0 = _mm256_blendv_ps(m0, v0, g0);
+            m1 = _mm256_blendv_ps(m1, v1, g1);
+            m2 = _mm256_blendv_ps(m2, v2, g2);
+            m3 = _mm256_blendv_ps(m3, v3, g3);
+            a0 = _mm256_blendv_epi8(a0, cls, _mm256_castps_si256(g0));
+            a1 = _mm256_blendv_epi8(a1, cls, _mm256_castps_si256(g1));
+            a2 = _mm256_blendv_epi8(a2, cls, _mm256_castps_si256(g2));
+            a3 = _mm256_blendv_epi8(a3, cls, _mm256_castps_si256(g3));
+        }
+
+        // early reject, most blocks have nothing over threshold
+        unsigned hits = (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(m0, conf, _CMP_GT_OQ))
+                      | ((unsigned)_mm256_movemask_ps(_mm256_cmp_ps(m1, conf, _CMP_GT_OQ)) << 8)
+                      | ((unsigned)_mm256_movemask_ps(_mm256_cmp_ps(m2, conf, _CMP_GT_OQ)) << 16)
+                      | ((unsigned)_mm256_movemask_ps(_mm256_cmp_ps(m3, conf, _CMP_GT_OQ)) << 24);
+        if (!hits) continue;
+
+        alignas(32) float maxs[32];
+        alignas(32) int args[32];
+        _mm256_store_ps(maxs, m0); _mm256_store_ps(maxs + 8, m1);
+        _mm256_store_ps(maxs + 16, m2); _mm256_store_ps(maxs + 24, m3);
+        _mm256_store_si256((__m256i*)args, a0); _mm256_store_si256((__m256i*)(args + 8), a1);
+        _mm256_store_si256((__m256i*)(args + 16), a2); _mm256_store_si256((__m256i*)(args + 24), a3);
+        for (int k = 0; k < 32; k++) {
+            if (hits & (1u << k)) PushBox(data, anchors, i + k, maxs[k], args[k], p, out);
+        }
+    }
+#elif defined(DECODER_SSE2)
+    // 16 anchors per block, no blendv in sse2 so and/andnot/or
+    const __m128 conf = _mm_set1_ps(p.confThreshold);
+    for (; i + 16 <= anchors; i += 16) {
+        const float* row = scores + i;
+        __m128 m0 = _mm_loadu_ps(row);
+        __m128 m1 = _mm_loadu_ps(row + 4);
+        __m128 m2 = _mm_loadu_ps(row + 8);
+        __m128 m3 = _mm_loadu_ps(row + 12);
+        __m128i a0 = _mm_setzero_si128(), a1 = a0, a2 = a0, a3 = a0;
+
+        for (int c = 1; c < classes; c++) {
+            row += anchors;
+            __m128i cls = _mm_set1_epi32(c);
+            __m128 v0 = _mm_loadu_ps(row);
+            __m128 v1 = _mm_loadu_ps(row + 4);
+            __m128 v2 = _mm_loadu_ps(row + 8);
+            __m128 v3 = _mm_loadu_ps(row + 12);
+            __m128 g0 = _mm_cmpgt_ps(v0, m0);
+            __m128 g1 = _mm_cmpgt_ps(v1, m1);
+            __m128 g2 = _mm_cmpgt_ps(v2, m2);
+            __m128 g3 = _mm_cmpgt_ps(v3, m3);
+            m0 = _mm_max_ps(m0, v0);
+            m1 = _mm_max_ps(m1, v1);
+            m2 = _mm_max_ps(m2, v2);
+            m3 = _mm_max_ps(m3, v3);
+            __m128i i0 = _mm_castps_si128(g0), i1 = _mm_castps_si128(g1);
+            __m128i i2 = _mm_castps_si128(g2), i3 = _mm_castps_si128(g3);
+            a0 = _mm_or_si128(_mm_and_si128(i0, cls), _mm_andnot_si128(i0, a0));
+            a1 = _mm_or_si128(_mm_and_si128(i1, cls), _mm_andnot_si128(i1, a1));
+            a2 = _mm_or_si128(_mm_and_si128(i2, cls), _mm_andnot_si128(i2, a2));
+            a3 = _mm_or_si128(_mm_and_si128(i3, cls), _mm_andnot_si128(i3, a3));
+        }
+
+        unsigned hits = (unsigned)_mm_movemask_ps(_mm_cmpgt_ps(m0, conf))
+                      | ((unsigned)_mm_movemask_ps(_mm_cmpgt_ps(m1, conf)) << 4)
+                      | ((unsigned)_mm_movemask_ps(_mm_cmpgt_ps(m2, conf)) << 8)
+                      | ((unsigned)_mm_movemask_ps(_mm_cmpgt_ps(m3, conf)) << 12);
+        if (!hits) continue;
+
+        alignas(16) float maxs[16];
+        alignas(16) int args[16];
+        _mm_store_ps(maxs, m0); _mm_store_ps(maxs + 4, m1);
+        _mm_store_ps(maxs + 8, m2); _mm_store_ps(maxs + 12, m3);
+        _mm_store_si128((__m128i*)args, a0); _mm_store_si128((__m128i*)(args + 4), a1);
+        _mm_store_si128((__m128i*)(args + 8), a2); _mm_store_si128((__m128i*)(args + 12), a3);
+        for (int k = 0; k < 16; k++) {
+            if (hits & (1u << k)) PushBox(data, anchors, i + k, maxs[k], args[k], p, out);
+        }
+    }
+#endif
+
+    DecodeScalar<kClasses>(data, classes, anchors, i, anchors, p, out);
+}
+
+template <int kClasses>
+void DecodeAnchorsFirstT(const float* data, int classesRt, int anchors, const DecodeParams& p, CandidateBoxes& out) {
+    const int classes = kClasses > 0 ? kClasses : classesRt;
+    const int stride = 5 + classes;
+    const float conf = p.confThreshold;
+    out.Clear();
+
+    const float* row = data;
+    for (int i = 0; i < anchors; i++, row += stride) {
+        // score is obj * class and class <= 1 so low obj can never pass
+        float obj = row[4];
+        if (obj <= conf) continue;
+
+        // rows are contiguous here, select instead of branch
+        const float* cls = row + 5;
+        float maxScore = cls[0];
+        int maxClass = 0;
+        for (int c = 1; c < classes; c++) {
+            bool greater = cls[c] > maxScore;
+            maxScore = greater ? cls[c] : maxScore;
+            maxClass = greater ? c : maxClass;
+        }
+
+        float s = obj * maxScore;
+        if (s > conf) PushCenter(row[0], row[1], row[2], row[3], s, maxClass, p, out);
+    }
+}
+
+} // namespace
+
+void DecodeChannelsFirst(const float* data, int classes, int anchors, const DecodeParams& p, CandidateBoxes& out) {
+    DecodeChannelsFirstT<0>(data, classes, anchors, p, out);
+}
+
+void DecodeAnchorsFirst(const float* data, int classes, int anchors, const DecodeParams& p, CandidateBoxes& out) {
+    DecodeAnchorsFirstT<0>(data, classes, anchors, p, out);
+}
+
+void DecodeEndToEnd(const float* data, int classes, int anchors, const DecodeParams& p, CandidateBoxes& out) {
+    out.Clear();
+    const float* row = data;
+    for (int i = 0; i < anchors; i++, row += 6) {
+        float s = row[4];
+        if (s <= p.confThreshold) continue;
+        int cls = (int)row[5];
+        if (cls < 0 || (classes > 0 && cls >= classes)) continue;
+
+        float x1 = row[0], y1 = row[1], x2 = row[2], y2 = row[3];
+        if (x2 <= 1.0f && y2 <= 1.0f) { // normalized export
+            x1 *= p.inputW; x2 *= p.inputW;
+            y1 *= p.inputH; y2 *= p.inputH;
+        }
+        PushCorners(x1, y1, x2, y2, s, cls, p, out);
+    }
+}
+
+HeadInfo DetectHeadLayout(const std::vector<int64_t>& shape, HeadLayout force) {
+    HeadInfo head;
+    if (shape.size() != 3 || shape[1] <= 0 || shape[2] <= 0) return head;
+
+    int a = (int)shape[1];
+    int b = (int)shape[2];
+
+    HeadLayout layout = force;
+    if (layout == HeadLayout::Unknown) {
+        if (a < b) layout = HeadLayout::ChannelsFirst;
+        // single class v5 is also [1, N, 6], end to end K is max_det (300) so go by size
+        else if (b == 6 && a <= 1000) layout = HeadLayout::EndToEnd;
+        else layout = HeadLayout::AnchorsFirst;
+    }
+
+    head.layout = layout;
+    switch (layout) {
+        case HeadLayout::ChannelsFirst:
+            head.classes = a - 4;
+            head.anchors = b;
+            break;
+        case HeadLayout::AnchorsFirst:
+            head.classes = b - 5;
+            head.anchors = a;
+            break;
+        case HeadLayout::EndToEnd:
+            head.classes = 0; // class id is in the row, count unknown
+            head.anchors = a;
+            head.needsNms = false;
+            break;
+        default:
+            break;
+    }
+    if (head.layout != HeadLayout::EndToEnd && head.classes <= 0) head.layout = HeadLayout::Unknown;
+    return head;
+}
+
+const char* HeadLayoutName(HeadLayout layout) {
+    switch (layout) {
+        case HeadLayout::ChannelsFirst: return "channels first (v8)";
+        case HeadLayout::AnchorsFirst: return "anchors first (v5)";
+        case HeadLayout::EndToEnd: return "end to end (v10)";
+        default: return "unknown";
+    }
+}
+
+DecodeFn SelectDecoder(HeadLayout layout, int classes) {
+    switch (layout) {
+        case HeadLayout::ChannelsFirst:
+            switch (classes) {
+                case 1: return &DecodeChannelsFirstT<1>;
+                case 23: return &DecodeChannelsFirstT<23>; // our trash set
+                case 80: return &DecodeChannelsFirstT<80>; // coco
+                default: return &DecodeChannelsFirstT<0>;
+            }
+        case HeadLayout::AnchorsFirst:
+            switch (classes) {
+                case 1: return &DecodeAnchorsFirstT<1>;
+                case 23: return &DecodeAnchorsFirstT<23>;
+                case 80: return &DecodeAnchorsFirstT<80>;
+                default: return &DecodeAnchorsFirstT<0>;
+            }
+        case HeadLayout::EndToEnd:
+            return &DecodeEndToEnd;
+        default:
+            return nullptr;
+    }
+}
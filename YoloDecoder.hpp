@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Preprocess.hpp"
+#include <cstdint>
+#include <vector>
+
+// candidate boxes out of the head, soa so nms can stream over it
+// coords are in original frame pixels, x1 y1 x2 y2
+// buffers only grow, clear keeps capacity so steady state doesnt allocate
+struct CandidateBoxes {
+    std::vector<float> x1, y1, x2, y2;
+    std::vector<float> score;
+    std::vector<int> classId;
+    size_t count = 0;
+
+    void Clear() { count = 0; }
+    size_t Size() const { return count; }
+    void Reserve(size_t n);
+
+    void Push(float bx1, float by1, float bx2, float by2, float s, int cls) {
+        if (count == x1.size()) Reserve(count < 64 ? 64 : count * 2);
+        x1[count] = bx1; y1[count] = by1;
+        x2[count] = bx2; y2[count] = by2;
+        score[count] = s;
+        classId[count] = cls;
+        count++;
+    }
+};
+
+// what the decoder needs to map boxes back to the frame
+struct DecodeParams {
+    float confThreshold = 0.5f;
+    int inputW = 640;
+    int inputH = 640;
+    int frameW = 640;
+    int frameH = 640;
+    LetterboxInfo letterbox;
+};
+
+// output layouts we can decode
+enum class HeadLayout {
+    Unknown,
+    ChannelsFirst, // yolov8/11 [1, 4 + C, N], cx cy w h rows then class rows
+    AnchorsFirst,  // yolov5/7 [1, N, 5 + C], cx cy w h obj classes per anchor
+    EndToEnd       // yolov10 [1, K, 6], x1 y1 x2 y2 score class, already nms'ed
+};
+
+struct HeadInfo {
+    HeadLayout layout = HeadLayout::Unknown;
+    int classes = 0;
+    int anchors = 0;       // N, or K for end to end
+    bool needsNms = true;
+};
+
+// guess layout from the output shape
+// [1, a, b] with a < b is channels first, b == 6 with small a is end to end, else anchors first
+// force overrides the guess (transposed v8 looks like v5 without objectness otherwise)
+HeadInfo DetectHeadLayout(const std::vector<int64_t>& shape, HeadLayout force = HeadLayout::Unknown);
+const char* HeadLayoutName(HeadLayout layout);
+
+using DecodeFn = void (*)(const float* data, int classes, int anchors, const DecodeParams& params, CandidateBoxes& out);
+
+// decoder specialized for layout + class count (1, 23 and 80 compiled in, others generic)
+// picked once per binding so the hot loop has no layout branches
+DecodeFn SelectDecoder(HeadLayout layout, int classes);
+
+// yolov8 style head [1, 4 + C, N], rows are cx cy w h then one row per class
+// walks class rows contiguously a block of anchors at a time
+// running max / argmax per anchor stays in simd registers
+// only anchors above confThreshold turn into boxes
+void DecodeChannelsFirst(const float* data, int classes, int anchors, const DecodeParams& params, CandidateBoxes& out);
+
+// yolov5 style [1, N, 5 + C], score = obj * best class, anchors with obj below threshold skipped early
+void DecodeAnchorsFirst(const float* data, int classes, int anchors, const DecodeParams& params, CandidateBoxes& out);
+
+// yolov10 style [1, K, 6], just threshold and map back
+void DecodeEndToEnd(const float* data, int classes, int anchors, const DecodeParams& params, CandidateBoxes& out);
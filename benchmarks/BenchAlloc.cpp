@@ -0,0 +1,136 @@
+// steady state heap check for the post stage
+// decode -> nms -> Detection records -> Prediction -> snapshot handoff -> render predict -> sink encode
+// replaces global operator new in this binary so every allocation gets counted
+// fails (SkipWithError) if a warm frame allocates anything
+#include "../TrashDetector.hpp"
+#include "../features/Prediction.hpp"
+#include "../DetectionSink.hpp"
+#include "../TripleBuffer.hpp"
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::atomic<uint64_t> allocCount{0};
+
+} // namespace
+
+// gcc sees the replaced new and the free in delete inline into one caller and calls them mismatched
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size) {
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+// fake [4 + C, N] head with a few dozen real objects
+std::vector<float> MakeHead(int classes, int anchors, int objects) {
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    std::vector<float> data((size_t)(4 + classes) * anchors, 0.0f);
+    for (int i = 0; i < anchors; i++) {
+        data[0 * anchors + i] = u(rng) * 640.0f;
+        data[1 * anchors + i] = u(rng) * 640.0f;
+        data[2 * anchors + i] = 8.0f + u(rng) * 80.0f;
+        data[3 * anchors + i] = 8.0f + u(rng) * 80.0f;
+        for (int c = 0; c < classes; c++) data[(size_t)(4 + c) * anchors + i] = u(rng) * 0.2f;
+    }
+    for (int k = 0; k < objects; k++) {
+        int i = (int)(u(rng) * (anchors - 1));
+        data[(size_t)(4 + (k % classes)) * anchors + i] = 0.7f + u(rng) * 0.3f;
+    }
+    return data;
+}
+
+class NullStream : public OutputStream {
+public:
+    bool Send(const void*, size_t) override { return true; }
+};
+
+struct Snapshot {
+    std::vector<Detection> detections;
+};
+
+// one frame of everything after inference, same calls the pipeline and render loop make
+struct PostPath {
+    int classes = 23;
+    int anchors = 8400;
+    std::vector<float> head;
+    DecodeFn decode = nullptr;
+    CandidateBoxes candidates;
+    NmsEngine nms;
+    std::vector<int> keepIdx;
+    std::vector<float> keepScores;
+    std::shared_ptr<const LabelTable> labels = LabelTable::Default();
+    std::vector<Detection> result;        // DetectionPipeline::postResult
+    Prediction prediction;
+    TripleBuffer<Snapshot> snapshots;     // App::frameSnapshots
+    std::vector<Detection> predicted;     // App::predictedDets
+    NdjsonSink sink{std::make_unique<NullStream>()};
+    uint64_t frame = 0;
+
+    PostPath(int objects) : head(MakeHead(classes, anchors, objects)) {
+        decode = SelectDecoder(HeadLayout::ChannelsFirst, classes);
+    }
+
+    void Run() {
+        DecodeParams params;
+        params.letterbox.ratio = 1.0f;
+        params.letterbox.padX = (int)(frame % 3); // boxes drift a little so prediction has work
+        candidates.Clear();
+        decode(head.data(), classes, anchors, params, candidates);
+        nms.Run(candidates, keepIdx, keepScores);
+
+        result.clear();
+        AppendDetections(candidates, keepIdx, keepScores, *labels, result);
+        prediction.UpdateHistory(result);
+        result = prediction.GetProcessed();
+
+        Snapshot& back = snapshots.Back();
+        back.detections.swap(result);
+        snapshots.Publish();
+
+        snapshots.Fetch();
+        prediction.Predict(snapshots.Front().detections, 0.03, predicted);
+
+        DetectionRecord record;
+        record.frameId = frame++;
+        record.frameW = 640;
+        record.frameH = 640;
+        record.detections = &predicted;
+        sink.Write(record);
+    }
+};
+
+// args: objects in the scene
+void BM_PostPath_Allocs(benchmark::State& state) {
+    PostPath path((int)state.range(0));
+    for (int i = 0; i < 64; i++) path.Run(); // warm up, buffers and arenas grow to size here
+
+    uint64_t before = allocCount.load();
+    uint64_t frames = 0;
+    for (auto _ : state) {
+        path.Run();
+        frames++;
+    }
+    uint64_t allocs = allocCount.load() - before;
+
+    state.counters["allocs_per_frame"] = frames ? (double)allocs / frames : 0.0;
+    state.counters["detections"] = (double)path.predicted.size();
+    if (allocs != 0) state.SkipWithError("steady state post path allocated");
+}
+
+BENCHMARK(BM_PostPath_Allocs)->Arg(5)->Arg(40)->Arg(150)->Unit(benchmark::kMicrosecond);
+
+} // namespace
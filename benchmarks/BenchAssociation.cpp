@@ -0,0 +1,93 @@
+#include "../Association.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+// last frame's tracks plus this frame's detections, every object moved a few px
+// spread over a 1920x1080 frame so density stays like a busy conveyor
+struct Scene {
+    std::vector<cv::Rect2f> tracks, dets;
+    std::vector<int> trackClasses, detClasses;
+};
+
+Scene MakeScene(int objects, int classes) {
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    Scene s;
+    for (int i = 0; i < objects; i++) {
+        float w = 20.0f + u(rng) * 60.0f;
+        float h = 20.0f + u(rng) * 60.0f;
+        cv::Rect2f box(u(rng) * 1860.0f, u(rng) * 1020.0f, w, h);
+        int cls = i % classes;
+        s.tracks.push_back(box);
+        s.trackClasses.push_back(cls);
+        box.x += (u(rng) - 0.5f) * 16.0f;
+        box.y += (u(rng) - 0.5f) * 16.0f;
+        s.dets.push_back(box);
+        s.detClasses.push_back(cls);
+    }
+    return s;
+}
+
+// what Prediction::UpdateHistory did before, all pairs in the gate, sort, greedy
+void OldGreedy(const Scene& s, std::vector<int>& matchOf) {
+    struct Match { int cur, prev; float dist; };
+    std::vector<Match> matches;
+    for (size_t i = 0; i < s.dets.size(); i++) {
+        float cx = s.dets[i].x + s.dets[i].width / 2.0f, cy = s.dets[i].y + s.dets[i].height / 2.0f;
+        for (size_t j = 0; j < s.tracks.size(); j++) {
+            if (s.trackClasses[j] != s.detClasses[i]) continue;
+            float px = s.tracks[j].x + s.tracks[j].width / 2.0f, py = s.tracks[j].y + s.tracks[j].height / 2.0f;
+            float dist = std::sqrt((cx - px) * (cx - px) + (cy - py) * (cy - py));
+            if (dist < 250.0f) matches.push_back({(int)i, (int)j, dist});
+        }
+    }
+    std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) { return a.dist < b.dist; });
+    std::vector<bool> usedCur(s.dets.size(), false), usedPrev(s.tracks.size(), false);
+    matchOf.assign(s.dets.size(), -1);
+    for (const auto& m : matches) {
+        if (usedCur[m.cur] || usedPrev[m.prev]) continue;
+        usedCur[m.cur] = usedPrev[m.prev] = true;
+        matchOf[m.cur] = m.prev;
+    }
+}
+
+// args: objects per frame, classes
+void BM_Assoc_OldGreedy(benchmark::State& state) {
+    Scene s = MakeScene((int)state.range(0), (int)state.range(1));
+    std::vector<int> matchOf;
+    for (auto _ : state) {
+        OldGreedy(s, matchOf);
+        benchmark::DoNotOptimize(matchOf.data());
+    }
+    int wrong = 0;
+    for (size_t i = 0; i < matchOf.size(); i++) wrong += matchOf[i] != (int)i;
+    state.counters["wrong_ids"] = wrong;
+}
+
+void BM_Assoc_GridHungarian(benchmark::State& state) {
+    Scene s = MakeScene((int)state.range(0), (int)state.range(1));
+    Associator assoc;
+    for (auto _ : state) {
+        assoc.Run(s.tracks.data(), s.trackClasses.data(), (int)s.tracks.size(),
+                  s.dets.data(), s.detClasses.data(), (int)s.dets.size());
+        benchmark::DoNotOptimize(assoc.Matches().data());
+    }
+    int wrong = (int)assoc.UnmatchedDetections().size();
+    for (const auto& m : assoc.Matches()) wrong += m.track != m.detection;
+    state.counters["wrong_ids"] = wrong;
+}
+
+void AssocArgs(benchmark::internal::Benchmark* b) {
+    for (int n : {10, 50, 100, 200, 400, 800}) b->Args({n, 1})->Args({n, 4});
+    b->Unit(benchmark::kMicrosecond);
+}
+
+BENCHMARK(BM_Assoc_OldGreedy)->Apply(AssocArgs);
+BENCHMARK(BM_Assoc_GridHungarian)->Apply(AssocArgs);
+
+} // namespace
@@ -0,0 +1,99 @@
+#include "../YoloDecoder.hpp"
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+namespace {
+
+// fake [4 + C, N] head, mostly background with a few confident anchors
+std::vector<float> MakeHead(int classes, int anchors, float hitRate) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    std::vector<float> data((size_t)(4 + classes) * anchors);
+    for (int i = 0; i < anchors; i++) {
+        data[0 * anchors + i] = u(rng) * 640.0f;
+        data[1 * anchors + i] = u(rng) * 640.0f;
+        data[2 * anchors + i] = 4.0f + u(rng) * 120.0f;
+        data[3 * anchors + i] = 4.0f + u(rng) * 120.0f;
+    }
+    for (int c = 0; c < classes; c++) {
+        for (int i = 0; i < anchors; i++) {
+            data[(size_t)(4 + c) * anchors + i] = u(rng) * 0.2f;
+        }
+    }
+    for (int i = 0; i < anchors; i++) {
+        if (u(rng) < hitRate) data[(size_t)(4 + (i % classes)) * anchors + i] = 0.6f + u(rng) * 0.4f;
+    }
+    return data;
+}
+
+DecodeParams MakeParams() {
+    DecodeParams p;
+    p.confThreshold = 0.5f;
+    p.letterbox.ratio = 1.0f;
+    return p;
+}
+
+// the loop TrashDetector::Detect had, strided by anchorsNum per class
+void OldDecode(const float* floatData, int classesNum, int anchorsNum, float confThreshold,
+               std::vector<cv::Rect>& boxes, std::vector<float>& confidences, std::vector<int>& classIds) {
+    boxes.clear(); confidences.clear(); classIds.clear();
+    for (int i = 0; i < anchorsNum; i++) {
+        float maxScore = -1.0f;
+        int maxClassId = -1;
+        for (int c = 0; c < classesNum; c++) {
+            float score = floatData[(4 + c) * anchorsNum + i];
+            if (score > maxScore) { maxScore = score; maxClassId = c; }
+        }
+        if (maxScore > confThreshold) {
+            float cx = floatData[0 * anchorsNum + i];
+            float cy = floatData[1 * anchorsNum + i];
+            float w = floatData[2 * anchorsNum + i];
+            float h = floatData[3 * anchorsNum + i];
+            boxes.push_back(cv::Rect((int)(cx - w / 2), (int)(cy - h / 2), (int)w, (int)h));
+            confidences.push_back(maxScore);
+            classIds.push_back(maxClassId);
+        }
+    }
+}
+
+// args: classes, anchors
+void BM_Decode_Strided(benchmark::State& state) {
+    int classes = (int)state.range(0);
+    int anchors = (int)state.range(1);
+    auto data = MakeHead(classes, anchors, 0.005f);
+    std::vector<cv::Rect> boxes;
+    std::vector<float> confidences;
+    std::vector<int> classIds;
+    for (auto _ : state) {
+        OldDecode(data.data(), classes, anchors, 0.5f, boxes, confidences, classIds);
+        benchmark::DoNotOptimize(boxes.data());
+    }
+    state.SetItemsProcessed(state.iterations() * anchors);
+}
+
+void BM_Decode_Blocked(benchmark::State& state) {
+    int classes = (int)state.range(0);
+    int anchors = (int)state.range(1);
+    auto data = MakeHead(classes, anchors, 0.005f);
+    DecodeParams params = MakeParams();
+    CandidateBoxes out;
+    for (auto _ : state) {
+        DecodeChannelsFirst(data.data(), classes, anchors, params, out);
+        benchmark::DoNotOptimize(out.x1.data());
+    }
+    state.SetItemsProcessed(state.iterations() * anchors);
+}
+
+// 23 class trash model and 80 class coco, 640 and 320 input
+// plus single class and 1280 input (33600 anchors) for the ends of the range
+void DecodeArgs(benchmark::internal::Benchmark* b) {
+    b->Args({23, 8400})->Args({80, 8400})->Args({23, 2100})->Args({80, 2100});
+    b->Args({1, 8400})->Args({23, 33600})->Args({80, 33600});
+    b->Unit(benchmark::kMicrosecond);
+}
+
+} // namespace
+
+BENCHMARK(BM_Decode_Strided)->Apply(DecodeArgs);
+BENCHMARK(BM_Decode_Blocked)->Apply(DecodeArgs);
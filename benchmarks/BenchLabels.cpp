@@ -0,0 +1,46 @@
+#include "../TrashDetector.hpp"
+#include "../LabelTable.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// same shape as Skrald.json, "id": "name" per line
+std::string WriteLabelFile(int classes) {
+    std::string path = "bench_labels_" + std::to_string(classes) + ".json";
+    std::ofstream out(path);
+    out << "{\n";
+    for (int i = 0; i < classes; i++) out << "  \"" << i << "\": \"class name " << i << "\"" << (i + 1 < classes ? "," : "") << "\n";
+    out << "}\n";
+    return path;
+}
+
+// args: classes, whole file -> regex -> table swap like a model switch does it
+void BM_Labels_Load(benchmark::State& state) {
+    std::string path = WriteLabelFile((int)state.range(0));
+    TrashDetector detector; // outside the loop, session env isnt what gets measured
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(detector.LoadLabels(path));
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// args: classes, table build alone (names already interned after the first run)
+void BM_Labels_FromNames(benchmark::State& state) {
+    std::vector<std::string> names;
+    for (int i = 0; i < state.range(0); i++) names.push_back("class name " + std::to_string(i));
+    for (auto _ : state) {
+        auto table = LabelTable::FromNames(names);
+        benchmark::DoNotOptimize(table.get());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+BENCHMARK(BM_Labels_Load)->Arg(23)->Arg(80)->Arg(1000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Labels_FromNames)->Arg(23)->Arg(80)->Arg(1000)->Unit(benchmark::kMicrosecond);
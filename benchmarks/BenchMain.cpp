@@ -0,0 +1,43 @@
+// microbenchmarks for the hot paths
+// benchmarks/CMakeLists.txt builds every benchmarks/*.cpp together with the sources they test
+// and links google benchmark (benchmark::benchmark) + opencv + onnxruntime
+//   TrashDetector Preprocess YoloDecoder BoxNms ModelCache LabelTable FrameArena DetectionSink
+//   Prediction Association MotionFilter FlowPropagator LatencyModel TraceRecorder DistanceEstimator FramePool
+//
+// results always go to a json file too (benchmark_results.json unless --benchmark_out is given)
+// so release builds can be diffed with google benchmark's tools/compare.py
+#include <benchmark/benchmark.h>
+#include <opencv2/core/version.hpp>
+#include <cstring>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv) {
+    std::vector<char*> args(argv, argv + argc);
+    bool hasOut = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], "--benchmark_out=", 16) == 0) hasOut = true;
+    }
+    std::string outArg = "--benchmark_out=benchmark_results.json";
+    std::string formatArg = "--benchmark_out_format=json";
+    if (!hasOut) {
+        args.push_back(&outArg[0]);
+        args.push_back(&formatArg[0]);
+    }
+
+    int count = (int)args.size();
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data())) return 1;
+
+    // lands in the json context block, a debug build or another opencv explains a lot of regressions
+    benchmark::AddCustomContext("opencv", CV_VERSION);
+#ifdef NDEBUG
+    benchmark::AddCustomContext("sro_build", "release");
+#else
+    benchmark::AddCustomContext("sro_build", "debug");
+#endif
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
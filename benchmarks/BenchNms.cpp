@@ -0,0 +1,68 @@
+#include "../BoxNms.hpp"
+#include <benchmark/benchmark.h>
+#include <opencv2/dnn.hpp>
+#include <random>
+
+namespace {
+
+// pile of bottles: lots of heavily overlapping boxes in a small area
+void MakePile(int count, int classes, CandidateBoxes& out) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    out.Clear();
+    for (int i = 0; i < count; i++) {
+        float x = u(rng) * 300.0f;
+        float y = u(rng) * 300.0f;
+        float s = 20.0f + u(rng) * 40.0f;
+        out.Push(x, y, x + s, y + s, 0.5f + u(rng) * 0.5f, i % classes);
+    }
+}
+
+// args: candidate count
+void BM_Nms_OpenCv(benchmark::State& state) {
+    CandidateBoxes c;
+    MakePile((int)state.range(0), 4, c);
+    std::vector<cv::Rect> boxes;
+    std::vector<float> scores;
+    std::vector<int> indices;
+    for (auto _ : state) {
+        // old path built the vectors with push_back every frame
+        boxes.clear(); scores.clear();
+        for (size_t i = 0; i < c.Size(); i++) {
+            boxes.push_back(cv::Rect((int)c.x1[i], (int)c.y1[i], (int)(c.x2[i] - c.x1[i]), (int)(c.y2[i] - c.y1[i])));
+            scores.push_back(c.score[i]);
+        }
+        cv::dnn::NMSBoxes(boxes, scores, 0.5f, 0.45f, indices);
+        benchmark::DoNotOptimize(indices.data());
+    }
+}
+
+void RunEngine(benchmark::State& state, NmsMode mode) {
+    CandidateBoxes c;
+    MakePile((int)state.range(0), 4, c);
+    NmsEngine nms;
+    nms.config.mode = mode;
+    std::vector<int> keep;
+    std::vector<float> scores;
+    for (auto _ : state) {
+        nms.Run(c, keep, scores);
+        benchmark::DoNotOptimize(keep.data());
+    }
+    state.counters["kept"] = (double)keep.size();
+}
+
+void BM_Nms_Hard(benchmark::State& state) { RunEngine(state, NmsMode::Hard); }
+void BM_Nms_DIoU(benchmark::State& state) { RunEngine(state, NmsMode::DIoU); }
+void BM_Nms_Soft(benchmark::State& state) { RunEngine(state, NmsMode::SoftGaussian); }
+
+void NmsArgs(benchmark::internal::Benchmark* b) {
+    b->Arg(50)->Arg(500)->Arg(2000)->Arg(8400);
+    b->Unit(benchmark::kMicrosecond);
+}
+
+} // namespace
+
+BENCHMARK(BM_Nms_OpenCv)->Apply(NmsArgs);
+BENCHMARK(BM_Nms_Hard)->Apply(NmsArgs);
+BENCHMARK(BM_Nms_DIoU)->Apply(NmsArgs);
+BENCHMARK(BM_Nms_Soft)->Apply(NmsArgs);
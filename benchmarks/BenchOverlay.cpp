@@ -0,0 +1,48 @@
+#include "../features/DistanceEstimator.hpp"
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<Detection> MakeBoxes(int count) {
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> u(0.0f, 1.0f);
+    std::vector<Detection> dets(count);
+    for (auto& d : dets) {
+        d.box = cv::Rect2f(u(rng) * 1800.0f, u(rng) * 1000.0f, 10.0f + u(rng) * 110.0f, 10.0f + u(rng) * 70.0f);
+        d.confidence = 0.5f + u(rng) * 0.5f;
+    }
+    return dets;
+}
+
+// args: detections, priority mode (0 size, 1 lowest on screen, 2 crosshair)
+void BM_Distance_FindClosest(benchmark::State& state) {
+    std::vector<Detection> dets = MakeBoxes((int)state.range(0));
+    DistanceEstimator est;
+    est.highlightClosest = true;
+    est.priorityMode = (int)state.range(1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(est.FindClosestIndex(dets, 1920, 1080));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// args: detections, the distance label the overlay builds per box
+void BM_Distance_Text(benchmark::State& state) {
+    std::vector<Detection> dets = MakeBoxes((int)state.range(0));
+    DistanceEstimator est;
+    est.enabled = true;
+    for (auto _ : state) {
+        for (const auto& d : dets) {
+            std::string text = est.GetDistanceText(d, 1.0f);
+            benchmark::DoNotOptimize(text.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+BENCHMARK(BM_Distance_FindClosest)->ArgsProduct({{1, 10, 100, 500}, {0, 1, 2}});
+BENCHMARK(BM_Distance_Text)->Arg(10)->Arg(100)->Arg(500)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,76 @@
+#include "../Preprocess.hpp"
+#include <benchmark/benchmark.h>
+#include <opencv2/dnn.hpp>
+#include <vector>
+
+namespace {
+
+cv::Mat MakeFrame(int w, int h, int type) {
+    cv::Mat frame(h, w, type);
+    cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+    return frame;
+}
+
+// the path TrashDetector::Detect used before the fused kernel
+void OldLetterbox(const cv::Mat& rawFrame, cv::Mat& blob, int useW, int useH) {
+    float ratio = std::min((float)useW / rawFrame.cols, (float)useH / rawFrame.rows);
+    int newW = (int)(rawFrame.cols * ratio);
+    int newH = (int)(rawFrame.rows * ratio);
+
+    cv::Mat resized;
+    cv::resize(rawFrame, resized, cv::Size(newW, newH));
+    cv::Mat frame(useH, useW, CV_8UC3, cv::Scalar(114, 114, 114));
+    int padX = (useW - newW) / 2;
+    int padY = (useH - newH) / 2;
+    resized.copyTo(frame(cv::Rect(padX, padY, newW, newH)));
+
+    // it ran this twice
+    cv::dnn::blobFromImage(frame, blob, 1.0/255.0, cv::Size(useW, useH), cv::Scalar(0,0,0), true, false);
+    cv::dnn::blobFromImage(frame, blob, 1.0/255.0, cv::Size(useW, useH), cv::Scalar(0,0,0), true, false);
+}
+
+// args: src w, src h, input size
+void BM_Preprocess_OpenCv(benchmark::State& state) {
+    cv::Mat frame = MakeFrame((int)state.range(0), (int)state.range(1), CV_8UC3);
+    int size = (int)state.range(2);
+    cv::Mat blob;
+    for (auto _ : state) {
+        OldLetterbox(frame, blob, size, size);
+        benchmark::DoNotOptimize(blob.data);
+    }
+}
+
+void BM_Preprocess_Fused(benchmark::State& state) {
+    cv::Mat frame = MakeFrame((int)state.range(0), (int)state.range(1), CV_8UC3);
+    int size = (int)state.range(2);
+    std::vector<float> tensor(3 * size * size);
+    LetterboxKernel kernel;
+    for (auto _ : state) {
+        kernel.Run(frame, tensor.data(), size, size);
+        benchmark::DoNotOptimize(tensor.data());
+    }
+}
+
+// gdi hands out bgra, fused kernel can eat it without cvtColor
+void BM_Preprocess_FusedBgra(benchmark::State& state) {
+    cv::Mat frame = MakeFrame((int)state.range(0), (int)state.range(1), CV_8UC4);
+    int size = (int)state.range(2);
+    std::vector<float> tensor(3 * size * size);
+    LetterboxKernel kernel;
+    for (auto _ : state) {
+        kernel.Run(frame, tensor.data(), size, size);
+        benchmark::DoNotOptimize(tensor.data());
+    }
+}
+
+// 640 capture into 640 / 416 / 320 input, plus a full hd frame
+void PreprocessArgs(benchmark::internal::Benchmark* b) {
+    b->Args({640, 640, 640})->Args({640, 640, 416})->Args({640, 640, 320})->Args({1920, 1080, 640});
+    b->Unit(benchmark::kMillisecond);
+}
+
+} // namespace
+
+BENCHMARK(BM_Preprocess_OpenCv)->Apply(PreprocessArgs);
+BENCHMARK(BM_Preprocess_Fused)->Apply(PreprocessArgs);
+BENCHMARK(BM_Preprocess_FusedBgra)->Apply(PreprocessArgs);
@@ -0,0 +1,87 @@
+#include "../features/Prediction.hpp"
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// objects on a grid so neighbours never swap, each one sways a few px per frame
+// frames are built up front so the loop only measures the tracker
+struct TrackScene {
+    std::vector<std::vector<Detection>> frames;
+    std::vector<CapturedFrame> captures; // empty images, only the capture times matter
+};
+
+TrackScene MakeTrackScene(int objects, int frameCount) {
+    TrackScene s;
+    const int columns = 25;
+    auto t0 = FrameClock::now();
+    for (int f = 0; f < frameCount; f++) {
+        std::vector<Detection> dets;
+        dets.reserve(objects);
+        for (int i = 0; i < objects; i++) {
+            Detection d;
+            float sway = 6.0f * std::sin(f * 0.15f + i);
+            d.box = cv::Rect2f(20.0f + (i % columns) * 75.0f + sway, 20.0f + (i / columns) * 52.0f + sway * 0.5f, 30.0f, 30.0f);
+            d.confidence = 0.8f;
+            d.classId = i % 23;
+            dets.push_back(d);
+        }
+        s.frames.push_back(std::move(dets));
+
+        CapturedFrame capture;
+        capture.frameId = f;
+        capture.captureTime = t0 + std::chrono::milliseconds(33 * f);
+        s.captures.push_back(std::move(capture));
+    }
+    return s;
+}
+
+// args: tracks
+void BM_Prediction_UpdateHistory(benchmark::State& state) {
+    const int frameCount = 64;
+    TrackScene scene = MakeTrackScene((int)state.range(0), frameCount);
+    Prediction prediction;
+    for (int f = 0; f < frameCount; f++) prediction.UpdateHistory(scene.frames[f], nullptr, &scene.captures[f]); // tracks confirmed
+
+    // capture times keep going forward, a frame going back in time would be a different code path
+    int f = 0;
+    auto step = std::chrono::milliseconds(33 * frameCount);
+    for (auto _ : state) {
+        int i = f % frameCount;
+        if (i == 0 && f > 0) {
+            for (auto& capture : scene.captures) capture.captureTime += step;
+        }
+        prediction.UpdateHistory(scene.frames[i], nullptr, &scene.captures[i]);
+        benchmark::DoNotOptimize(prediction.GetProcessed().data());
+        f++;
+    }
+    state.counters["tracks"] = (double)prediction.TrackCount();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// args: tracks, render side extrapolation of a published snapshot
+void BM_Prediction_Predict(benchmark::State& state) {
+    const int frameCount = 8;
+    TrackScene scene = MakeTrackScene((int)state.range(0), frameCount);
+    Prediction prediction;
+    for (int f = 0; f < frameCount; f++) prediction.UpdateHistory(scene.frames[f], nullptr, &scene.captures[f]);
+    std::vector<Detection> snapshot = prediction.GetProcessed();
+    std::vector<Detection> out;
+    for (auto _ : state) {
+        prediction.Predict(snapshot, 0.03, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.counters["tracks"] = (double)snapshot.size();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void TrackArgs(benchmark::internal::Benchmark* b) {
+    b->Arg(1)->Arg(10)->Arg(50)->Arg(100)->Arg(250)->Arg(500);
+    b->Unit(benchmark::kMicrosecond);
+}
+
+} // namespace
+
+BENCHMARK(BM_Prediction_UpdateHistory)->Apply(TrackArgs);
+BENCHMARK(BM_Prediction_Predict)->Apply(TrackArgs);
@@ -0,0 +1,71 @@
+# shared by the top level build and benchmarks/, only sources that build without win32 / d3d11 / imgui
+include_guard(GLOBAL)
+
+set(CMAKE_CXX_STANDARD 17)
+set(CMAKE_CXX_STANDARD_REQUIRED ON)
+if(NOT CMAKE_BUILD_TYPE AND NOT CMAKE_CONFIGURATION_TYPES)
+    set(CMAKE_BUILD_TYPE Release CACHE STRING "" FORCE) # debug timings mean nothing
+endif()
+
+get_filename_component(SRO_ROOT ${CMAKE_CURRENT_LIST_DIR}/.. ABSOLUTE)
+
+find_package(OpenCV REQUIRED COMPONENTS core imgproc imgcodecs videoio video dnn)
+find_package(Threads REQUIRED)
+
+# the release zips have no cmake package, fall back to a plain header + lib lookup
+find_package(onnxruntime CONFIG QUIET)
+if(NOT TARGET onnxruntime::onnxruntime)
+    set(ONNXRUNTIME_ROOT "" CACHE PATH "onnxruntime release folder")
+    find_path(ONNXRUNTIME_INCLUDE_DIR onnxruntime_cxx_api.h
+              HINTS ${ONNXRUNTIME_ROOT}/include PATH_SUFFIXES onnxruntime onnxruntime/core/session)
+    find_library(ONNXRUNTIME_LIBRARY onnxruntime HINTS ${ONNXRUNTIME_ROOT}/lib)
+    if(NOT ONNXRUNTIME_INCLUDE_DIR OR NOT ONNXRUNTIME_LIBRARY)
+        message(FATAL_ERROR "onnxruntime not found, set ONNXRUNTIME_ROOT")
+    endif()
+    add_library(onnxruntime::onnxruntime UNKNOWN IMPORTED)
+    set_target_properties(onnxruntime::onnxruntime PROPERTIES
+        IMPORTED_LOCATION ${ONNXRUNTIME_LIBRARY}
+        INTERFACE_INCLUDE_DIRECTORIES ${ONNXRUNTIME_INCLUDE_DIR})
+endif()
+
+# the sources include each other like the gui project lays them out ("features/Prediction.hpp",
+# "analytics/PerformanceLogger.hpp", "../TrashDetector.hpp" from inside features/), here every file sits in
+# the root, so forwarding headers in the build dir make those spellings resolve
+set(SRO_LAYOUT ${CMAKE_BINARY_DIR}/sro_layout)
+file(GLOB SRO_HEADERS CONFIGURE_DEPENDS ${SRO_ROOT}/*.hpp)
+foreach(header ${SRO_HEADERS})
+    get_filename_component(name ${header} NAME)
+    foreach(dir . features analytics)
+        file(CONFIGURE OUTPUT ${SRO_LAYOUT}/${dir}/${name} CONTENT "#include \"${header}\"\n")
+    endforeach()
+endforeach()
+
+add_library(sro_core STATIC
+    ${SRO_ROOT}/Association.cpp
+    ${SRO_ROOT}/BoxNms.cpp
+    ${SRO_ROOT}/DetectionPipeline.cpp
+    ${SRO_ROOT}/DetectionSink.cpp
+    ${SRO_ROOT}/DistanceEstimator.cpp
+    ${SRO_ROOT}/FlowPropagator.cpp
+    ${SRO_ROOT}/FrameArena.cpp
+    ${SRO_ROOT}/FramePool.cpp
+    ${SRO_ROOT}/FrameSource.cpp
+    ${SRO_ROOT}/LabelTable.cpp
+    ${SRO_ROOT}/LatencyHistogram.cpp
+    ${SRO_ROOT}/LatencyModel.cpp
+    ${SRO_ROOT}/ModelCache.cpp
+    ${SRO_ROOT}/MotionFilter.cpp
+    ${SRO_ROOT}/MotionGate.cpp
+    ${SRO_ROOT}/PerformanceLogger.cpp
+    ${SRO_ROOT}/Prediction.cpp
+    ${SRO_ROOT}/Preprocess.cpp
+    ${SRO_ROOT}/ReplayEval.cpp
+    ${SRO_ROOT}/ResolutionController.cpp
+    ${SRO_ROOT}/StreamManager.cpp
+    ${SRO_ROOT}/TelemetryLog.cpp
+    ${SRO_ROOT}/TraceRecorder.cpp
+    ${SRO_ROOT}/TrashDetector.cpp
+    ${SRO_ROOT}/YoloDecoder.cpp
+)
+target_include_directories(sro_core PUBLIC ${SRO_ROOT} ${SRO_LAYOUT} ${SRO_LAYOUT}/features)
+target_link_libraries(sro_core PUBLIC ${OpenCV_LIBS} onnxruntime::onnxruntime Threads::Threads)